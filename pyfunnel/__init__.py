@@ -6,7 +6,7 @@ Python binding for funnel library.
 """
 
 # Main public API functions that users should be able to import directly from pyfunnel
-from .core import CORSRequestHandler, MyHTTPServer, compareAndReport, plot_funnel
+from .core import GATE_FAILED, CORSRequestHandler, MyHTTPServer, allocation_counts, compareAndReport, compareAndReturn, plot_funnel, read_binary, read_csv, read_mat
 
-__all__ = ['CORSRequestHandler', 'MyHTTPServer', 'compareAndReport', 'plot_funnel']
+__all__ = ['GATE_FAILED', 'CORSRequestHandler', 'MyHTTPServer', 'allocation_counts', 'compareAndReport', 'compareAndReturn', 'plot_funnel', 'read_binary', 'read_csv', 'read_mat']
 __version__ = '2.0.1'  # DO NOT CHANGE: this is automatically updated with 'cz bump'
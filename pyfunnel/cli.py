@@ -9,8 +9,9 @@ without installing the pyfunnel package, or run as part of an installed package.
 """
 
 import argparse
-import csv
+import gzip
 import os
+import re
 import sys
 from pathlib import Path
 
@@ -20,7 +21,36 @@ if __name__ == "__main__":
     if str(current_dir) not in sys.path:
         sys.path.insert(0, str(current_dir))
 
-from pyfunnel import compareAndReport
+from pyfunnel import GATE_FAILED, compareAndReport, read_csv, read_mat
+
+
+def _open_csv(path):
+    """Open a CSV file in text mode, decompressing it on the fly if it is gzip-compressed."""
+    with open(path, 'rb') as f:
+        is_gzip = f.read(2) == b'\x1f\x8b'
+    if is_gzip:
+        return gzip.open(path, 'rt', newline='')
+    return open(path, newline='')
+
+
+def _read_two_columns(path, s):
+    """Read the x and y values of a two-column CSV file with the C reader (see `read_csv`).
+
+    Only the first line is read here, to detect a header and check the number of columns:
+    the values are parsed (and decompressed if the file is gzip-compressed) by the C library.
+    """
+    with _open_csv(path) as csvfile:
+        row = re.split('[,;]', csvfile.readline().strip())
+    if (l := len(row)) != 2:
+        raise IOError('The {} CSV file must have exactly two columns. Row 0 contains {} elements.'.format(s, l))
+    try:
+        [float(v) for v in row]
+        skipLines = 0
+    except ValueError:
+        skipLines = 1
+    x, y = read_csv(path, [1], skipLines=skipLines)
+
+    return x, y[1]
 
 
 def main():
@@ -37,7 +67,12 @@ def main():
             '`reference.csv`, `test.csv` into the output directory (`./results` by default).\n\n'
             'Each CSV file must contain two columns: x (independent variable, e.g., time)\n'
             'and y (dependent variable, e.g., temperature, pressure). The funnel boundaries\n'
-            'are computed based on tolerances that can be set independently for x and y.\n\n'
+            'are computed based on tolerances that can be set independently for x and y.\n'
+            'Modelica result files (`.mat`, MATLAB v4 format) can be used instead of CSV\n'
+            'files, in which case the variable to compare is set with `--variable`.\n'
+            'With `--variable`, CSV files may also hold many columns (x values first, and\n'
+            'a header line of column names): only the named column is read.\n'
+            'Gzip-compressed CSV files (e.g., `.csv.gz`) are decompressed on the fly.\n\n'
             'Tolerance can be specified in three forms for each variable:\n'
             '  - Absolute tolerance\n'
             '  - Relative to variable value\n'
@@ -82,6 +117,50 @@ def main():
     parser.add_argument(
         '--rtoly', type=float, help='Relative tolerance along y axis (relatively to the range)'
     )
+    parser.add_argument(
+        '--format',
+        choices=('csv', 'binary', 'binary-compressed'),
+        default='csv',
+        help='Format of output files (binary: little-endian float64 columns in .bin files, '
+        'see pyfunnel.read_binary)',
+    )
+    parser.add_argument(
+        '--errors',
+        choices=('dense', 'intervals'),
+        default='dense',
+        help='Output of the errors (intervals: violations.csv with one row per interval '
+        'of test points out of the tube, instead of errors.csv)',
+    )
+    parser.add_argument(
+        '--skip-inputs',
+        action='store_true',
+        help='Do not write reference and test files in the output directory',
+    )
+    parser.add_argument(
+        '--gate',
+        action='store_true',
+        help='Pass/fail mode: stop at the first test point out of the tube, write the output files '
+        'only if the test fails, and exit with status {} then'.format(GATE_FAILED),
+    )
+    parser.add_argument(
+        '--memory-budget',
+        type=int,
+        default=0,
+        help='Memory budget of the comparison in MB: sorted inputs larger than the budget '
+        'are compared by windows, with the same output files (0 for no budget)',
+    )
+    parser.add_argument(
+        '--engine',
+        choices=('rectangle', 'window'),
+        default='rectangle',
+        help='Tube construction engine (window: sliding window, faster for wide tubes, '
+        'requires ltolx = 0 and sorted reference x values)',
+    )
+    parser.add_argument(
+        '--variable',
+        help='Name of variable to compare, for Modelica result files (.mat) '
+        'or CSV files with a header line of column names',
+    )
 
     # Parse the arguments.
     args = parser.parse_args()
@@ -93,21 +172,17 @@ def main():
     # Extract data from files.
     data = dict()
     for s in ('reference', 'test'):
-        data[s] = dict(x=[], y=[])
-        with open(vars(args)[s]) as csvfile:
-            spamreader = csv.reader(csvfile)
-            for i, row in enumerate(spamreader):
-                if (l := len(row)) != 2:
-                    raise IOError(
-                        'The {} CSV file must have exactly two columns. Row {} contains {} elements.'.format(
-                            s, i, l
-                        )
-                    )
-                try:
-                    data[s]['x'].append(float(row[0]))
-                    data[s]['y'].append(float(row[1]))
-                except BaseException:
-                    pass
+        data[s] = dict()
+        if vars(args)[s].lower().endswith('.mat'):
+            assert args.variable is not None, 'Option --variable is required for .mat files.'
+            x, y = read_mat(vars(args)[s], [args.variable])
+            data[s]['x'], data[s]['y'] = x, y[args.variable]
+            continue
+        if args.variable is not None:
+            x, y = read_csv(vars(args)[s], [args.variable])
+            data[s]['x'], data[s]['y'] = x, y[args.variable]
+            continue
+        data[s]['x'], data[s]['y'] = _read_two_columns(vars(args)[s], s)
 
     # Call the function.
     rc = compareAndReport(
@@ -122,6 +197,12 @@ def main():
         ltoly=args.ltoly,
         rtolx=args.rtolx,
         rtoly=args.rtoly,
+        outputFormat=args.format,
+        errorOutput=args.errors,
+        skipInputs=args.skip_inputs,
+        gate=args.gate,
+        memoryBudget=args.memory_budget * 1024 * 1024,
+        engine=args.engine,
     )
 
     sys.exit(rc)
@@ -5,6 +5,7 @@
 # Core functions for funnel Python binding
 #######################################################
 
+import array
 import io
 import numbers
 import os
@@ -16,10 +17,15 @@ import sys
 import threading
 import time
 import webbrowser
-from ctypes import POINTER, c_char_p, c_double, c_int, cdll
+from ctypes import POINTER, Structure, byref, c_char_p, c_double, c_int, c_size_t, c_void_p, cast, cdll
 from http.server import SimpleHTTPRequestHandler, ThreadingHTTPServer
 
-__all__ = ['compareAndReport', 'MyHTTPServer', 'CORSRequestHandler', 'plot_funnel']
+try:
+    import numpy as np
+except ImportError:  # NumPy is optional: inputs are then converted element by element.
+    np = None
+
+__all__ = ['compareAndReport', 'compareAndReturn', 'MyHTTPServer', 'CORSRequestHandler', 'plot_funnel', 'read_binary', 'read_csv', 'read_mat']
 
 
 #########################################
@@ -135,12 +141,19 @@ def exit_test(logger, list_files=None):
 def plot_funnel(test_dir, title="", browser=None):
     """Plot funnel results stored in test_dir and display in default browser.
 
+    The results may be stored as CSV files or as binary files (see read_binary),
+    which are decoded by the browser without parsing.
+
     Args:
         test_dir (str): path of directory where output files are stored
         [title] (str): plot title
         [browser] (str): web browser to use for displaying plot
     """
-    list_files = ['reference.csv', 'test.csv', 'errors.csv', 'lowerBound.csv', 'upperBound.csv']
+    extension = 'csv'
+    if not os.path.isfile(os.path.join(test_dir, 'reference.csv')) and \
+            os.path.isfile(os.path.join(test_dir, 'reference.bin')):
+        extension = 'bin'
+    list_files = ['{}.{}'.format(f, extension) for f in ('reference', 'test', 'errors', 'lowerBound', 'upperBound')]
     for f in list_files:
         file_path = os.path.join(test_dir, f)
         assert os.path.isfile(file_path), "No such file: {}".format(file_path)
@@ -149,11 +162,131 @@ def plot_funnel(test_dir, title="", browser=None):
         _TEMPLATE_HTML = f.read()
 
     content = re.sub(r'\$TITLE', title, _TEMPLATE_HTML)
+    content = re.sub(r'\$EXTENSION', extension, content)
     server = MyHTTPServer(('', 0), CORSRequestHandler,
                           str_html=content, url_html='funnel', browse_dir=test_dir)
     server.browse(list_files, browser=browser)
 
 
+def _decode_delta(raw, n):
+    """Decode an x column compressed with the delta encoding of the binary result files.
+
+    The column holds the zigzag LEB128 varints of the second differences of the bit patterns.
+    """
+    ends = np.flatnonzero(raw < 0x80)  # last byte of each varint
+    if ends.size != n:
+        raise IOError("Corrupted x column: {} values found instead of {}.".format(ends.size, n))
+    starts = np.empty(n, dtype=np.intp)
+    starts[0] = 0
+    starts[1:] = ends[:-1] + 1
+    shifts = (np.arange(raw.size) - np.repeat(starts, ends - starts + 1)) * 7
+    z = np.add.reduceat((raw & 0x7f).astype(np.uint64) << shifts.astype(np.uint64), starts)
+    dd = (z >> np.uint64(1)) ^ (np.uint64(0) - (z & np.uint64(1)))
+    bits = np.cumsum(np.cumsum(dd, dtype=np.uint64), dtype=np.uint64)
+    return bits.view('<f8')
+
+
+def read_binary(file_name):
+    """Read a binary result file written by compareAndReport with a binary output format.
+
+    The y column (and the x column if not compressed) is memory-mapped: nothing is parsed
+    or copied until the values are used.
+
+    Args:
+        file_name (str): path of result file (e.g. `results/test.bin`)
+
+    Returns:
+        tuple: (x, y) 1-D NumPy arrays of float64
+    """
+    if np is None:
+        raise ImportError("read_binary requires NumPy.")
+    header = np.fromfile(file_name, dtype=_BINARY_HEADER, count=1)
+    if header.size != 1 or header['magic'][0] != _BINARY_MAGIC or header['version'][0] != 1:
+        raise IOError("{} is not a funnel binary result file.".format(file_name))
+    header = header[0]
+    n = int(header['n'])
+    if n == 0:
+        return np.empty(0), np.empty(0)
+    y = np.memmap(file_name, dtype='<f8', mode='r', offset=int(header['yOffset']), shape=(n,))
+    if header['encoding'] == 0:
+        x = np.memmap(file_name, dtype='<f8', mode='r', offset=int(header['xOffset']), shape=(n,))
+    else:
+        raw = np.fromfile(file_name, dtype=np.uint8, count=int(header['xSize']), offset=int(header['xOffset']))
+        x = _decode_delta(raw, n)
+    return x, y
+
+
+def read_csv(file_name, columns, skipLines=1):
+    """Read columns of a CSV file with the first column holding the x values, e.g. a wide
+    simulation result file with one column per variable.
+
+    The columns are delimited by comma or semicolon. The file is parsed by the C library
+    on several threads, and only the requested columns are decoded.
+    Gzip-compressed files (e.g. `.csv.gz`) are decompressed on the fly.
+
+    Args:
+        file_name (str): path of CSV file
+        columns (list of str or int): column names, as written in the last skipped line,
+            or column indices (the x column has index 0)
+        skipLines (int): number of head lines to be skipped, the last one holding the column names
+
+    Returns:
+        tuple: (x, y) where x is a 1-D NumPy array with the x values and y a dict
+            with a 1-D NumPy array of values for each column
+    """
+    if np is None:
+        raise ImportError("read_csv requires NumPy.")
+    lib = _load_lib()
+    by_name = all(isinstance(c, str) for c in columns)
+    assert by_name or all(isinstance(c, numbers.Integral) for c in columns),\
+        "Columns must be all names or all indices."
+    c_names = (c_char_p * len(columns))(*[c.encode('utf-8') for c in columns]) if by_name else None
+    c_indices = None if by_name else (c_int * len(columns))(*columns)
+    series = (_Data * len(columns))()
+    ctx = _get_context(lib)
+    retVal = lib.readCSVColumnsInContext(
+        ctx.handle, file_name.encode('utf-8'), skipLines, c_names, c_indices, len(columns), 0, series)
+    if retVal != 0:
+        raise IOError("Could not read {} from {}. {}".format(columns, file_name, ctx.error()))
+    try:
+        x = np.ctypeslib.as_array(series[0].x, shape=(series[0].n,)).copy() if columns else np.empty(0)
+        y = {c: np.ctypeslib.as_array(series[i].y, shape=(series[i].n,)).copy() for i, c in enumerate(columns)}
+    finally:
+        lib.freeCSVColumns(series, len(columns))
+    return x, y
+
+
+def read_mat(file_name, names):
+    """Read variables of a Modelica result file (MATLAB v4 format, written by Dymola or OpenModelica).
+
+    Only the requested variables are decoded. Aliases are resolved (including sign-flipped aliases)
+    and parameters are returned as constant series.
+
+    Args:
+        file_name (str): path of result file
+        names (list of str): variable names
+
+    Returns:
+        tuple: (x, y) where x is a 1-D NumPy array with the time values and y a dict
+            with a 1-D NumPy array of values for each variable name
+    """
+    if np is None:
+        raise ImportError("read_mat requires NumPy.")
+    lib = _load_lib()
+    c_names = (c_char_p * len(names))(*[n.encode('utf-8') for n in names])
+    series = (_Data * len(names))()
+    ctx = _get_context(lib)
+    retVal = lib.readMatFileInContext(ctx.handle, file_name.encode('utf-8'), c_names, len(names), series)
+    if retVal != 0:
+        raise IOError("Could not read {} from {}. {}".format(names, file_name, ctx.error()))
+    try:
+        x = np.ctypeslib.as_array(series[0].x, shape=(series[0].n,)).copy() if names else np.empty(0)
+        y = {n: np.ctypeslib.as_array(series[i].y, shape=(series[i].n,)).copy() for i, n in enumerate(names)}
+    finally:
+        lib.freeMatVariables(series, len(names))
+    return x, y
+
+
 def _get_lib_path(project_name):
     """Infer the library absolute path.
 
@@ -184,6 +317,279 @@ def _get_lib_path(project_name):
     return os.path.abspath(lib_path)
 
 
+class _Data(Structure):
+    """Mapping of struct data (see data_structure.h)."""
+    _fields_ = [('x', POINTER(c_double)), ('y', POINTER(c_double)), ('n', c_size_t)]
+
+
+class _Violation(Structure):
+    """Mapping of struct violation (see data_structure.h)."""
+    _fields_ = [('xStart', c_double), ('xEnd', c_double), ('peak', c_double), ('xPeak', c_double)]
+
+
+class _Violations(Structure):
+    """Mapping of struct violations (see data_structure.h)."""
+    _fields_ = [('intervals', POINTER(_Violation)), ('n', c_size_t)]
+
+
+# Number of worst test points of a violation summary (see SUMMARY_TOP_K in data_structure.h).
+_SUMMARY_TOP_K = 10
+
+
+class _ViolationSummary(Structure):
+    """Mapping of struct violation_summary (see data_structure.h)."""
+    _fields_ = [('nViolations', c_size_t), ('maxError', c_double), ('xMaxError', c_double),
+                ('firstViolation', c_double), ('integral', c_double), ('nTop', c_size_t),
+                ('topX', c_double * _SUMMARY_TOP_K), ('topError', c_double * _SUMMARY_TOP_K)]
+
+    def to_dict(self):
+        """Return the summary metrics as a dict (see compareAndReturn)."""
+        return dict(
+            nViolations=self.nViolations,
+            maxError=self.maxError,
+            xMaxError=self.xMaxError,
+            firstViolation=self.firstViolation,
+            integral=self.integral,
+            top=(np.array(self.topX[:self.nTop]), np.array(self.topError[:self.nTop])),
+        )
+
+
+class _ErrorReport(Structure):
+    """Mapping of struct errorReport (see data_structure.h)."""
+    _fields_ = [('original', _Data), ('diff', _Data), ('intervals', _Violations),
+                ('summary', _ViolationSummary), ('intervalsOnly', c_int), ('stopAtFirst', c_int)]
+
+
+class _ComparisonResult(Structure):
+    """Mapping of struct comparison_result (see data_structure.h)."""
+    _fields_ = [('lower', _Data), ('upper', _Data), ('errors', _ErrorReport)]
+
+
+class _Options(Structure):
+    """Mapping of struct options (see data_structure.h)."""
+    _fields_ = [('engine', c_int), ('nThreads', c_int), ('tubeCache', c_char_p),
+                ('memoryBudget', c_size_t), ('outputFormat', c_int), ('errorOutput', c_int),
+                ('skipInputs', c_int), ('gate', c_int)]
+
+
+# Values of engine (see enum engines in data_structure.h).
+_ENGINES = {'rectangle': 1, 'window': 2}
+
+# Values of outputFormat (see enum output_formats in data_structure.h).
+_OUTPUT_FORMATS = {'csv': 0, 'binary': 1, 'binary-compressed': 2}
+
+# Values of errorOutput (see enum error_outputs in data_structure.h).
+_ERROR_OUTPUTS = {'dense': 0, 'intervals': 1}
+
+# Return value of the library in gate mode if the test fails (see GATE_FAILED in compare.h).
+GATE_FAILED = 2
+
+# Header of the binary result files (see writeBinary.c).
+_BINARY_MAGIC = b'FUNNELB'  # null-padded to 8 bytes
+_BINARY_HEADER = [('magic', 'S8'), ('version', '<u4'), ('encoding', '<u4'), ('n', '<u8'),
+                  ('yOffset', '<u8'), ('xOffset', '<u8'), ('xSize', '<u8'), ('reserved', 'V16')]
+
+
+_LIB = None  # Library handle, loaded once by _load_lib.
+_LIB_LOCK = threading.Lock()
+
+
+def _load_lib():
+    """Load the funnel library and map the function arguments, once per process.
+
+    Returns:
+        ctypes.CDLL: library handle
+    """
+    global _LIB
+    with _LIB_LOCK:
+        if _LIB is None:
+            lib_path = _get_lib_path('funnel')
+            try:
+                lib = cdll.LoadLibrary(lib_path)
+            except Exception as e:
+                raise RuntimeError(
+                    "Could not load funnel library with this path: {}. {}".format(
+                        lib_path, e))
+            lib.compareAndReport.argtypes = [
+                POINTER(c_double),
+                POINTER(c_double),
+                c_size_t,
+                POINTER(c_double),
+                POINTER(c_double),
+                c_size_t,
+                c_char_p,
+                c_double,
+                c_double,
+                c_double,
+                c_double,
+                c_double,
+                c_double]
+            lib.compareAndReport.restype = c_int
+            lib.compareAndReportWithOptions.argtypes = lib.compareAndReport.argtypes + [POINTER(_Options)]
+            lib.compareAndReportWithOptions.restype = c_int
+            lib.compareAndReturn.argtypes = lib.compareAndReport.argtypes[:6] + [c_double] * 6 + [
+                POINTER(_Options),
+                POINTER(_ComparisonResult)]
+            lib.compareAndReturn.restype = c_int
+            lib.writeComparisonResult.argtypes = [c_char_p] + lib.compareAndReport.argtypes[:6] + [
+                POINTER(_ComparisonResult)]
+            lib.writeComparisonResult.restype = c_int
+            lib.writeComparisonResultInContext.argtypes = [c_void_p] + lib.writeComparisonResult.argtypes
+            lib.writeComparisonResultInContext.restype = c_int
+            lib.freeComparisonResult.argtypes = [POINTER(_ComparisonResult)]
+            lib.freeComparisonResult.restype = None
+            lib.readCSVColumns.argtypes = [c_char_p, c_int, POINTER(c_char_p), POINTER(c_int), c_size_t, c_int,
+                                           POINTER(_Data)]
+            lib.readCSVColumns.restype = c_int
+            lib.readCSVColumnsInContext.argtypes = [c_void_p] + lib.readCSVColumns.argtypes
+            lib.readCSVColumnsInContext.restype = c_int
+            lib.freeCSVColumns.argtypes = [POINTER(_Data), c_size_t]
+            lib.freeCSVColumns.restype = None
+            lib.readMatFile.argtypes = [c_char_p, POINTER(c_char_p), c_size_t, POINTER(_Data)]
+            lib.readMatFile.restype = c_int
+            lib.readMatFileInContext.argtypes = [c_void_p] + lib.readMatFile.argtypes
+            lib.readMatFileInContext.restype = c_int
+            lib.freeMatVariables.argtypes = [POINTER(_Data), c_size_t]
+            lib.freeMatVariables.restype = None
+            lib.getAllocationCount.argtypes = []
+            lib.getAllocationCount.restype = c_size_t
+            lib.getLiveAllocationCount.argtypes = []
+            lib.getLiveAllocationCount.restype = c_size_t
+            lib.createContext.argtypes = [POINTER(_Options)]
+            lib.createContext.restype = c_void_p
+            lib.freeContext.argtypes = [c_void_p]
+            lib.freeContext.restype = None
+            lib.setContextOptions.argtypes = [c_void_p, POINTER(_Options)]
+            lib.setContextOptions.restype = None
+            lib.getContextError.argtypes = [c_void_p]
+            lib.getContextError.restype = c_char_p
+            lib.compareInContext.argtypes = [c_void_p] + lib.compareAndReport.argtypes
+            lib.compareInContext.restype = c_int
+            lib.compareAndReturnInContext.argtypes = [c_void_p] + lib.compareAndReturn.argtypes[:12] + [
+                POINTER(_ComparisonResult)]
+            lib.compareAndReturnInContext.restype = c_int
+            _LIB = lib
+    return _LIB
+
+
+class _Context:
+    """Comparison context of the library (see context.h), freed with the object."""
+
+    def __init__(self, lib):
+        self.lib = lib
+        self.handle = lib.createContext(None)
+        if not self.handle:
+            raise MemoryError("Could not allocate the funnel comparison context.")
+
+    def __del__(self):
+        if getattr(self, 'handle', None):
+            self.lib.freeContext(self.handle)
+            self.handle = None
+
+    def error(self):
+        """Return the first error message of the last comparison, empty if none."""
+        return self.lib.getContextError(self.handle).decode('utf-8', 'replace')
+
+
+_CONTEXTS = threading.local()  # One context per thread, so that comparisons can run concurrently.
+
+
+def _get_context(lib):
+    """Get the comparison context of the calling thread, created on first use.
+
+    The context keeps its scratch memory from one comparison to the next, and is freed
+    when the thread ends.
+
+    Returns:
+        _Context: context of the calling thread
+    """
+    ctx = getattr(_CONTEXTS, 'ctx', None)
+    if ctx is None:
+        ctx = _Context(lib)
+        _CONTEXTS.ctx = ctx
+    return ctx
+
+
+def allocation_counts():
+    """Get the allocation counters of the funnel library.
+
+    All memory allocated by a comparison is freed before it returns, except the scratch
+    memory kept by the comparison context of the calling thread until the thread ends,
+    so that the number of live blocks does not grow when many comparisons are run in one process.
+
+    Returns:
+        dict: 'allocations', number of allocations made since the library was loaded,
+            and 'live', number of blocks not freed yet
+    """
+    lib = _load_lib()
+    return {'allocations': lib.getAllocationCount(), 'live': lib.getLiveAllocationCount()}
+
+
+def _as_c_array(values):
+    """Return a pointer to the float64 values of a list-like object, without copy if possible.
+
+    Contiguous float64 NumPy arrays (including memory-mapped arrays) and writable
+    buffer-protocol objects of C doubles (e.g. array.array('d')) are passed as is.
+    Other NumPy arrays and pandas objects with a numeric dtype are converted in one
+    vectorized step. Other list-like objects are converted element by element.
+
+    Args:
+        values (list-like of floats): values
+
+    Returns:
+        tuple: (pointer to the values, object holding the memory, number of values)
+    """
+    if np is not None and (isinstance(values, np.ndarray) or hasattr(values, '__array__')):
+        arr = np.asarray(values)
+        if arr.ndim == 1 and arr.dtype.kind in 'biuf':
+            arr = np.ascontiguousarray(arr, dtype=np.float64)  # No copy if already contiguous float64.
+            return arr.ctypes.data_as(POINTER(c_double)), arr, arr.shape[0]
+    else:
+        try:
+            view = memoryview(values)
+        except TypeError:
+            view = None
+        if view is not None and view.format == 'd' and view.ndim == 1 \
+                and view.c_contiguous and not view.readonly:
+            buf = (c_double * len(view)).from_buffer(view)
+            return cast(buf, POINTER(c_double)), view, len(view)
+    # Generic path: convert into a list (e.g. for lists or pd.Series with object dtype).
+    try:
+        values = list(values)
+    except Exception as e:
+        raise TypeError("Input data could not be converted into lists: {}".format(e))
+    num_check = [isinstance(x, numbers.Real) for x in values]
+    if not all(num_check):
+        raise TypeError("The following input values are not numeric: {}".format(
+            [x for x, ok in zip(values, num_check) if not ok]
+        ))
+    buf = array.array('d', values)
+    return cast((c_double * len(buf)).from_buffer(buf), POINTER(c_double)), buf, len(buf)
+
+
+def _check_tolerances(args):
+    """Return the tolerances passed as arguments, converted to float (None to 0).
+
+    Args:
+        args (dict): arguments including atolx, atoly, ltolx, ltoly, rtolx, rtoly
+
+    Returns:
+        dict: tolerances
+    """
+    tol = dict()
+    for k in ('atolx', 'atoly', 'ltolx', 'ltoly', 'rtolx', 'rtoly'):
+        if args[k] is None:
+            tol[k] = 0.0
+        else:
+            try:
+                tol[k] = float(args[k])
+            except BaseException:
+                raise TypeError("Tolerance {} could not be converted to float.".format(k))
+            if tol[k] < 0:
+                raise ValueError("Tolerance {} must be positive.".format(k))
+    return tol
+
+
 def compareAndReport(
     xReference,
     yReference,
@@ -195,12 +601,26 @@ def compareAndReport(
     ltolx=None,
     ltoly=None,
     rtolx=None,
-    rtoly=None
+    rtoly=None,
+    outputFormat='csv',
+    errorOutput='dense',
+    skipInputs=False,
+    gate=False,
+    memoryBudget=0,
+    engine='rectangle'
 ):
     """Run funnel binary with list-like objects as x, y reference and test values.
 
+    Contiguous float64 NumPy arrays (e.g. numpy.memmap) and buffer-protocol objects
+    of C doubles are passed to the library without copy.
+
     Output `errors.csv`, `lowerBound.csv`, `upperBound.csv`, `reference.csv`,
     `test.csv` into the output directory (`./results` by default).
+    With a binary output format, the files have the extension `.bin` instead,
+    and can be read with read_binary.
+    With errorOutput='intervals', `violations.csv` is written instead of `errors.csv`,
+    with one row `xStart,xEnd,peak,xPeak` per interval of consecutive test points
+    out of the tube (only the header if the test passes).
 
     Args:
         xReference (list-like of floats): x reference values
@@ -214,9 +634,28 @@ def compareAndReport(
         ltoly (float): relative tolerance along y axis (relatively to the local value)
         rtolx (float): relative tolerance along x axis (relatively to the range)
         rtoly (float): relative tolerance along y axis (relatively to the range)
+        outputFormat (str): format of output files, 'csv', 'binary' (little-endian float64 columns)
+            or 'binary-compressed' (same with losslessly compressed x columns)
+        errorOutput (str): output of the errors, 'dense' (error at each test point)
+            or 'intervals' (violation intervals only)
+        skipInputs (bool): if True, `reference` and `test` files are not written
+            (for inputs already on disk)
+        gate (bool): if True, the validation stops at the first test point out of the tube,
+            and the output files are written only if there is one (pass/fail gating)
+        memoryBudget (int): memory budget in bytes of the library, 0 for no budget: sorted inputs
+            larger than the budget are compared by windows, with the same output files
+            (e.g. for numpy.memmap inputs larger than the memory); the comparison fails if the tube
+            is too wide in x for the budget (a window spans at least 16 tube half-widths in x)
+        engine (str): tube construction engine, 'rectangle' or 'window' (sliding window minimum
+            and maximum, faster for wide tubes, requires ltolx = 0 and sorted reference x values;
+            the errors may differ at test points on the tube curves, see enum engines in data_structure.h)
 
     Returns:
-        None
+        int: status code, 0 if there was success, GATE_FAILED in gate mode if the test fails
+
+    Comparisons can be run concurrently from several threads: each thread uses its own
+    comparison context in the library, and errors are reported with the status code
+    (with a warning holding the log or the error message) instead of exiting.
 
     Full documentation at https://github.com/lbl-srg/funnel.
     """
@@ -228,42 +667,23 @@ def compareAndReport(
         outputDirectory = "results"
     assert isinstance(outputDirectory, str),\
         "Path of output directory is not a string type."
+    assert outputFormat in _OUTPUT_FORMATS,\
+        "Output format must be one of {}.".format(', '.join(_OUTPUT_FORMATS))
+    assert errorOutput in _ERROR_OUTPUTS,\
+        "Error output must be one of {}.".format(', '.join(_ERROR_OUTPUTS))
+    assert engine in _ENGINES,\
+        "Engine must be one of {}.".format(', '.join(_ENGINES))
     # Value
     assert len(xReference) == len(yReference),\
         "xReference and yReference must have the same length."
     assert len(xTest) == len(yTest),\
         "xTest and yTest must have the same length."
 
-    # Convert arrays into lists (to support np.array and pd.Series).
-    try:
-        xReference = list(xReference)
-        yReference = list(yReference)
-        xTest = list(xTest)
-        yTest = list(yTest)
-    except Exception as e:
-        raise TypeError("Input data could not be converted into lists: {}".format(e))
-    # Test numeric type.
-    all_data = xReference + yReference + xTest + yTest
-    num_check = [isinstance(x, numbers.Real) for x in all_data]
-    if not min(num_check):
-        idx = filter(lambda i: not num_check[i], range(len(num_check)))
-        raise TypeError("The following input values are not numeric: {}".format(
-            [all_data[i] for i in idx]
-        ))
+    # Get pointers to the values (to support lists, np.array and pd.Series), and test numeric type.
+    c_data = [_as_c_array(v) for v in (xReference, yReference, xTest, yTest)]
 
     # Convert None tolerance to 0.
-    tol = dict()
-    args = locals()
-    for k in ('atolx', 'atoly', 'ltolx', 'ltoly', 'rtolx', 'rtoly'):
-        if args[k] is None:
-            tol[k] = 0.0
-        else:
-            try:
-                tol[k] = float(args[k])
-            except BaseException:
-                raise TypeError("Tolerance {} could not be converted to float.".format(k))
-            if tol[k] < 0:
-                raise ValueError("Tolerance {} must be positive.".format(k))
+    tol = _check_tolerances(locals())
 
     # Configure log file path.
     log_path = os.path.join(outputDirectory, 'c_funnel.log')
@@ -272,59 +692,165 @@ def compareAndReport(
     outputDirectory = outputDirectory.encode('utf-8')
 
     # Load library.
-    lib_path = _get_lib_path('funnel')
-    try:
-        lib = cdll.LoadLibrary(lib_path)
-    except Exception as e:
-        raise RuntimeError(
-            "Could not load funnel library with this path: {}. {}".format(
-                lib_path, e))
-
-    # Map arguments.
-    lib.compareAndReport.argtypes = [
-        POINTER(c_double),
-        POINTER(c_double),
-        c_int,
-        POINTER(c_double),
-        POINTER(c_double),
-        c_int,
-        c_char_p,
-        c_double,
-        c_double,
-        c_double,
-        c_double,
-        c_double,
-        c_double]
-    lib.compareAndReport.restype = c_int
+    lib = _load_lib()
 
     # Run
+    args = [
+        c_data[0][0],
+        c_data[1][0],
+        c_data[0][2],
+        c_data[2][0],
+        c_data[3][0],
+        c_data[2][2],
+        outputDirectory,
+        tol['atolx'],
+        tol['atoly'],
+        tol['ltolx'],
+        tol['ltoly'],
+        tol['rtolx'],
+        tol['rtoly'],
+    ]
+    ctx = _get_context(lib)
+    options = _Options(engine=_ENGINES[engine],
+                       outputFormat=_OUTPUT_FORMATS[outputFormat],
+                       errorOutput=_ERROR_OUTPUTS[errorOutput],
+                       skipInputs=int(bool(skipInputs)),
+                       gate=int(bool(gate)),
+                       memoryBudget=int(memoryBudget))
     try:
-        retVal = lib.compareAndReport(
-            (c_double * len(xReference))(*xReference),
-            (c_double * len(yReference))(*yReference),
-            len(xReference),
-            (c_double * len(xTest))(*xTest),
-            (c_double * len(yTest))(*yTest),
-            len(xTest),
-            outputDirectory,
-            tol['atolx'],
-            tol['atoly'],
-            tol['ltolx'],
-            tol['ltoly'],
-            tol['rtolx'],
-            tol['rtoly'],
-        )
+        lib.setContextOptions(ctx.handle, byref(options))
+        retVal = lib.compareInContext(ctx.handle, *args)
     except Exception as e:
         raise RuntimeError("Library call raises exception: {}.".format(e))
-    if retVal != 0:
-        with open(log_path) as f:
-            c_stream = f.read()
+    c_stream = ctx.error()
+    if os.path.isfile(log_path):
+        if retVal != 0:
+            with open(log_path) as f:
+                c_stream = f.read() or c_stream
+        os.unlink(log_path)
+    if retVal != 0 and not (gate and retVal == GATE_FAILED):
         print("*** Warning: funnel binary status code is: {}.\n{}".format(retVal, c_stream))
-    os.unlink(log_path)
 
     return retVal
 
 
+def compareAndReturn(
+    xReference,
+    yReference,
+    xTest,
+    yTest,
+    outputDirectory=None,
+    atolx=None,
+    atoly=None,
+    ltolx=None,
+    ltoly=None,
+    rtolx=None,
+    rtoly=None,
+    errorOutput='dense',
+    engine='rectangle'
+):
+    """Run funnel binary with list-like objects as x, y reference and test values,
+    and return the results as NumPy arrays.
+
+    Output files are only written if an output directory is specified
+    (same files as compareAndReport, except the log file).
+
+    Args:
+        xReference (list-like of floats): x reference values
+        yReference (list-like of floats): y reference values
+        xTest (list-like of floats): x test values
+        yTest (list-like of floats): y test values
+        outputDirectory (str): path of directory to store output files, None for no output files
+        atolx, atoly, ltolx, ltoly, rtolx, rtoly (float): tolerances, see compareAndReport
+        errorOutput (str): 'dense', or 'intervals' to return the violation intervals only
+            (empty errors and violations)
+        engine (str): tube construction engine, 'rectangle' or 'window', see compareAndReport
+
+    Returns:
+        dict: tuples (x, y) of 1-D NumPy arrays with the keys
+            lowerBound: lower tube curve
+            upperBound: upper tube curve
+            errors: error at each test point (0 inside the tube)
+            violations: error at the test points out of the tube
+        and a 2-D NumPy array with the key
+            intervals: violation intervals, one row (xStart, xEnd, peak, xPeak)
+                per interval of consecutive test points out of the tube
+        and a dict with the key
+            summary: summary metrics computed in the validation pass, with the keys
+                nViolations (number of test points out of the tube), maxError (largest error),
+                xMaxError (x value of the largest error, NaN if none), firstViolation
+                (x value of the first test point out of the tube, NaN if none), integral
+                (integral of the error over x) and top (tuple (x, error) of NumPy arrays
+                with the 10 worst test points, by decreasing error)
+
+    Raises:
+        RuntimeError: if the funnel binary status code is not 0, with the error message
+            of the library (all messages are also printed to stderr)
+    """
+    if np is None:
+        raise ImportError("compareAndReturn requires NumPy.")
+    assert outputDirectory is None or isinstance(outputDirectory, str),\
+        "Path of output directory is not a string type."
+    assert errorOutput in _ERROR_OUTPUTS,\
+        "Error output must be one of {}.".format(', '.join(_ERROR_OUTPUTS))
+    assert engine in _ENGINES,\
+        "Engine must be one of {}.".format(', '.join(_ENGINES))
+    assert len(xReference) == len(yReference),\
+        "xReference and yReference must have the same length."
+    assert len(xTest) == len(yTest),\
+        "xTest and yTest must have the same length."
+
+    c_data = [_as_c_array(v) for v in (xReference, yReference, xTest, yTest)]
+    tol = _check_tolerances(locals())
+    lib = _load_lib()
+
+    ctx = _get_context(lib)
+    res = _ComparisonResult()
+    options = _Options(engine=_ENGINES[engine], errorOutput=_ERROR_OUTPUTS[errorOutput])
+    lib.setContextOptions(ctx.handle, byref(options))
+    retVal = lib.compareAndReturnInContext(
+        ctx.handle,
+        c_data[0][0], c_data[1][0], c_data[0][2],
+        c_data[2][0], c_data[3][0], c_data[2][2],
+        tol['atolx'], tol['atoly'], tol['ltolx'], tol['ltoly'], tol['rtolx'], tol['rtoly'],
+        byref(res))
+    if retVal != 0:
+        raise RuntimeError("funnel binary status code is: {}. {}".format(retVal, ctx.error()))
+    try:
+        if outputDirectory is not None:
+            retVal = lib.writeComparisonResultInContext(
+                ctx.handle,
+                outputDirectory.encode('utf-8'),
+                c_data[0][0], c_data[1][0], c_data[0][2],
+                c_data[2][0], c_data[3][0], c_data[2][2],
+                byref(res))
+            if retVal != 0:
+                raise RuntimeError("funnel binary status code is: {}. {}".format(retVal, ctx.error()))
+
+        def to_numpy(dat):
+            if dat.n == 0:
+                return np.empty(0), np.empty(0)
+            return (np.ctypeslib.as_array(dat.x, shape=(dat.n,)).copy(),
+                    np.ctypeslib.as_array(dat.y, shape=(dat.n,)).copy())
+
+        intervals = np.empty((0, 4))
+        if res.errors.intervals.n > 0:
+            intervals = np.ctypeslib.as_array(
+                cast(res.errors.intervals.intervals, POINTER(c_double)),
+                shape=(res.errors.intervals.n, 4)).copy()
+
+        return dict(
+            lowerBound=to_numpy(res.lower),
+            upperBound=to_numpy(res.upper),
+            errors=to_numpy(res.errors.diff),
+            violations=to_numpy(res.errors.original),
+            intervals=intervals,
+            summary=res.errors.summary.to_dict(),
+        )
+    finally:
+        lib.freeComparisonResult(byref(res))
+
+
 #####################
 # Class definitions #
 #####################
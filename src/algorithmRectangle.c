@@ -6,18 +6,16 @@
  *
  * Functions:
  * ----------
- *   createNode: creates new linked list node
- *   addNode: add node to a existing linked list at end
- *   listLen: find length of linked list
- *   getNth: find value of specific node in linked list
- *   getListValues: find values at all the nodes of linked list
- *   lastNodeDeletion: delete last node of the linked list
- *   calculateLower: find the data set of lower tube curve
- *   calculateUpper: find the data set of upper tube curve
+ *   createBuffer: creates new point buffer with fixed capacity
+ *   pushPoint: append point at the end of the buffer
+ *   lastY: find y value of a point counted from the end of the buffer
+ *   popPoint: delete last point of the buffer
+ *   addCorners: add the corner points of the rectangle around a reference point
+ *   removeFlatCorners: remove the last added points in case of zero slope of tube curve
+ *   getTube: find the data sets of lower and upper tube curves in a single pass
+ *   getLower: find the data set of lower tube curve
+ *   getUpper: find the data set of upper tube curve
  *   removeLoop: remove points and add intersection points in case of backward order
- *   removeRange: remove a range of elements from array
- *   removeAt: remove element at the specified index from array
- *   insertAt: insert element into the array at the specified index
  */
 
 #include <stdio.h>
@@ -27,6 +25,7 @@
 #include "stdbool.h"
 
 #include "data_structure.h"
+#include "memory.h"
 #include "algorithmRectangle.h"
 #include "tubeSize.h"
 
@@ -44,159 +43,77 @@
 
 
 /*
- * Function: createNode
- * --------------------
- *   creates new linked list node
- */
-node_t * createNode(void) {
-  node_t* temp;
-  temp = malloc(sizeof(node_t));
-  if (temp == NULL){
-	  fputs("Error: Failed to allocate memory for temp.\n", stderr);
-    exit(1);
-  }
-  temp->next = NULL;
-  return temp;
-}
-
-/*
- * Function: addNode
- * -----------------
- *   add node to a existing linked list at end
+ * Function: createBuffer
+ * ----------------------
+ *   creates new point buffer with storage for a fixed number of points
  *
- *   head: original linked list to add additional node at end
- *   newVal: value of the additional node
+ *   capacity: maximum number of points the buffer can hold
  *
- *   return: new linked list that have an additional node
+ *   return: empty point buffer (with status set to -1 and no storage
+ *           if the memory cannot be allocated)
  */
-node_t * addNode(node_t* head, double newVal) {
-  node_t* temp;
-  node_t* p;
-  // create additional node
-  temp = createNode();
-  temp->val = newVal;
-
-  if (head == NULL) {
-    head = temp;
-  } else {
-    p = head;
-    while (p->next != NULL) {
-      p = p->next;
-    }
-    p->next = temp;
+point_buffer_t createBuffer(size_t capacity) {
+  point_buffer_t buf;
+  buf.x = allocateMemory(capacity * sizeof(double));
+  buf.y = allocateMemory(capacity * sizeof(double));
+  buf.n = 0;
+  buf.capacity = capacity;
+  buf.status = 0;
+  if ((buf.x == NULL) || (buf.y == NULL)){
+    freeMemory(buf.x);
+    freeMemory(buf.y);
+    buf.x = NULL;
+    buf.y = NULL;
+    buf.capacity = 0;
+    buf.status = -1;
   }
-  return head;
+  return buf;
 }
 
 /*
- * Function: listLen
- * -----------------
- *   find length of linked list
+ * Function: pushPoint
+ * -------------------
+ *   append point at the end of the buffer
+ *   (the point is dropped and the status of the buffer set to -1 if the buffer is full)
  *
- *   head: linked list
- *
- *   return: number of nodes in the linked list
+ *   buf: point buffer
+ *   x: x value of the point
+ *   y: y value of the point
  */
-int listLen(node_t* head) {
-  int count = 0;
-  node_t* current = head;  // Initialize current
-  while (current != NULL) {
-    count = count+1;
-    current = current->next;
+void pushPoint(point_buffer_t* buf, double x, double y) {
+  if (buf->n == buf->capacity) {
+    buf->status = -1;
+    return;
   }
-  return count;
+  buf->x[buf->n] = x;
+  buf->y[buf->n] = y;
+  buf->n = buf->n+1;
 }
 
 /*
- * Function: getNth
- * ----------------
- *   find value of specific node in linked list
+ * Function: lastY
+ * ---------------
+ *   find y value of a point counted from the end of the buffer
  *
- *   head: linked list
- *   index: zero-based index at which node its value will be output
+ *   buf: point buffer
+ *   k: zero-based index counted from the last point (0 is the last point)
  *
- *   return: value of Nth node of lined list
+ *   return: y value of the (k+1)th last point
  */
-double getNth(node_t* head, int index) {
-    node_t* current = head;
-    int count = 0; // the index of the node we're currently looking at
-    while (current != NULL) {
-       if (count == index)
-         break;
-       count = count+1;
-       current = current->next;
-    }
-    return current->val;
+double lastY(point_buffer_t* buf, size_t k) {
+  return buf->y[buf->n - 1 - k];
 }
 
 /*
- * Function: getListValues
- * -----------------------
- *   find values at all the nodes of linked list
- *
- *   head: linked list
- *
- *   return: data array storing values of linked list
- */
-double * getListValues(node_t* head) {
-  int size = 1;
-  double *value = malloc(sizeof(double) * size);
-  if (value == NULL){
-	  fputs("Error: Failed to allocate memory for value.\n", stderr);
-    exit(1);
-  }
-  memset(value,0,sizeof(double)*size);
-
-  node_t* current = head;
-  int count = 0;
-  while (current != NULL) {
-    value[count] = current->val;
-    if (count+1 == size) {
-      /* need more space */
-      size += 10;
-      double *value_tmp = realloc(value, sizeof(double)*size);
-      if (value_tmp == NULL) {
-        fputs("Fatal error -- out of memory!\n", stderr);
-        exit(1);
-      }
-      value = value_tmp;
-    }
-    count = count+1;
-    current = current->next;
-  }
-  return value;
-}
-
-/*
- * Function: lastNodeDeletion
- * --------------------------
- *   delete last node of the linked list
+ * Function: popPoint
+ * ------------------
+ *   delete last point of the buffer (nothing is done if the buffer is empty)
  *
- *   head: linked list
+ *   buf: point buffer
  */
-void lastNodeDeletion(node_t* head) {
-  node_t* toDelLast;
-  node_t* preNode;
-    if(head == NULL) {
-        printf("There is no element in the list.");
-    } else {
-      toDelLast = head;
-        preNode = head;
-        /* Traverse to the last node of the list */
-        while(toDelLast->next != NULL) {
-            preNode = toDelLast;
-            toDelLast = toDelLast->next;
-        }
-        if(toDelLast == head) {
-          /* If there is only one item in the list, remove it */
-            head = NULL;
-        } else {
-            /* Disconnects the link of second last node with last node */
-            preNode->next = NULL;
-        }
-        /* Delete the last node */
-        if (toDelLast != NULL) free(toDelLast);
-    }
+void popPoint(point_buffer_t* buf) {
+  if (buf->n > 0)
+    buf->n = buf->n-1;
 }
 
 /* Normalize variable array by variable magnitude */
@@ -222,38 +139,115 @@ void denormalize(double *var, size_t length, double var_mag) {
 }
 
 /*
- * Function: setLower
- * ------------------------
- *   find the data set of lower tube curve
+ * Function: addCorners
+ * --------------------
+ *   add the corner points of the rectangle around a reference point
+ *   to the lower tube curve; the same rule applies to the upper tube curve
+ *   when the signs of the slopes are reversed
+ *
+ *   buf: point buffer of the tube curve
+ *   s0: sign of slope of reference curve before the point
+ *   s1: sign of slope of reference curve after the point
+ *   xLeft: x value of the left corners of the rectangle
+ *   xRight: x value of the right corners of the rectangle
+ *   y: y value of the corners of the rectangle on the side of the tube curve
+ */
+static void addCorners(point_buffer_t* buf, double s0, double s1, double xLeft, double xRight, double y) {
+  if (!equ(s0, -1) && !equ(s1, -1)) {
+    // add right point
+    pushPoint(buf, xRight, y);
+  } else if (!equ(s0, 1) && !equ(s1, 1)) {
+    // add left point
+    pushPoint(buf, xLeft, y);
+  } else if (equ(s0, -1) && equ(s1, 1)) {
+    // add left point
+    pushPoint(buf, xLeft, y);
+    // add right point
+    pushPoint(buf, xRight, y);
+  } else if (equ(s0, 1) && equ(s1, -1)) {
+    // add right point
+    pushPoint(buf, xRight, y);
+    // add left point
+    pushPoint(buf, xLeft, y);
+  }
+}
+
+/*
+ * Function: removeFlatCorners
+ * ---------------------------
+ *   remove the last added points in case of zero slope of tube curve
+ *
+ *   buf: point buffer of the tube curve
+ *   s0: sign of slope of reference curve before the point
+ *   s1: sign of slope of reference curve after the point
+ *   yNext: y value of the corners of the next rectangle on the side of the tube curve
+ */
+static void removeFlatCorners(point_buffer_t* buf, double s0, double s1, double yNext) {
+  if equ(yNext, lastY(buf, 0)) {
+    if (equ(s0 * s1, -1) && equ(lastY(buf, 2), lastY(buf, 0))) {
+      // remove two points, if two points were added at last
+      // (n-3 >= 0, because start point + two added points)
+      popPoint(buf);
+      popPoint(buf);
+    } else if (!equ(s0 * s1, -1) && equ(lastY(buf, 1), lastY(buf, 0))) {
+      // remove one point, if one point was added at last
+      // (n-2 >= 0, because start point + one added point)
+      popPoint(buf);
+    }
+  }
+}
+
+/*
+ * Function: getTube
+ * -----------------
+ *   find the data sets of lower and upper tube curves in a single pass over the reference
  *
  *   reference: pointer to reference data struct
  *   tube_size: pointer to tube_size struct
+ *   dat_char: data characteristics of the reference, see get_data_char
+ *   lower: pointer to data struct receiving the lower curve of the tube
+ *   upper: pointer to data struct receiving the upper curve of the tube
  *
- *   return : data struct defining lower curve of the tube
+ *   return: 0 if there was success, -1 if the memory cannot be allocated
+ *           or a loop cannot be removed (both curves are then empty)
  */
-struct data getLower(struct data *reference, struct data *tube_size) {
-  struct data lower;
-  node_t *lx = NULL;
-  node_t *ly = NULL;
+int getTube(struct data *reference, struct data *tube_size, struct data_char dat_char,
+  struct data *lower, struct data *upper) {
   size_t i, b;
+  size_t e = reference->n-1;
 
   /* Normalize values and tube size in x direction.
    * This was introduced in https://github.com/lbl-srg/funnel/pull/30
    * to guard against vanishing derivatives (dy/dx) for x values with a large order of magnitude.
    */
 
-  struct data_char dat_char = get_data_char(reference);                   // Data characteristics
-  double *x_norm = (double *)malloc(sizeof(double) * reference->n);       // Normalized x values
-  double *tube_x_norm = (double *)malloc(sizeof(double) * tube_size->n);  // Normalized tube size in x direction
+  double *x_norm = (double *)allocateMemory(sizeof(double) * reference->n);       // Normalized x values
+  double *tube_x_norm = (double *)allocateMemory(sizeof(double) * tube_size->n);  // Normalized tube size in x direction
+  *lower = (struct data){NULL, NULL, 0};
+  *upper = (struct data){NULL, NULL, 0};
   if ((x_norm == NULL) || (tube_x_norm == NULL)){
-	  fputs("Error: Failed to allocate memory for x_norm or tube_x_norm.\n", stderr);
-    exit(1);
+    freeMemory(x_norm);
+    freeMemory(tube_x_norm);
+    return -1;
   }
   memcpy(x_norm, reference->x, sizeof(double) * reference->n);
   memcpy(tube_x_norm, tube_size->x, sizeof(double) * tube_size->n);
   normalize(x_norm, reference->n, dat_char.mag_x);
   normalize(tube_x_norm, tube_size->n, dat_char.mag_x);
 
+  // Each reference point contributes at most two corner points to each curve.
+  point_buffer_t lb = createBuffer(2 * reference->n);
+  point_buffer_t ub = createBuffer(2 * reference->n);
+  if ((lb.status != 0) || (ub.status != 0)) {
+    freeMemory(lb.x);
+    freeMemory(lb.y);
+    freeMemory(ub.x);
+    freeMemory(ub.y);
+    freeMemory(x_norm);
+    freeMemory(tube_x_norm);
+    return -1;
+  }
+
   // ===== 1. add corner points of the rectangle =====
   double m0, m1; // slopes before and after point i of reference curve
   double s0, s1; // sign of slopes of reference curve: 1 - increasing, 0 - constant, -1 - decreasing
@@ -266,624 +260,334 @@ struct data getLower(struct data *reference, struct data *tube_size) {
     b = b+1;
   }
 
-  // add down left point
-  lx = addNode(lx,(x_norm[b] - tube_x_norm[b]));
-  ly = addNode(ly, (reference->y[b] - tube_size->y[b]));
+  // add down left and top left points
+  pushPoint(&lb, (x_norm[b] - tube_x_norm[b]), (reference->y[b] - tube_size->y[b]));
+  pushPoint(&ub, (x_norm[b] - tube_x_norm[b]), (reference->y[b] + tube_size->y[b]));
 
   if (b+1 < reference->n) {
-  	  // slopes of reference curve (initialization)
-  	  s0 = sign(reference->y[b+1] - reference->y[b]);
-  	  if (!equ(x_norm[b+1], x_norm[b])) {
-  		  m0 = (reference->y[b+1] - reference->y[b]) / (x_norm[b+1] - x_norm[b]);
-  	  } else {
-  		  m0 = (s0>0) ? 1e+15 : -1e+15;
-  	  }
-  	  if equ(s0, 1) {
-  		  // add down right point
-  		  lx = addNode(lx,(x_norm[b] + tube_x_norm[b]));
-  		  ly = addNode(ly, (reference->y[b] - tube_size->y[b]));
-  	  }
-
-  	  // ----- 1.2 Iteration: rectangle with center (x,y) = (reference->x[i], reference->y[i]) -----
-  	  for (i = b+1; i < reference->n-1; i++) {
-  		  // ignore identical points
-  		  if (equ(x_norm[i], x_norm[i+1]) && equ(reference->y[i], reference->y[i+1]))
-  			  continue;
-
-  		  // slopes of reference curve
-  		  s1 = sign(reference->y[i+1] - reference->y[i]);
-  		  if (!equ(x_norm[i+1], x_norm[i])) {
-  			  m1 = (reference->y[i+1] - reference->y[i]) / (x_norm[i+1] - x_norm[i]);
-  		  } else {
-  			  m1 = (s1>0) ? (1e+15) : (-1e+15);
-  		  }
-
-  		  // add no point for equal slopes of reference curve
-  		  if (!equ(m0, m1)) {
-  			  if (!equ(s0, -1) && !equ(s1, -1)) {
-  				  // add down right point
-  				  lx = addNode(lx, (x_norm[i] + tube_x_norm[i]));
-  				  ly = addNode(ly, (reference->y[i] - tube_size->y[i]));
-  			  } else if (!equ(s0, 1) && !equ(s1, 1)) {
-  				  // add down left point
-  				  lx = addNode(lx, (x_norm[i] - tube_x_norm[i]));
-  				  ly = addNode(ly, (reference->y[i] - tube_size->y[i]));
-  			  } else if (equ(s0, -1) && equ(s1, 1)) {
-  				  // add down left point
-  				  lx = addNode(lx, (x_norm[i] - tube_x_norm[i]));
-  				  ly = addNode(ly, (reference->y[i] - tube_size->y[i]));
-  				  // add down right point
-  				  lx = addNode(lx, (x_norm[i] + tube_x_norm[i]));
-  				  ly = addNode(ly, (reference->y[i] - tube_size->y[i]));
-  			  } else if (equ(s0, 1) && equ(s1, -1)) {
-  				  // add down right point
-  				  lx = addNode(lx, (x_norm[i] + tube_x_norm[i]));
-  				  ly = addNode(ly, (reference->y[i] - tube_size->y[i]));
-  				  // add down left point
-  				  lx = addNode(lx, (x_norm[i] - tube_x_norm[i]));
-  				  ly = addNode(ly, (reference->y[i] - tube_size->y[i]));
-  			  }
-
-  			  int len = listLen(ly);
-  			  double lastY = getNth(ly, len-1);
-  			  // remove the last added points in case of zero slope of tube curve
-  			  if equ((reference->y[i+1] - tube_size->y[i+1]), lastY) {
-  				  if (equ(s0 * s1, -1) && equ(getNth(ly, len-3), lastY)) {
-  					  // remove two points, if two points were added at last
-  					  // ((len-1) - 2 >= 0, because start point + two added points)
-  					  lastNodeDeletion(lx);
-  					  lastNodeDeletion(ly);
-  					  lastNodeDeletion(lx);
-  					  lastNodeDeletion(ly);
-  				  } else if (!equ(s0 * s1, -1) && equ(getNth(ly, len-2), lastY)) {
-  					  // remove one point, if one point was added at last
-  					  // ((len-1) - 1 >= 0, because start point + one added point)
-  					  lastNodeDeletion(lx);
-  					  lastNodeDeletion(ly);
-  				  }
-  			  }
-  		  }
-  		  s0 = s1;
-  		  m0 = m1;
-  	  }
-  	  // ----- 1.3. End: Rectangle with center (x,y) = (reference->x[reference->n - 1], reference->y[reference->n - 1]) -----
-  	  if equ(s0, -1) {
-  		  // add down left point
-  		  lx = addNode(lx, (x_norm[reference->n-1] - tube_x_norm[reference->n-1]));
-  		  ly = addNode(ly, (reference->y[reference->n-1] - tube_size->y[reference->n-1]));
-  	  }
+    // slopes of reference curve (initialization)
+    s0 = sign(reference->y[b+1] - reference->y[b]);
+    if (!equ(x_norm[b+1], x_norm[b])) {
+      m0 = (reference->y[b+1] - reference->y[b]) / (x_norm[b+1] - x_norm[b]);
+    } else {
+      m0 = (s0>0) ? 1e+15 : -1e+15;
+    }
+    if equ(s0, 1) {
+      // add down right point
+      pushPoint(&lb, (x_norm[b] + tube_x_norm[b]), (reference->y[b] - tube_size->y[b]));
+    }
+    if equ(s0, -1) {
+      // add top right point
+      pushPoint(&ub, (x_norm[b] + tube_x_norm[b]), (reference->y[b] + tube_size->y[b]));
+    }
+
+    // ----- 1.2 Iteration: rectangle with center (x,y) = (x_norm[i], reference->y[i]) -----
+    for (i = b+1; i < e; i++) {
+      // ignore identical points
+      if (equ(x_norm[i], x_norm[i+1]) && equ(reference->y[i], reference->y[i+1]))
+        continue;
+
+      // slopes of reference curve
+      s1 = sign(reference->y[i+1] - reference->y[i]);
+      if (!equ(x_norm[i+1], x_norm[i])) {
+        m1 = (reference->y[i+1] - reference->y[i]) / (x_norm[i+1] - x_norm[i]);
+      } else {
+        m1 = (s1>0) ? (1e+15) : (-1e+15);
+      }
+
+      // add no point for equal slopes of reference curve
+      if (!equ(m0, m1)) {
+        addCorners(&lb, s0, s1,
+          x_norm[i] - tube_x_norm[i], x_norm[i] + tube_x_norm[i], reference->y[i] - tube_size->y[i]);
+        removeFlatCorners(&lb, s0, s1, reference->y[i+1] - tube_size->y[i+1]);
+        addCorners(&ub, -s0, -s1,
+          x_norm[i] - tube_x_norm[i], x_norm[i] + tube_x_norm[i], reference->y[i] + tube_size->y[i]);
+        removeFlatCorners(&ub, s0, s1, reference->y[i+1] + tube_size->y[i+1]);
+      }
+      s0 = s1;
+      m0 = m1;
+    }
+    // ----- 1.3. End: Rectangle with center (x,y) = (x_norm[e], reference->y[e]) -----
+    if equ(s0, -1) {
+      // add down left point
+      pushPoint(&lb, (x_norm[e] - tube_x_norm[e]), (reference->y[e] - tube_size->y[e]));
+    }
+    if equ(s0, 1) {
+      // add top left point
+      pushPoint(&ub, (x_norm[e] - tube_x_norm[e]), (reference->y[e] + tube_size->y[e]));
+    }
   }
-  // add down right point
-  lx = addNode(lx, (x_norm[reference->n-1] + tube_x_norm[reference->n-1]));
-  ly = addNode(ly, (reference->y[reference->n-1] - tube_size->y[reference->n-1]));
+  // add down right and top right points
+  pushPoint(&lb, (x_norm[e] + tube_x_norm[e]), (reference->y[e] - tube_size->y[e]));
+  pushPoint(&ub, (x_norm[e] + tube_x_norm[e]), (reference->y[e] + tube_size->y[e]));
 
   // ===== 2. Remove points and add intersection points in case of backward order =====
-  int lisLen = listLen(ly);
-  double* tempLX = malloc(lisLen * sizeof(double));
-  if (tempLX == NULL){
-  	  fputs("Error: Failed to allocate memory for tempLX.\n", stderr);
-      exit(1);
+  int retVal = (lb.status != 0 || ub.status != 0) ? -1 : 0;
+  if (retVal == 0) {
+    *lower = removeLoop(lb.x, lb.y, lb.n, -1);
+    *upper = removeLoop(ub.x, ub.y, ub.n, 1);
+    if (lower->n == 0 || upper->n == 0)
+      retVal = -1;
   }
-  double* tempLY = malloc(lisLen * sizeof(double));
-  if (tempLY == NULL){
-  	  fputs("Error: Failed to allocate memory for tempLY.\n", stderr);
-      exit(1);
+  if (retVal == 0) {
+    denormalize(lower->x, lower->n, dat_char.mag_x);
+    denormalize(upper->x, upper->n, dat_char.mag_x);
+  } else {
+    freeMemory(lb.x);
+    freeMemory(lb.y);
+    freeMemory(ub.x);
+    freeMemory(ub.y);
+    *lower = (struct data){NULL, NULL, 0};
+    *upper = (struct data){NULL, NULL, 0};
   }
 
-  tempLX = getListValues(lx);
-  tempLY = getListValues(ly);
-  lower = removeLoop(tempLX, tempLY, lisLen, -1);
-  denormalize(lower.x, lower.n, dat_char.mag_x);
-
   // Free the memory.
-  if (x_norm != NULL) free(x_norm);
-  if (tube_x_norm != NULL) free(tube_x_norm);
+  freeMemory(x_norm);
+  freeMemory(tube_x_norm);
+  return retVal;
+}
 
+/*
+ * Function: getLower
+ * ------------------
+ *   find the data set of lower tube curve
+ *
+ *   reference: pointer to reference data struct
+ *   tube_size: pointer to tube_size struct
+ *
+ *   return : data struct defining lower curve of the tube (empty if there was no success)
+ */
+struct data getLower(struct data *reference, struct data *tube_size) {
+  struct data lower, upper;
+  getTube(reference, tube_size, get_data_char(reference), &lower, &upper);
+  freeMemory(upper.x);
+  freeMemory(upper.y);
   return lower;
 }
 
-
 /*
- * Function: setUpper
- * ------------------------
+ * Function: getUpper
+ * ------------------
  *   find the data set of upper tube curve
  *
  *   reference: reference data curve
  *   tube_size: struct specifying tube size
  *
- *   return : data set defining upper curve of the tube
+ *   return : data set defining upper curve of the tube (empty if there was no success)
  */
 struct data getUpper(struct data *reference, struct data *tube_size) {
-  struct data upper;
-  node_t *ux = NULL;
-  node_t *uy = NULL;
-  size_t i, b;
-
-  /* Normalize values and tube size in x direction.
-   * This was introduced in https://github.com/lbl-srg/funnel/pull/30
-   * to guard against vanishing derivatives (dy/dx) for x values with a large order of magnitude.
-   */
-
-  struct data_char dat_char = get_data_char(reference);                   // Data characteristics
-  double *x_norm = (double *)malloc(sizeof(double) * reference->n);       // Normalized x values
-  double *tube_x_norm = (double *)malloc(sizeof(double) * tube_size->n);  // Normalized tube size in x direction
-  if ((x_norm == NULL) || (tube_x_norm == NULL)){
-	  fputs("Error: Failed to allocate memory for x_norm or tube_x_norm.\n", stderr);
-    exit(1);
-  }
-  memcpy(x_norm, reference->x, sizeof(double) * reference->n);
-  memcpy(tube_x_norm, tube_size->x, sizeof(double) * tube_size->n);
-  normalize(x_norm, reference->n, dat_char.mag_x);
-  normalize(tube_x_norm, tube_size->n, dat_char.mag_x);
-
-  // ===== 1. add corner points of the rectangle =====
-  double m0, m1; // slopes before and after point i of reference curve
-  double s0, s1; // sign of slopes of reference curve: 1 - increasing, 0 - constant, -1 - decreasing
-
-  // ----- 1.1 Start: rectangle with center (x,y) = (reference->x[0], reference->y[0]) -----
-  // ignore identical point at the beginning
-  b = 0;
-  while (((b+1)< reference->n) && equ(x_norm[b], x_norm[b+1]) && equ(reference->y[b], reference->y[b+1]))
-  {
-    b = b+1;
-  }
-  // add top left point
-  ux = addNode(ux,(x_norm[b] - tube_x_norm[b]));
-  uy = addNode(uy, (reference->y[b] + tube_size->y[b]));
-
-  if (b+1 < reference->n) {
-	  // slopes of reference curve (initialization)
-	  s0 = sign(reference->y[b+1] - reference->y[b]);
-	  if (!equ(x_norm[b+1], x_norm[b])) {
-		  m0 = (reference->y[b+1] - reference->y[b]) / (x_norm[b+1] - x_norm[b]);
-	  } else {
-		  m0 = (s0>0) ? 1e+15 : -1e+15;
-	  }
-	  if equ(s0, -1) {
-		  // add top right point
-		  ux = addNode(ux, (x_norm[b] + tube_x_norm[b]));
-		  uy = addNode(uy, (reference->y[b] + tube_size->y[b]));
-	  }
-
-	  // ----- 1.2 Iteration: rectangle with center (x,y) = (x_norm[i], reference->y[i]) -----
-	  for (i = b+1; i < reference->n-1; i++) {
-		  // ignore identical points
-		  if (equ(x_norm[i], x_norm[i+1]) && equ(reference->y[i], reference->y[i+1]))
-			  continue;
-
-		  // slopes of reference curve
-		  s1 = sign(reference->y[i+1] - reference->y[i]);
-		  if (!equ(x_norm[i+1], x_norm[i])) {
-			  m1 = (reference->y[i+1] - reference->y[i]) / (x_norm[i+1] - x_norm[i]);
-		  } else {
-			  m1 = (s1>0) ? (1e+15) : (-1e+15);
-		  }
-
-		  // add no point for equal slopes of reference curve
-		  if (!equ(m0, m1)) {
-			  if (!equ(s0, -1) && !equ(s1, -1)) {
-				  // add top left point
-				  ux = addNode(ux, (x_norm[i] - tube_x_norm[i]));
-				  uy = addNode(uy, (reference->y[i] + tube_size->y[i]));
-			  } else if (!equ(s0, 1) && !equ(s1, 1)) {
-				  // add top right point
-				  ux = addNode(ux, (x_norm[i] + tube_x_norm[i]));
-				  uy = addNode(uy, (reference->y[i] + tube_size->y[i]));
-			  } else if (equ(s0, 1) && equ(s1, -1)) {
-				  // add top left point
-				  ux = addNode(ux, (x_norm[i] - tube_x_norm[i]));
-				  uy = addNode(uy, (reference->y[i] + tube_size->y[i]));
-				  // add top right point
-				  ux = addNode(ux, (x_norm[i] + tube_x_norm[i]));
-				  uy = addNode(uy, (reference->y[i] + tube_size->y[i]));
-			  } else if (equ(s0, -1) && equ(s1, 1)) {
-				  // add top right point
-				  ux = addNode(ux, (x_norm[i] + tube_x_norm[i]));
-				  uy = addNode(uy, (reference->y[i] + tube_size->y[i]));
-				  // add top left point
-				  ux = addNode(ux, (x_norm[i] - tube_x_norm[i]));
-				  uy = addNode(uy, (reference->y[i] + tube_size->y[i]));
-			  }
-
-			  int len = listLen(uy);
-			  double lastY = getNth(uy, len-1);
-			  // remove the last added points in case of zero slope of tube curve
-			  if equ((reference->y[i+1] + tube_size->y[i+1]), lastY) {
-				  if (equ(s0 * s1, -1) && equ(getNth(uy, len-3), lastY)) {
-					  // remove two points, if two points were added at last
-					  // ((len-1) - 2 >= 0, because start point + two added points)
-					  lastNodeDeletion(ux);
-					  lastNodeDeletion(uy);
-					  lastNodeDeletion(ux);
-					  lastNodeDeletion(uy);
-				  } else if (!equ(s0 * s1, -1) && equ(getNth(uy, len-2), lastY)) {
-					  // remove one point, if one point was added at last
-					  // ((len-1) - 1 >= 0, because start point + one added point)
-					  lastNodeDeletion(ux);
-					  lastNodeDeletion(uy);
-				  }
-			  }
-		  }
-		  s0 = s1;
-		  m0 = m1;
-	  }
-	  // ----- 1.3. End: Rectangle with center (x,y) = (x_norm[reference->n - 1], reference->y[reference->n - 1]) -----
-	  if equ(s0, 1) {
-		  // add top left point
-		  ux = addNode(ux, (x_norm[reference->n-1] - tube_x_norm[reference->n-1]));
-		  uy = addNode(uy, (reference->y[reference->n-1] + tube_size->y[reference->n-1]));
-	  }
-  }
-  // add top right point
-  ux = addNode(ux, (x_norm[reference->n-1] + tube_x_norm[reference->n-1]));
-  uy = addNode(uy, (reference->y[reference->n-1] + tube_size->y[reference->n-1]));
-
-  // ===== 2. Remove points and add intersection points in case of backward order =====
-  int lisLen = listLen(uy);
-  double* tempUX = malloc(lisLen * sizeof(double));
-  if (tempUX == NULL){
-	  fputs("Error: Failed to allocate memory for tempUX.\n", stderr);
-      exit(1);
-  }
-  double* tempUY = malloc(lisLen * sizeof(double));
-  if (tempUY == NULL){
-  	  fputs("Error: Failed to allocate memory for tempUY.\n", stderr);
-      exit(1);
-  }
-
-  tempUX = getListValues(ux);
-  tempUY = getListValues(uy);
-  upper = removeLoop(tempUX, tempUY, lisLen, 1);
-  denormalize(upper.x, upper.n, dat_char.mag_x);
-
-  // Free the memory.
-  if (x_norm != NULL) free(x_norm);
-  if (tube_x_norm != NULL) free(tube_x_norm);
-
+  struct data lower, upper;
+  getTube(reference, tube_size, get_data_char(reference), &lower, &upper);
+  freeMemory(lower.x);
+  freeMemory(lower.y);
   return upper;
 }
 
- /*
-  * Function: removeLoop
-  * --------------------
-  *   remove points and add intersection points in case of backward order
-  *
-  *   X: x values of curve
-  *   Y: y values of curve
-  *   size: size of curve array
-  *   curInd: if equals to 1, algorithms for upper tube curve is used,
-  *           if equals to -1, algorithms for lower tube curve is used
-  *
-  *   return: data structure including updated curve data sets (X, Y, size)
-  */
- struct data removeLoop(double* X, double* Y, int size, int curInd) {
-   struct data output;
-   int j = 1;
-   int countLoops = 0;
-   int re_size = size;
-
-   while (j < re_size -2) {
-     // Find backward segment (j, j+1)
-     if (X[j+1] < X[j]) {
-
-       countLoops = countLoops + 1;
-       // ===== 1. Find i, k, such that i <= j<j+1 <= k-1 and segment (i-1, i) intersect segment (k-1, k) =====
-       int i, k, iPrevious;
-       double y;
-       // for calculation and adding of intersection point
-       bool addPoint = true;
-       double ix = 0;
-       double iy = 0;
-       int kMax;
-
-       i = j;
-       iPrevious = i;
-
-       // Find initial value for i = i_s, such that X[i_s-1]  <= X[j+1] < X[i_s]
-       // it holds: i element of interval (i_s, j)
-       while (X[j+1] < X[i-1])
-         i = i-1;
-       // j+1 < k <= kMax
-       kMax = j+1;
-       while (X[kMax] < X[j] && kMax < re_size-1)  //=============================re_size
-         kMax = kMax+1;
-
-       // initial value for k
-       k = j+1;
-       y = Y[i-1];
-
-       // Find k
-       while (((curInd==-1 && y < Y[k]) || (curInd==1 && Y[k] < y))
-           && k < kMax) {
-         iPrevious = i;
-         k = k+1;
-         while ((X[i] < X[k]
-                  || (curInd==-1 && equ(X[i], X[k]) && Y[i] < Y[k] && !(k + 1 < re_size && equ(X[k], X[k + 1]) && Y[k + 1] < Y[k]))
-                  || (curInd==1 && equ(X[i], X[k]) && Y[i] > Y[k] && !(k + 1 < re_size && equ(X[k], X[k + 1]) && Y[k + 1] > Y[k])))
-             && i < j)
-           i = i+1;
-         // it holds X[i - 1] < X[k] <= X[i], particularly X[i] != X[i - 1]
-         // for i < j and X[i - 1] < X[k] it holds X[i - 1] < X[k] <= X[i], particularly X[i] != X[i - 1]
-         // linear interpolation of (x, y) = (X[k], y) on segment (i - 1, i)
-         if (!equ(X[i], X[i - 1]))
-           y = (Y[i] - Y[i - 1]) / (X[i] - X[i - 1]) * (X[k] - X[i - 1]) + Y[i - 1];
-         else
-           y = Y[i];
-       }
-
-       // k located: intersection point is on segment (k - 1, k)
-       // i approximately located: intersection point is on polygonal line (iPrevoius - 1, i)
-       // Regular case
-       if (iPrevious > 1)
-         i = iPrevious - 1;
-       // Special case handling: assure, that i - 1 >= 0
-       else
-         i = iPrevious;
-       if (!equ(X[k], X[k - 1]))
-           // linear interpolation of (x, y) = (X[i], y) on segment (k - 1, k)
-         y = (Y[k] - Y[k - 1]) / (X[k] - X[k - 1]) * (X[i] - X[k - 1]) + Y[k - 1];
-       // it holds Y[i] = Y[iPrevious - 1] < Y[k - 1]
-       // Find i
-       while ((!equ(X[k], X[k - 1])
-                   && ((curInd==-1 && Y[i] < y) || (curInd==1 && y < Y[i])))
-           || (equ(X[k], X[k - 1]) && X[i] < X[k]))
-       {
-         i = i+1;
-           if (!equ(X[k], X[k - 1]))
-             // linear interpolation of (x, y) = (X[i], y) on segment (k - 1, k)
-               y = (Y[k] - Y[k - 1]) / (X[k] - X[k - 1]) * (X[i] - X[k - 1]) + Y[k - 1];
-       }
-
-       // ===== 2. Calculate intersection point (ix, iy) of segments (i - 1, i) and (k - 1, k) =====
-       double a1 = 0;
-       double a2 = 0;
-
-       // both branches vertical
-       if (equ(X[i], X[i - 1]) && equ(X[k], X[k - 1]))
-         // add no point; check if case occur: slopes have different signs
-         addPoint = false;
-       // case i-branch vertical
-       else if equ(X[i], X[i - 1]) {
-         ix = X[i];
-         iy = Y[k - 1] + ((X[i] - X[k - 1]) * (Y[k] - Y[k - 1])) / (X[k] - X[k - 1]);
-       }
-       // case k-branch vertical
-       else if equ(X[k], X[k - 1]) {
-         ix = X[k];
-         iy = Y[i - 1] + ((X[k] - X[i - 1]) * (Y[i] - Y[i - 1])) / (X[i] - X[i - 1]);
-       }
-       // common case
-       else {
-         a1 = (Y[i] - Y[i - 1]) / (X[i] - X[i - 1]); // slope of segment (i - 1, i)
-         a2 = (Y[k] - Y[k - 1]) / (X[k] - X[k - 1]); // slope of segment (k - 1, k)
-         // common case: no equal slopes
-         if (!equ(a1, a2)) {
-           ix = (a1 * X[i - 1] - a2 * X[k - 1] - Y[i - 1] + Y[k - 1]) / (a1 - a2);
-           if (fabs(a1) > fabs(a2))
-             // calculate y on segment (k - 1, k)
-             iy = a2 * (ix - X[k - 1]) + Y[k - 1];
-           else
-             // calculate y on segment (i - 1, i)
-             iy = a1 * (ix - X[i - 1]) + Y[i - 1];
-         }
-         else
-           // case equal slopes: add no point
-           addPoint = false;
-       }
-
-       // ===== 3. Delete points i until (including) k-1 =====
-       int count = k-i;
-       double* XX = malloc((re_size-count) * sizeof(double));
-       if (XX == NULL){
-    	   fputs("Error: Failed to allocate memory for XX.\n", stderr);
-           exit(1);
-       }
-       XX = removeRange(X, re_size, i, count);
-       double* YY = malloc((size-count) * sizeof(double));
-       if (YY == NULL){
-           fputs("Error: Failed to allocate memory for YY.\n", stderr);
-           exit(1);
-       }
-       YY = removeRange(Y, re_size, i, count);
-       re_size = re_size-count;
-       // ===== 4. Add intersection point =====
-       // add intersection point, if it isn't already there
-       if (addPoint && (!equ(XX[i], ix) || !equ(YY[i], iy))) {
-         re_size = re_size+1;
-         double *X_temp = malloc(re_size * sizeof(double));
-         if (X_temp == NULL){
-        	 fputs("Error: Failed to allocate memory for X_temp.\n", stderr);
-             exit(1);
-         }
-         double *Y_temp = malloc(re_size * sizeof(double));
-         if (Y_temp == NULL){
-        	 fputs("Error: Failed to allocate memory for Y_temp.\n", stderr);
-        	 exit(1);
-         }
-         X_temp = insertAt(XX, re_size-1, i, ix);
-         Y_temp = insertAt(YY, re_size-1, i, iy);
-
-         XX = realloc(XX, sizeof(double)*re_size);
-         if (XX == NULL){
-        	 fputs("Error: Failed to reallocate memory for XX.\n", stderr);
-        	 exit(1);
-         }
-         YY = realloc(YY, sizeof(double)*re_size);
-         if (YY == NULL){
-        	 fputs("Error: Failed to reallocate memory for YY.\n", stderr);
-        	 exit(1);
-         }
-         XX = X_temp;
-         YY = Y_temp;
-       }
-
-       // ===== 5. set j = i =====
-       j = i;
-
-       // ===== 6. Delete points that are doubled =====
-       if (equ(XX[i-1], XX[i]) && equ(YY[i-1], YY[i])) {
-         re_size = re_size-1;
-         double *X_temp = malloc(re_size * sizeof(double));
-         if (X_temp == NULL){
-        	 fputs("Error: Failed to allocate memory for X_temp.\n", stderr);
-        	 exit(1);
-         }
-         double *Y_temp = malloc(re_size * sizeof(double));
-         if (Y_temp == NULL){
-        	 fputs("Error: Failed to allocate memory for Y_temp.\n", stderr);
-        	 exit(1);
-         }
-         X_temp = removeAt(XX, re_size+1, i);
-         Y_temp = removeAt(YY, re_size+1, i);
-
-         XX = realloc(XX, sizeof(double)*re_size);
-         if (XX == NULL){
-        	 fputs("Error: Failed to reallocate memory for XX.\n", stderr);
-        	 exit(1);
-         }
-         YY = realloc(YY, sizeof(double)*re_size);
-         if (YY == NULL){
-        	 fputs("Error: Failed to reallocate memory for YY.\n", stderr);
-        	 exit(1);
-         }
-         XX = X_temp;
-         YY = Y_temp;
-         j = i - 1;
-       }
-       X = realloc(X, sizeof(double)*re_size);
-       if (X == NULL){
-    	   fputs("Error: Failed to reallocate memory for X.\n", stderr);
-    	   exit(1);
-       }
-       Y = realloc(Y, sizeof(double)*re_size);
-       if (Y == NULL){
-    	   fputs("Error: Failed to reallocate memory for Y.\n", stderr);
-    	   exit(1);
-       }
-       X = XX;
-       Y = YY;
-     }
-     j=j+1;
-   }
-   output.x = X;
-   output.y = Y;
-   output.n = re_size;
-   return output;
- }
-
+/*
+ * Macros: XL, YL
+ * --------------
+ *   access point ind of a curve being compacted in place by removeLoop.
+ *   Points [0, w) are stored at their final position (write cursor w),
+ *   the remaining points are stored gap positions further (read cursor w + gap).
+ */
+#define XL(ind) X[((ind) < w) ? (ind) : (ind) + gap]
+#define YL(ind) Y[((ind) < w) ? (ind) : (ind) + gap]
 
 /*
- * Function: removeRange
- * ---------------------
- *   remove a range of elements from array
+ * Function: removeLoop
+ * --------------------
+ *   remove points and add intersection points in case of backward order
+ *
+ *   The curve is compacted in place: a write cursor w and a read cursor w + gap
+ *   split the arrays into the processed part and the part still to be read.
+ *   Deleting points widens the gap, inserting an intersection point narrows it,
+ *   so that no point is copied more than once.
  *
- *   array: original array
- *   size: original array size
- *   staInd: zero-based starting index of the range of elements to remove
- *   count: the number of elements to remove
+ *   X: x values of curve (updated in place)
+ *   Y: y values of curve (updated in place)
+ *   size: size of curve array
+ *   curInd: if equals to 1, algorithms for upper tube curve is used,
+ *           if equals to -1, algorithms for lower tube curve is used
  *
- *   return: updated array with specified length of elements being removed
+ *   return: data structure including updated curve data sets (X, Y, size),
+ *           with size 0 if an intersection point cannot be inserted
  */
-double * removeRange(double* array, int size, int staInd, int count) {
-  int i;
-  double* updArr = malloc((size-count) * sizeof(double));
-  if (updArr == NULL){
-	  fputs("Error: Failed to allocate memory for updArr.\n", stderr);
-	  exit(1);
-  }
-  if (!((staInd+count) <= size)) {
-    fputs("Deletion not possible!\n", stderr);
-    exit(1);
-  } else {
-    for (i=0; i<staInd; i++) {
-      updArr[i] = array[i];
-    }
-    if (staInd+count != size) {
-      for (i=staInd; i<(size-count); i++) {
-        updArr[i] = array[i+count];
+struct data removeLoop(double* X, double* Y, int size, int curInd) {
+  struct data output;
+  int j = 1;
+  int countLoops = 0;
+  int re_size = size;
+  int w = 0;    // write cursor: points before w are at their final position
+  int gap = 0;  // offset of the read cursor from the write cursor
+
+  while (j < re_size -2) {
+    // Move points up to j included to their final position
+    if (gap == 0) {
+      w = j+1;
+    } else {
+      while (w < j+1) {
+        X[w] = X[w+gap];
+        Y[w] = Y[w+gap];
+        w = w+1;
       }
     }
-  }
-  return updArr;
-}
 
+    // Find backward segment (j, j+1)
+    if (XL(j+1) < XL(j)) {
+
+      countLoops = countLoops + 1;
+      // ===== 1. Find i, k, such that i <= j<j+1 <= k-1 and segment (i-1, i) intersect segment (k-1, k) =====
+      int i, k, iPrevious;
+      double y;
+      // for calculation and adding of intersection point
+      bool addPoint = true;
+      double ix = 0;
+      double iy = 0;
+      int kMax;
+
+      i = j;
+      iPrevious = i;
+
+      // Find initial value for i = i_s, such that X[i_s-1]  <= X[j+1] < X[i_s]
+      // it holds: i element of interval (i_s, j)
+      while (XL(j+1) < XL(i-1))
+        i = i-1;
+      // j+1 < k <= kMax
+      kMax = j+1;
+      while (XL(kMax) < XL(j) && kMax < re_size-1)
+        kMax = kMax+1;
+
+      // initial value for k
+      k = j+1;
+      y = YL(i-1);
+
+      // Find k
+      while (((curInd==-1 && y < YL(k)) || (curInd==1 && YL(k) < y))
+          && k < kMax) {
+        iPrevious = i;
+        k = k+1;
+        while ((XL(i) < XL(k)
+                 || (curInd==-1 && equ(XL(i), XL(k)) && YL(i) < YL(k) && !(k + 1 < re_size && equ(XL(k), XL(k + 1)) && YL(k + 1) < YL(k)))
+                 || (curInd==1 && equ(XL(i), XL(k)) && YL(i) > YL(k) && !(k + 1 < re_size && equ(XL(k), XL(k + 1)) && YL(k + 1) > YL(k))))
+            && i < j)
+          i = i+1;
+        // it holds X[i - 1] < X[k] <= X[i], particularly X[i] != X[i - 1]
+        // for i < j and X[i - 1] < X[k] it holds X[i - 1] < X[k] <= X[i], particularly X[i] != X[i - 1]
+        // linear interpolation of (x, y) = (X[k], y) on segment (i - 1, i)
+        if (!equ(XL(i), XL(i - 1)))
+          y = (YL(i) - YL(i - 1)) / (XL(i) - XL(i - 1)) * (XL(k) - XL(i - 1)) + YL(i - 1);
+        else
+          y = YL(i);
+      }
 
-/*
- * Function: removeAt
- * ------------------
- *   remove element at the specified index from array
- *
- *   array: original array
- *   size: original array size
- *   ind: zero-based index of the element to remove
- *
- *   return: updated array with specified element being removed
- */
-double * removeAt(double* array, int size, int ind) {
-  int i;
-  double* updArr = malloc((size-1) * sizeof(double));
-  if (updArr == NULL){
-  	  fputs("Error: Failed to allocate memory for updArr.\n", stderr);
-  	  exit(1);
-  }
-  if (ind > size-1) {
-    fputs("Deletion not possible!\n", stderr);
-    exit(1);
-  } else {
-    if (ind == size-1) {
-      for (i=0; i<size-1; i++) {
-        updArr[i] = array[i];
+      // k located: intersection point is on segment (k - 1, k)
+      // i approximately located: intersection point is on polygonal line (iPrevoius - 1, i)
+      // Regular case
+      if (iPrevious > 1)
+        i = iPrevious - 1;
+      // Special case handling: assure, that i - 1 >= 0
+      else
+        i = iPrevious;
+      if (!equ(XL(k), XL(k - 1)))
+          // linear interpolation of (x, y) = (X[i], y) on segment (k - 1, k)
+        y = (YL(k) - YL(k - 1)) / (XL(k) - XL(k - 1)) * (XL(i) - XL(k - 1)) + YL(k - 1);
+      // it holds Y[i] = Y[iPrevious - 1] < Y[k - 1]
+      // Find i
+      while ((!equ(XL(k), XL(k - 1))
+                  && ((curInd==-1 && YL(i) < y) || (curInd==1 && y < YL(i))))
+          || (equ(XL(k), XL(k - 1)) && XL(i) < XL(k)))
+      {
+        i = i+1;
+          if (!equ(XL(k), XL(k - 1)))
+            // linear interpolation of (x, y) = (X[i], y) on segment (k - 1, k)
+              y = (YL(k) - YL(k - 1)) / (XL(k) - XL(k - 1)) * (XL(i) - XL(k - 1)) + YL(k - 1);
       }
-    } else {
-      for (i=0; i<ind; i++) {
-        updArr[i] = array[i];
+
+      // ===== 2. Calculate intersection point (ix, iy) of segments (i - 1, i) and (k - 1, k) =====
+      double a1 = 0;
+      double a2 = 0;
+
+      // both branches vertical
+      if (equ(XL(i), XL(i - 1)) && equ(XL(k), XL(k - 1)))
+        // add no point; check if case occur: slopes have different signs
+        addPoint = false;
+      // case i-branch vertical
+      else if equ(XL(i), XL(i - 1)) {
+        ix = XL(i);
+        iy = YL(k - 1) + ((XL(i) - XL(k - 1)) * (YL(k) - YL(k - 1))) / (XL(k) - XL(k - 1));
       }
-      for (i=ind; i<size-1; i++) {
-        updArr[i] = array[i+1];
+      // case k-branch vertical
+      else if equ(XL(k), XL(k - 1)) {
+        ix = XL(k);
+        iy = YL(i - 1) + ((XL(k) - XL(i - 1)) * (YL(i) - YL(i - 1))) / (XL(i) - XL(i - 1));
+      }
+      // common case
+      else {
+        a1 = (YL(i) - YL(i - 1)) / (XL(i) - XL(i - 1)); // slope of segment (i - 1, i)
+        a2 = (YL(k) - YL(k - 1)) / (XL(k) - XL(k - 1)); // slope of segment (k - 1, k)
+        // common case: no equal slopes
+        if (!equ(a1, a2)) {
+          ix = (a1 * XL(i - 1) - a2 * XL(k - 1) - YL(i - 1) + YL(k - 1)) / (a1 - a2);
+          if (fabs(a1) > fabs(a2))
+            // calculate y on segment (k - 1, k)
+            iy = a2 * (ix - XL(k - 1)) + YL(k - 1);
+          else
+            // calculate y on segment (i - 1, i)
+            iy = a1 * (ix - XL(i - 1)) + YL(i - 1);
+        }
+        else
+          // case equal slopes: add no point
+          addPoint = false;
       }
-    }
-  }
-  return updArr;
-}
-
 
-/*
- * Function: insertAt
- * ------------------
- *   insert element into the array at the specified index
- *
- *   array: original array
- *   size: original array size
- *   index: zero-based index at which item should be inserted
- *   item: the object to insert
- *
- *   return: updated array with new element being added at specified position
- */
-double * insertAt(double* array, int size, int index, double item) {
-  int i;
-  double* updArr = malloc((size+1) * sizeof(double));
-  if (updArr == NULL){
-	  fputs("Error: Failed to allocate memory for updArr.\n", stderr);
-	  exit(1);
-  }
-  if (index > size) {
-    fputs("Insert not possible!\n", stderr);
-    exit(1);
-  } else {
-    if (index == size) {
-      for (i=0; i<size; i++) {
-        updArr[i] = array[i];
+      // ===== 3. Delete points i until (including) k-1 =====
+      // it holds w <= k: point k (still to be read) becomes point i
+      while (w < i) {
+        X[w] = X[w+gap];
+        Y[w] = Y[w+gap];
+        w = w+1;
       }
-      updArr[size] = item;
-    } else {
-      for (i=0; i<index; i++) {
-        updArr[i] = array[i];
+      gap = gap + (k-i);
+      w = i;
+      re_size = re_size-(k-i);
+      // ===== 4. Add intersection point =====
+      // add intersection point, if it isn't already there
+      if (addPoint && (!equ(XL(i), ix) || !equ(YL(i), iy))) {
+        if (gap == 0)
+          return (struct data){X, Y, 0};
+        X[w] = ix;
+        Y[w] = iy;
+        w = w+1;
+        gap = gap-1;
+        re_size = re_size+1;
       }
-      updArr[index] = item;
-      for (i=index; i<size; i++) {
-        updArr[i+1] = array[i];
+
+      // ===== 5. set j = i =====
+      j = i;
+
+      // ===== 6. Delete points that are doubled =====
+      if (equ(XL(i-1), XL(i)) && equ(YL(i-1), YL(i))) {
+        // point i is either the last point written or the next point to be read
+        if (i < w)
+          w = w-1;
+        gap = gap+1;
+        re_size = re_size-1;
+        j = i - 1;
       }
     }
+    j=j+1;
+  }
+
+  // Move the points still to be read after the points written
+  if (gap > 0) {
+    memmove(X + w, X + w + gap, (re_size - w) * sizeof(double));
+    memmove(Y + w, Y + w + gap, (re_size - w) * sizeof(double));
   }
-  return updArr;
+  output.x = X;
+  output.y = Y;
+  output.n = re_size;
+  return output;
 }
+
+#undef XL
+#undef YL
@@ -8,22 +8,26 @@
 #ifndef ALGORITHMRECTANGLE_H_
 #define ALGORITHMRECTANGLE_H_
 
-typedef struct node {
-  double val;
-  struct node * next;
-} node_t;
+#include <sys/types.h>
 
-node_t * createNode(void);
+typedef struct point_buffer {
+  double *x;
+  double *y;
+  size_t n;         /* Number of points stored */
+  size_t capacity;  /* Maximum number of points */
+  int status;       /* 0, or -1 if the buffer cannot be allocated or a point exceeds the capacity */
+} point_buffer_t;
 
-node_t * addNode(node_t* head, double newVal);
+point_buffer_t createBuffer(size_t capacity);
 
-int listLen(node_t* head);
+void pushPoint(point_buffer_t* buf, double x, double y);
 
-double getNth(node_t* head, int index);
+double lastY(point_buffer_t* buf, size_t k);
 
-double * getListValues(node_t* head);
+void popPoint(point_buffer_t* buf);
 
-void lastNodeDeletion(node_t* head);
+int getTube(struct data *reference, struct data *tube_size, struct data_char dat_char,
+  struct data *lower, struct data *upper);
 
 struct data getLower(struct data *reference, struct data *tube_size);
 
@@ -31,10 +35,4 @@ struct data getUpper(struct data *reference, struct data *tube_size);
 
 struct data removeLoop(double* x, double* y, int size, int curInd);
 
-double * removeRange(double* array, int size, int staInd, int count);
-
-double * removeAt(double* array, int size, int ind);
-
-double * insertAt(double* array, int size, int index, double item);
-
 #endif /* ALGORITHMRECTANGLE_H_ */
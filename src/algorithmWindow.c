@@ -0,0 +1,332 @@
+/*
+ * algorithmWindow.c
+ *
+ * Functions:
+ * ----------
+ *   isWindowTube: test if the tube can be built with the sliding window engine
+ *   intervalMin: add the points of the moving minimum between two window events
+ *   addWindowPoint: append point to a tube curve
+ *   getTubeWindow: find the data sets of lower and upper tube curves with sliding windows
+ *
+ * With a constant half-width tx in x, the lower tube curve at x is the minimum of
+ * the (linearly interpolated) curve y - tube_y over the window [x - tx, x + tx],
+ * and the upper tube curve is the maximum of y + tube_y over the same window.
+ * Both are computed in O(n) with a monotone deque, without any loop removal.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "stdbool.h"
+
+#include "data_structure.h"
+#include "memory.h"
+#include "algorithmWindow.h"
+
+#ifndef equ
+#define equ(a,b) (fabs((a)-(b)) < 1e-10 ? true : false)  /* (b) required by Win32 compiler for <0 values */
+#endif
+
+/* State of one tube curve built by getTubeWindow */
+struct window_curve {
+  double off;      /* -1 for the lower tube curve, 1 for the upper tube curve */
+  double sgn;      /* 1 to compute the moving minimum, -1 to compute the moving maximum */
+  size_t *deque;   /* indices of points in the window, with increasing values */
+  size_t head;     /* front of the deque */
+  size_t tail;     /* back of the deque (excluded) */
+  struct data curve;
+  size_t capacity;
+  double yPrev;    /* value of the curve at the end of the previous interval */
+  int status;      /* 0, or -1 if the curve cannot be grown */
+};
+
+/*
+ * Function: isWindowTube
+ * ----------------------
+ *   test if the tube can be built with the sliding window engine, which requires
+ *   the tube half-width in x to be the same at every reference point
+ *   (typically when ltolx is 0) and the reference x values to be sorted
+ *
+ *   reference: pointer to reference data struct
+ *   tube_size: pointer to tube_size struct
+ *
+ *   return: true if the sliding window engine can be used
+ */
+bool isWindowTube(struct data *reference, struct data *tube_size) {
+  size_t i;
+  if (reference->n == 0 || tube_size->n != reference->n)
+    return false;
+  for (i = 1; i < reference->n; i++) {
+    if (tube_size->x[i] < tube_size->x[0] || tube_size->x[i] > tube_size->x[0])
+      return false;
+    if (reference->x[i] < reference->x[i-1])
+      return false;
+  }
+  return true;
+}
+
+/*
+ * Function: addWindowPoint
+ * ------------------------
+ *   append point to a tube curve, dropping duplicate points and
+ *   points that are aligned with their two neighbors
+ *   (the status of the curve is set to -1 if the curve cannot be grown)
+ *
+ *   wc: tube curve state
+ *   x: x value of the point
+ *   v: value of the point (sgn * y)
+ */
+static void addWindowPoint(struct window_curve *wc, double x, double v) {
+  struct data *curve = &wc->curve;
+  size_t n = curve->n;
+  if (n > 0 && equ(curve->x[n-1], x) && equ(curve->y[n-1], v))
+    return;
+  if (n > 1 && curve->x[n-2] < curve->x[n-1] && curve->x[n-1] < x
+      && equ(curve->y[n-1],
+             curve->y[n-2] + (v - curve->y[n-2]) * (curve->x[n-1] - curve->x[n-2]) / (x - curve->x[n-2]))) {
+    n = n-1;
+  }
+  if (n == wc->capacity) {
+    // need more space
+    double *x_tmp = reallocateMemory(curve->x, 2 * wc->capacity * sizeof(double));
+    if (x_tmp != NULL)
+      curve->x = x_tmp;
+    double *y_tmp = reallocateMemory(curve->y, 2 * wc->capacity * sizeof(double));
+    if (y_tmp != NULL)
+      curve->y = y_tmp;
+    if ((x_tmp == NULL) || (y_tmp == NULL)){
+      wc->status = -1;
+      return;
+    }
+    wc->capacity = 2 * wc->capacity;
+  }
+  curve->x[n] = x;
+  curve->y[n] = v;
+  curve->n = n+1;
+}
+
+/*
+ * Function: intervalMin
+ * ---------------------
+ *   add the points of the moving minimum of v = sgn * (y + off * ty)
+ *   on the interval [c0, c1] between two consecutive window events
+ *
+ *   Between two consecutive events, the minimum is the lowest of:
+ *   - the value at the left end of the window (linear, segment starting at p),
+ *   - the value at the right end of the window (linear, segment starting at q),
+ *   - the lowest point within the window (constant, front of the deque).
+ *   Values at the ends of the interval are exact when the window ends at a point.
+ *
+ *   wc: tube curve state
+ *   reference: pointer to reference data struct
+ *   tube_size: pointer to tube_size struct (constant half-width in x)
+ *   c0, c1: interval bounds
+ *   p, q: last points passed by the left and right ends of the window (-1 if none)
+ *   pAt0, pAt1: true if the left end of the window is at point p in c0, at point p+1 in c1
+ *   qAt0, qAt1: true if the right end of the window is at point q in c0, at point q+1 in c1
+ *   first: true for the first interval
+ */
+static void intervalMin(struct window_curve *wc, struct data *reference, struct data *tube_size,
+  double c0, double c1, long p, long q, bool pAt0, bool pAt1, bool qAt0, bool qAt1, bool first) {
+  const double *x = reference->x;
+  const double *y = reference->y;
+  const double *ty = tube_size->y;
+  const double tx = tube_size->x[0];
+  const long n = (long)reference->n;
+  const double sgn = wc->sgn;
+  const double off = wc->off;
+  const double len = c1 - c0;
+
+#define V(i) (sgn * (y[i] + off * ty[i]))
+
+  // ===== 1. Candidate functions on the interval: f(t) = f0 + slope * t, t = x - c0, f(len) = f1 =====
+  double f0[3] = {0, 0, 0}, f1[3] = {0, 0, 0}, slope[3] = {0, 0, 0};
+  bool valid[3];
+  valid[0] = (p >= 0 && p + 1 < n);
+  if (valid[0]) {
+    slope[0] = (V(p+1) - V(p)) / (x[p+1] - x[p]);
+    f0[0] = pAt0 ? V(p) : V(p) + slope[0] * ((c0 - tx) - x[p]);
+    f1[0] = pAt1 ? V(p+1) : V(p+1) + slope[0] * ((c1 - tx) - x[p+1]);
+  }
+  valid[1] = (q >= 0 && q + 1 < n);
+  if (valid[1]) {
+    slope[1] = (V(q+1) - V(q)) / (x[q+1] - x[q]);
+    f0[1] = qAt0 ? V(q) : V(q) + slope[1] * ((c0 + tx) - x[q]);
+    f1[1] = qAt1 ? V(q+1) : V(q+1) + slope[1] * ((c1 + tx) - x[q+1]);
+  }
+  valid[2] = (wc->tail > wc->head);
+  if (valid[2]) {
+    f0[2] = V(wc->deque[wc->head]);
+    f1[2] = f0[2];
+  }
+
+#undef V
+
+  // ===== 2. Minimum at the start of the interval =====
+  double yMin = INFINITY;
+  for (int k = 0; k < 3; k++) {
+    if (valid[k] && f0[k] < yMin)
+      yMin = f0[k];
+  }
+  if (first || !equ(yMin, wc->yPrev)) {
+    // first point, or vertical segment of the tube curve
+    addWindowPoint(wc, c0, yMin);
+  }
+
+  // ===== 3. Kinks of the minimum inside the interval =====
+  double tCross[3];
+  int nCross = 0;
+  for (int a = 0; a < 3; a++) {
+    for (int b = a+1; b < 3; b++) {
+      if (!valid[a] || !valid[b] || !(slope[a] < slope[b] || slope[a] > slope[b]))
+        continue;
+      double t = (f0[b] - f0[a]) / (slope[a] - slope[b]);
+      if (!(t > 0 && t < len))
+        continue;
+      double yCross = f0[a] + slope[a] * t;
+      int c = 3 - a - b;
+      if (valid[c] && f0[c] + slope[c] * t < yCross && !equ(f0[c] + slope[c] * t, yCross))
+        continue;
+      // insertion sort
+      int m = nCross;
+      while (m > 0 && tCross[m-1] > t) {
+        tCross[m] = tCross[m-1];
+        m--;
+      }
+      tCross[m] = t;
+      nCross++;
+    }
+  }
+  for (int m = 0; m < nCross; m++) {
+    yMin = INFINITY;
+    for (int k = 0; k < 3; k++) {
+      if (valid[k] && f0[k] + slope[k] * tCross[m] < yMin)
+        yMin = f0[k] + slope[k] * tCross[m];
+    }
+    addWindowPoint(wc, c0 + tCross[m], yMin);
+  }
+
+  // ===== 4. Minimum at the end of the interval =====
+  yMin = INFINITY;
+  for (int k = 0; k < 3; k++) {
+    if (valid[k] && f1[k] < yMin)
+      yMin = f1[k];
+  }
+  addWindowPoint(wc, c1, yMin);
+  wc->yPrev = yMin;
+}
+
+/*
+ * Function: getTubeWindow
+ * -----------------------
+ *   find the data sets of lower and upper tube curves with sliding windows,
+ *   for a tube with constant half-width in x (see isWindowTube)
+ *
+ *   A reference point i enters the window at x_i - tx and leaves it at x_i + tx.
+ *   Both sequences are sorted, so the window events are merged on the fly
+ *   and both curves are built in a single pass.
+ *
+ *   reference: pointer to reference data struct
+ *   tube_size: pointer to tube_size struct
+ *   lower: pointer to data struct receiving the lower curve of the tube
+ *   upper: pointer to data struct receiving the upper curve of the tube
+ *
+ *   return: 0 if there was success, -1 if the memory cannot be allocated
+ *           (both curves are then empty)
+ */
+int getTubeWindow(struct data *reference, struct data *tube_size,
+  struct data *lower, struct data *upper) {
+  const double *x = reference->x;
+  const double *y = reference->y;
+  const double *ty = tube_size->y;
+  const double tx = tube_size->x[0];
+  const size_t n = reference->n;
+  struct window_curve wc[2];
+  size_t i = 0;  // next point to enter the window
+  size_t j = 0;  // next point to leave the window
+  bool first = true;
+  int c, retVal = 0;
+
+  for (c = 0; c < 2; c++) {
+    wc[c].off = (c == 0) ? -1 : 1;
+    wc[c].sgn = (c == 0) ? 1 : -1;
+    wc[c].deque = allocateMemory(n * sizeof(size_t));
+    wc[c].head = 0;
+    wc[c].tail = 0;
+    // Most events contribute one point to the curve.
+    wc[c].capacity = 2 * n + 2;
+    wc[c].curve.x = allocateMemory(wc[c].capacity * sizeof(double));
+    wc[c].curve.y = allocateMemory(wc[c].capacity * sizeof(double));
+    wc[c].curve.n = 0;
+    wc[c].yPrev = 0;
+    wc[c].status = 0;
+    if ((wc[c].deque == NULL) || (wc[c].curve.x == NULL) || (wc[c].curve.y == NULL)){
+      retVal = -1;
+    }
+  }
+
+  while (j < n && retVal == 0) {
+    // ===== 1. Process all events at the current position (points entering first) =====
+    double c0 = (i < n && x[i] - tx <= x[j] + tx) ? x[i] - tx : x[j] + tx;
+    bool pAt0 = false, qAt0 = false;
+    while (i < n && !(x[i] - tx > c0)) {
+      // point enters the window
+      for (c = 0; c < 2; c++) {
+        const double sgn = wc[c].sgn, off = wc[c].off;
+        const double v = sgn * (y[i] + off * ty[i]);
+        while (wc[c].tail > wc[c].head
+               && !(sgn * (y[wc[c].deque[wc[c].tail-1]] + off * ty[wc[c].deque[wc[c].tail-1]]) < v))
+          wc[c].tail--;
+        wc[c].deque[wc[c].tail++] = i;
+      }
+      i++;
+      qAt0 = true;
+    }
+    while (j < n && !(x[j] + tx > c0)) {
+      // point leaves the window
+      for (c = 0; c < 2; c++) {
+        if (wc[c].tail > wc[c].head && wc[c].deque[wc[c].head] == j)
+          wc[c].head++;
+      }
+      j++;
+      pAt0 = true;
+    }
+    if (j == n) {
+      // last position: x_(n-1) + tx
+      if (first) {
+        for (c = 0; c < 2; c++)
+          addWindowPoint(&wc[c], c0, wc[c].sgn * (y[n-1] + wc[c].off * ty[n-1]));
+      }
+      break;
+    }
+
+    // ===== 2. Add the points of both curves on the interval up to the next position =====
+    double c1 = (i < n && x[i] - tx <= x[j] + tx) ? x[i] - tx : x[j] + tx;
+    bool qAt1 = (i < n && !(x[i] - tx > c1));
+    bool pAt1 = !(x[j] + tx > c1);
+    for (c = 0; c < 2; c++)
+      intervalMin(&wc[c], reference, tube_size, c0, c1, (long)j - 1, (long)i - 1,
+        pAt0, pAt1, qAt0, qAt1, first);
+    first = false;
+  }
+
+  for (c = 0; c < 2; c++) {
+    struct data *curve = &wc[c].curve;
+    if (wc[c].status != 0)
+      retVal = -1;
+    for (size_t k = 0; k < curve->n; k++)
+      curve->y[k] = wc[c].sgn * curve->y[k];
+    freeMemory(wc[c].deque);
+  }
+  if (retVal != 0) {
+    for (c = 0; c < 2; c++) {
+      freeMemory(wc[c].curve.x);
+      freeMemory(wc[c].curve.y);
+      wc[c].curve = (struct data){NULL, NULL, 0};
+    }
+  }
+  *lower = wc[0].curve;
+  *upper = wc[1].curve;
+  return retVal;
+}
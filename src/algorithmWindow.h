@@ -0,0 +1,15 @@
+/*
+ * algorithmWindow.h
+ */
+
+#ifndef ALGORITHMWINDOW_H_
+#define ALGORITHMWINDOW_H_
+
+#include "stdbool.h"
+
+bool isWindowTube(struct data *reference, struct data *tube_size);
+
+int getTubeWindow(struct data *reference, struct data *tube_size,
+  struct data *lower, struct data *upper);
+
+#endif /* ALGORITHMWINDOW_H_ */
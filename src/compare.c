@@ -5,12 +5,86 @@
 #define equ(a,b) (fabs((a)-(b)) < 1e-10 ? true : false)  /* (b) required by Win32 compiler for <0 values */
 #endif
 
+#ifndef max
+#define max(a,b) ((a) > (b) ? (a) : (b))
+#endif
+
+#ifndef min
+#define min(a,b) ((a) < (b) ? (a) : (b))
+#endif
+
 /*
-*   Descriptor of the file used for logging the numerical processing errors
-*   (all other errors like memory, file access, bad argument...
-*   are still output to stderr.)
+*   Estimated peak memory per reference point of the tube of a window in the out-of-core mode
+*   (tube size, intermediate and final tube curves of two windows).
 */
-FILE *log_file;
+#define OUT_OF_CORE_BYTES_PER_POINT 256
+
+/* Minimum number of reference points of a window in the out-of-core mode */
+#define OUT_OF_CORE_MIN_WINDOW 1024
+
+/* Return value of compareOutOfCore if the inputs cannot be processed by windows */
+#define OUT_OF_CORE_NOT_APPLICABLE -2
+
+/* Minimum number of points of a curve for writing its output file on a separate thread */
+#ifndef PIPELINE_MIN_ROWS
+#define PIPELINE_MIN_ROWS (1 << 14)
+#endif
+
+/* Queue of comparison jobs of one worker of compareAndReportBatch */
+struct job_queue {
+  size_t *jobs;     /* job indices, by decreasing size */
+  size_t head;      /* next job to run by the owner, or to steal */
+  size_t tail;      /* end of the queue (excluded) */
+  mutex_t lock;     /* protects head */
+};
+
+/* Tube curve vertices emitted by the out-of-core mode and still needed for validation */
+struct pending_curve {
+  struct data curve;
+  size_t capacity;
+  size_t j;         /* interpolation cursor, see interpolateAt */
+};
+
+/* Output file of a curve, in one of the formats of enum output_formats */
+struct output_file {
+  int format;
+  struct csv_writer csv;
+  struct binary_writer binary;
+};
+
+/* Violation intervals and summary metrics built by validatePending */
+struct pending_intervals {
+  struct violations list;
+  size_t capacity;   /* Allocated size of list.intervals */
+  bool out;          /* Set if the last validated test point is out of the tube */
+  double error;      /* Error of the last validated test point */
+  struct violation_summary summary;
+};
+
+/* Output file of a curve written while the comparison goes on, see startCurve */
+struct pending_output {
+  const char *outDir;
+  const char *name;           /* Name of the curve, see openOutput */
+  int format;
+  const struct data *curve;   /* Curve, which must stay valid until finishCurve */
+  context_t *ctx;             /* Context of the comparison, for the error messages */
+  struct thread thread;
+  bool started;               /* Set if the file is written on its own thread */
+  int status;                 /* Return value of writeCurve */
+};
+
+/* Size of a job of compareAndReportBatch, for sorting */
+struct job_order {
+  size_t size;
+  size_t ind;
+};
+
+/* Shared state of the workers of compareAndReportBatch */
+struct batch {
+  struct comparison_job *jobs;
+  struct job_queue *queues;
+  int nWorkers;
+};
 
 /*
  * Function: buildPath
@@ -19,6 +93,8 @@ FILE *log_file;
  *
  *   outDir: directory of file
  *   fileName: file name
+ *
+ *   return: path to be freed with freeMemory, or NULL if the memory cannot be allocated
  */
 
 char *buildPath(
@@ -35,13 +111,12 @@ char *buildPath(
 
   char *fname = NULL;
   if (addSlash)
-    fname = (char*)malloc((strlen(outDir) + strlen(fileName) + 2) * sizeof(char));
+    fname = (char*)allocateMemory((strlen(outDir) + strlen(fileName) + 2) * sizeof(char));
   else
-    fname = (char*)malloc((strlen(outDir) + strlen(fileName) + 1) * sizeof(char));
+    fname = (char*)allocateMemory((strlen(outDir) + strlen(fileName) + 1) * sizeof(char));
 
-  if (fname == NULL){
-    perror("Error: Failed to allocate memory for fname in writeToFile.");
-  }
+  if (fname == NULL)
+    return NULL;
 
   strcpy(fname, outDir);
 
@@ -61,25 +136,26 @@ char *buildPath(
 /*
  * Function: init_log
  * -----------------------
- *   opens a file for logging the numerical processing errors
- *   (all other errors like memory, file access, bad argument...
- *   are still output to stderr.)
+ *   opens a file for logging the messages of a comparison (see logMessage)
  *
  *   outDir: directory of logging file
  *   fileName: logging file name
+ *   append: if true, the messages are appended to an existing log file instead of replacing it
+ *
+ *   return: log file, or NULL if it cannot be opened (the messages then go to
+ *           the message callback of the context or stderr, see logMessage)
  */
 
 FILE *init_log(
   const char *outDir,
-  const char *fileName
+  const char *fileName,
+  bool append
 ) {
   char *fname = buildPath(outDir, fileName);
-  FILE *fil = fopen(fname, "w+");
-  if (fname != NULL) free(fname);
-
-  if (fil == NULL){
-    perror("Error: Failed to open log.\n");
-  }
+  if (fname == NULL)
+    return NULL;
+  FILE *fil = fopen(fname, append ? "a" : "w+");
+  freeMemory(fname);
 
   return fil;
 }
@@ -87,11 +163,14 @@ FILE *init_log(
 /*
  * Function: writeToFile
  * -----------------------
- *   write input data structure to files
+ *   write input data structure to files, with the shortest representation
+ *   of each value that is read back exactly (see writeCSV)
  *
  *   outDir: directory to save the output files
  *   fileName: file name for storing base CSV data
  *   data: data to be written
+ *
+ *   return: 0 if there was success, -1 if the file cannot be written
  */
 
 int writeToFile(
@@ -99,50 +178,40 @@ int writeToFile(
   const char *fileName,
   struct data *data
 ) {
-  size_t i = 0;
+  struct csv_writer writer;
 
   char *fname = buildPath(outDir, fileName);
-  FILE *fil = fopen(fname, "w+");
-  if (fname != NULL) free(fname);
-
-  if (fil == NULL){
-    fprintf(log_file, "Error: Failed to open '%s' in writeToFile.\n", fname);
+  if (fname == NULL)
+    return -1;
+  if (openCSVWriter(&writer, fname) != 0) {
+    freeMemory(fname);
     return -1;
   }
+  freeMemory(fname);
 
-  fprintf(fil, "%s\n", "x,y");
-  for (i = 0; i < data->n; i++) {
-    fprintf(fil, "%.16g,%.16g\n", data->x[i], data->y[i]);
-  }
-
-  fclose(fil);
+  writeCSVRows(&writer, data->x, data->y, data->n);
 
-  return 0;
+  return closeCSVWriter(&writer);
 }
 
 struct data *newData(
   size_t n
 ) {
-  struct data *retVal = malloc(sizeof(struct data));
+  struct data *retVal = allocateMemory(sizeof(struct data));
   if (retVal == NULL)
-  {
-    fputs("Error: Failed to allocate memory for data.\n", log_file);
     return NULL;
-  }
   // Try to allocate vector data, free structure if fail.
 
-  retVal->x = malloc(n * sizeof(double));
+  retVal->x = allocateMemory(n * sizeof(double));
   if (retVal->x == NULL) {
-    fputs("Error: Failed to allocate memory for data.x.\n", log_file);
-    free (retVal);
+    freeMemory(retVal);
     return NULL;
   }
 
-  retVal->y = malloc(n * sizeof(double));
+  retVal->y = allocateMemory(n * sizeof(double));
   if (retVal->y == NULL) {
-    fputs("Error: Failed to allocate memory for data.y.\n", log_file);
-    free (retVal->x);
-    free (retVal);
+    freeMemory(retVal->x);
+    freeMemory(retVal);
     return NULL;
   }
 
@@ -159,15 +228,46 @@ void setData(
   if (dat != NULL) {
     memcpy(dat->x, x, sizeof(double) * dat->n);
     memcpy(dat->y, y, sizeof(double) * dat->n);
-  } else {
-    fputs("Error: Cannot set data for unallocated struct.\n", log_file);
   }
 }
 
 void freeData(struct data *dat) {
-  if (dat->x != NULL) free (dat->x);
-  if (dat->y != NULL) free (dat->y);
-  if (dat != NULL) free (dat);
+  if (dat == NULL)
+    return;
+  freeMemory(dat->x);
+  freeMemory(dat->y);
+  freeMemory(dat);
+}
+
+/*
+ * Function: reserveData
+ * -----------------------
+ *   grow the arrays of a scratch data struct to hold at least n points
+ *
+ *   dat: data struct of the scratch memory
+ *   capacity: allocated size of the arrays, updated
+ *   n: number of points
+ *
+ *   return: 0 if there was success, -1 if the memory cannot be allocated
+ */
+static int reserveData(
+  struct data *dat,
+  size_t *capacity,
+  size_t n
+) {
+  if (n > *capacity) {
+    double *x_tmp = reallocateMemory(dat->x, n * sizeof(double));
+    if (x_tmp == NULL)
+      return -1;
+    dat->x = x_tmp;
+    double *y_tmp = reallocateMemory(dat->y, n * sizeof(double));
+    if (y_tmp == NULL)
+      return -1;
+    dat->y = y_tmp;
+    *capacity = n;
+  }
+  dat->n = n;
+  return 0;
 }
 
 /*
@@ -192,29 +292,708 @@ int compareAndReport(
   const double rtolx,
   const double rtoly
 ) {
+  return compareAndReportWithOptions(
+    tReference, yReference, nReference,
+    tTest, yTest, nTest,
+    outputDirectory,
+    atolx, atoly, ltolx, ltoly, rtolx, rtoly,
+    NULL);
+}
+
+/*
+ * Function: checkRange
+ * -----------------------
+ *   check that the reference and test curves have the same minimum and maximum x values
+ *
+ *   ctx: context of the comparison
+ *   reference: reference curve
+ *   test: test curve
+ *
+ *   return: 0 if the x values match, 1 otherwise (with a message in the log file)
+ */
+static int checkRange(context_t *ctx, const struct data *reference, const struct data *test) {
+  if (!equ(reference->x[0], test->x[0])){
+    logError(ctx, "Error: Reference and test data minimum x values are different.\n");
+    return 1;
+  }
+  if (!equ(reference->x[reference->n - 1], test->x[test->n - 1])){
+    logError(ctx, "Error: Reference and test data maximum x values are different.\n");
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Function: outputFileName
+ * -----------------------
+ *   find the name of the output file of a curve
+ *
+ *   fileName: buffer of MAX characters receiving the file name
+ *   name: name of the curve
+ *   format: file format, see enum output_formats, or -1 for the log file
+ */
+static void outputFileName(char *fileName, const char *name, int format) {
+  snprintf(fileName, MAX, "%s.%s", name, (format < 0) ? "log" : ((format == OUTPUT_CSV) ? "csv" : "bin"));
+}
+
+/*
+ * Function: removeOutput
+ * -----------------------
+ *   remove the output file of a curve, if it exists
+ *
+ *   outDir: directory of file
+ *   name: name of the curve, see outputFileName
+ *   format: file format, see enum output_formats, or -1 for the log file
+ */
+static void removeOutput(const char *outDir, const char *name, int format) {
+  char fileName[MAX];
+  outputFileName(fileName, name, format);
+  char *fname = buildPath(outDir, fileName);
+  if (fname != NULL)
+    remove(fname);
+  freeMemory(fname);
+}
+
+/*
+ * Function: openOutput
+ * -----------------------
+ *   open the output file of a curve
+ *
+ *   ctx: context of the comparison
+ *   outDir: directory of file
+ *   name: name of the curve, the file name being name.csv or name.bin
+ *   format: file format, see enum output_formats
+ *   nRows: number of rows to be written, SIZE_MAX if unknown
+ *   out: output file
+ *
+ *   return: 0 if there was success, -1 if the file cannot be opened
+ */
+static int openOutput(
+  context_t *ctx,
+  const char *outDir,
+  const char *name,
+  int format,
+  size_t nRows,
+  struct output_file *out
+) {
+  char fileName[MAX];
+  int retVal;
+  outputFileName(fileName, name, format);
+  char *fname = buildPath(outDir, fileName);
+  out->format = format;
+  if (fname == NULL) {
+    logError(ctx, "Error: Failed to allocate memory for the path of %s.\n", fileName);
+    return -1;
+  }
+  if (format == OUTPUT_CSV)
+    retVal = openCSVWriter(&out->csv, fname);
+  else
+    retVal = openBinaryWriter(&out->binary, fname, nRows,
+      (format == OUTPUT_BINARY_COMPRESSED) ? X_ENCODING_DELTA : X_ENCODING_RAW);
+  if (retVal != 0)
+    logError(ctx, "Error: Failed to open '%s' in openOutput.\n", fname);
+  freeMemory(fname);
+  return retVal;
+}
+
+/*
+ * Function: writeOutput
+ * -----------------------
+ *   append points to the output file of a curve
+ *
+ *   out: output file, or not open (the points are then dropped)
+ *   x, y: x and y values of the points
+ *   n: number of points
+ */
+static void writeOutput(struct output_file *out, const double *x, const double *y, size_t n) {
+  if (((out->format == OUTPUT_CSV) ? (void *)out->csv.file : (void *)out->binary.file) == NULL)
+    return;
+  if (out->format == OUTPUT_CSV)
+    writeCSVRows(&out->csv, x, y, n);
+  else
+    writeBinaryRows(&out->binary, x, y, n);
+}
+
+/*
+ * Function: closeOutput
+ * -----------------------
+ *   close the output file of a curve
+ *
+ *   out: output file, or not open
+ *
+ *   return: 0 if there was success, -1 if a write failed
+ */
+static int closeOutput(struct output_file *out) {
+  return (out->format == OUTPUT_CSV) ? closeCSVWriter(&out->csv) : closeBinaryWriter(&out->binary);
+}
+
+/*
+ * Function: writeCurve
+ * -----------------------
+ *   write the output file of a curve
+ *
+ *   ctx: context of the comparison
+ *   outDir: directory of file
+ *   name: name of the curve, see openOutput
+ *   format: file format, see enum output_formats
+ *   curve: curve
+ *
+ *   return: 0 if there was success, -1 if the file cannot be written
+ */
+static int writeCurve(context_t *ctx, const char *outDir, const char *name, int format, const struct data *curve) {
+  struct output_file out;
+  int retVal = openOutput(ctx, outDir, name, format, curve->n, &out);
+  if (retVal == 0) {
+    writeOutput(&out, curve->x, curve->y, curve->n);
+    retVal = closeOutput(&out);
+  }
+  return retVal;
+}
+
+/*
+ * Function: writeReport
+ * -----------------------
+ *   write the output files of a comparison
+ *
+ *   ctx: context of the comparison
+ *   outDir: directory to save the output files
+ *   format: format of the output files, see enum output_formats
+ *   reference, test: reference and test curves
+ *   lower, upper: lower and upper tube curves
+ *   errors: error at each test point
+ *   (the files of the curves set to NULL are not written)
+ *
+ *   return: 0 if there was success
+ */
+static int writeReport(
+  context_t *ctx,
+  const char *outDir,
+  int format,
+  struct data *reference,
+  struct data *lower,
+  struct data *upper,
+  struct data *test,
+  struct data *errors
+) {
+  const char *names[5] = {"reference", "lowerBound", "upperBound", "test", "errors"};
+  struct data *curves[5] = {reference, lower, upper, test, errors};
+  int k;
+  for (k = 0; k < 5; k++) {
+    if (curves[k] != NULL && writeCurve(ctx, outDir, names[k], format, curves[k]) != 0) {
+      logError(ctx, "Error: Failed to write %s in output directory.\n", names[k]);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Function: writeViolations
+ * -----------------------
+ *   write the violation intervals to violations.csv (see writeViolationsCSV)
+ *
+ *   ctx: context of the comparison
+ *   outDir: directory of file
+ *   violations: violation intervals
+ *
+ *   return: 0 if there was success, -1 if the file cannot be written
+ */
+static int writeViolations(context_t *ctx, const char *outDir, const struct violations *violations) {
+  char *fname = buildPath(outDir, "violations.csv");
+  int retVal = (fname != NULL) ? writeViolationsCSV(fname, violations) : -1;
+  if (retVal != 0)
+    logError(ctx, "Error: Failed to write violations in output directory.\n");
+  freeMemory(fname);
+  return retVal;
+}
+
+/*
+ * Function: writePending
+ * -----------------------
+ *   write the output file of a pending curve (function run on its own thread)
+ *
+ *   arg: pointer to pending_output struct
+ */
+static void writePending(void *arg) {
+  struct pending_output *out = (struct pending_output *)arg;
+  out->status = writeCurve(out->ctx, out->outDir, out->name, out->format, out->curve);
+}
+
+/*
+ * Function: startCurve
+ * -----------------------
+ *   start writing the output file of a curve as soon as the curve is computed.
+ *   Large curves are written on their own thread if pipelined is set, so that
+ *   the files are written concurrently with each other and with the computations
+ *   that follow; the other curves are written immediately.
+ *
+ *   out: pending output, to be completed with finishCurve
+ *   ctx: context of the comparison
+ *   outDir: directory of file
+ *   name: name of the curve, see openOutput
+ *   format: file format, see enum output_formats
+ *   curve: curve, which must stay valid until finishCurve is called
+ *   pipelined: set to allow writing on a separate thread
+ */
+static void startCurve(struct pending_output *out, context_t *ctx, const char *outDir, const char *name,
+  int format, const struct data *curve, bool pipelined) {
+  out->outDir = outDir;
+  out->name = name;
+  out->format = format;
+  out->curve = curve;
+  out->ctx = ctx;
+  out->status = 0;
+  out->started = pipelined && curve->n >= PIPELINE_MIN_ROWS && startThread(&out->thread, writePending, out) == 0;
+  if (!out->started)
+    writePending(out);
+}
+
+/*
+ * Function: finishCurve
+ * -----------------------
+ *   wait for the output file of a curve started with startCurve
+ *
+ *   out: pending output
+ *
+ *   return: 0 if there was success, -1 if the file cannot be written
+ */
+static int finishCurve(struct pending_output *out) {
+  if (out->started)
+    joinThread(&out->thread);
+  out->started = false;
+  if (out->status != 0)
+    logError(out->ctx, "Error: Failed to write %s in output directory.\n", out->name);
+  return out->status;
+}
+
+/*
+ * Function: emitCurve
+ * -----------------------
+ *   append points of a tube curve to its output file and to the pending vertices
+ *
+ *   pend: pending vertices of the curve
+ *   fil: output file of the curve
+ *   piece: tube curve of a window
+ *   first, last: range of points of the piece to append (last excluded)
+ *
+ *   return: 0 if there was success, -1 if the memory cannot be allocated
+ */
+static int emitCurve(struct pending_curve *pend, struct output_file *fil, const struct data *piece, size_t first, size_t last) {
+  if (last <= first)
+    return 0;
+  if (reserveData(&pend->curve, &pend->capacity, pend->curve.n + (last - first)) != 0)
+    return -1;
+  memcpy(pend->curve.x + pend->curve.n - (last - first), piece->x + first, (last - first) * sizeof(double));
+  memcpy(pend->curve.y + pend->curve.n - (last - first), piece->y + first, (last - first) * sizeof(double));
+  writeOutput(fil, piece->x + first, piece->y + first, last - first);
+  return 0;
+}
+
+/*
+ * Function: validatePending
+ * -----------------------
+ *   validate the test points up to a given x value against the pending vertices
+ *   of the tube curves, write them with their errors, and drop the vertices
+ *   that are no longer needed
+ *
+ *   pend: pending vertices of the lower and upper tube curves
+ *   test: test curve
+ *   iTest: next test point to validate, updated
+ *   xMax: largest x value to validate
+ *   filTest, filErrors: output files of the test points and the errors, or not open
+ *   intervals: violation intervals and summary metrics, updated
+ *
+ *   return: 0 if there was success, -1 if the memory cannot be allocated
+ */
+static int validatePending(struct pending_curve pend[2], const struct data *test, size_t *iTest,
+  double xMax, struct output_file *filTest, struct output_file *filErrors, struct pending_intervals *intervals) {
+  int c;
+  if (pend[0].curve.n < 2 || pend[1].curve.n < 2)
+    return 0;
+  for (; *iTest < test->n && !(test->x[*iTest] > xMax); (*iTest)++) {
+    const double x = test->x[*iTest];
+    const double y = test->y[*iTest];
+    double lower = interpolateAt(&pend[0].curve, NULL, &pend[0].j, x);
+    double upper = interpolateAt(&pend[1].curve, NULL, &pend[1].j, x);
+    double e = 0.0;
+    const bool extend = intervals->out;
+    intervals->out = y < lower || y > upper;
+    if (intervals->out) {
+      e = (y < lower) ? lower - y : y - upper;
+      if (appendViolation(&intervals->list, &intervals->capacity, extend, x, e) != 0)
+        return -1;
+      summarizeViolation(&intervals->summary, x, e);
+    }
+    if (*iTest > 0 && (intervals->out || extend))
+      intervals->summary.integral += 0.5 * (intervals->error + e) * (x - test->x[*iTest - 1]);
+    intervals->error = e;
+    writeOutput(filTest, &x, &y, 1);
+    writeOutput(filErrors, &x, &e, 1);
+  }
+  for (c = 0; c < 2; c++) {
+    size_t drop = pend[c].j - 1;
+    memmove(pend[c].curve.x, pend[c].curve.x + drop, (pend[c].curve.n - drop) * sizeof(double));
+    memmove(pend[c].curve.y, pend[c].curve.y + drop, (pend[c].curve.n - drop) * sizeof(double));
+    pend[c].curve.n -= drop;
+    pend[c].j = 1;
+  }
+  return 0;
+}
+
+/*
+ * Function: windowRange
+ * ---------------------
+ *   find the window of the out-of-core mode starting at a reference point,
+ *   and the reference points the tube of the window is built from
+ *
+ *   x: sorted reference x values
+ *   n: number of reference points
+ *   b: first point of the window
+ *   window: number of points of the window, before it is widened
+ *   txMax: largest tube half-width in x
+ *   e: pointer receiving the end (excluded) of the window, widened up to distinct x values
+ *      and to 4 times txMax, for the cut search ranges
+ *   lo, hi: pointers receiving the range [lo, hi) of the points of the tube of the window:
+ *           the window and a halo of 6 times txMax on each side
+ */
+static void windowRange(const double *x, size_t n, size_t b, size_t window, double txMax,
+  size_t *e, size_t *lo, size_t *hi) {
+  const double halo = 6 * txMax;
+  size_t end = min(b + window, n);
+  while (end < n && (!(x[end] > x[end-1]) || x[end] - x[b] <= 4 * txMax || end < b + 8))
+    end++;
+  *e = end;
+  *lo = (b == 0) ? 0 : min(lowerBound(x, n, x[b] - halo), b - 4);
+  *hi = n;
+  if (end < n) {
+    size_t h = lowerBound(x, n, x[end] + halo);
+    while (h < n && !(x[h] > x[end] + halo))
+      h++;
+    *hi = min(max(h, end + 4), n);
+  }
+}
+
+/*
+ * Function: compareOutOfCore
+ * -----------------------
+ *   Same as compareWithContext, with a peak memory bounded by options->memoryBudget
+ *   instead of proportional to the size of the inputs.
+ *
+ *   The inputs are used in place, without copy, so that they can be memory-mapped
+ *   by the caller (the operating system then only keeps the pages in use).
+ *   The reference is processed by windows of consecutive points. The tube of each
+ *   window is built from the window and a halo of 6 times the largest tube half-width
+ *   in x on each side (see windowRange), then cut at common vertices with the tube of
+ *   the previous window, as in buildTubeChunks. The tube curves are written as they
+ *   are completed, and the test points they cover are validated and written in the
+ *   same pass. The output files are identical to the files written by compareWithContext.
+ *
+ *   The tube of a window is built from at most maxPoints = memoryBudget /
+ *   OUT_OF_CORE_BYTES_PER_POINT reference points (at least 2 * OUT_OF_CORE_MIN_WINDOW),
+ *   and the windows hold maxPoints / 2 points. A window spans at least 16 times the
+ *   largest tube half-width in x with its halos, whatever the budget: if these points
+ *   exceed maxPoints (wide tube in x, e.g. with rtolx), the budget cannot be honored
+ *   and an error is returned before any output file is written, but the log file.
+ *
+ *   With check set, no output file is written but the log file, and the comparison
+ *   stops at the first window with a test point out of the tube (gate mode).
+ *   Without check but with options->gate set, the comparison writes the report of
+ *   a test curve that failed the check pass, and appends to its log file.
+ *
+ *   summary: pointer receiving the summary metrics of the errors, or NULL
+ *
+ *   return: same as compareWithContext, GATE_FAILED if check is set and a test
+ *           point is out of the tube, or OUT_OF_CORE_NOT_APPLICABLE if the
+ *           x values are not sorted or the inputs fit in the memory budget
+ *           (checked before the output directory is touched), or if the windows
+ *           cannot be stitched (the files written by this pass, log file included,
+ *           are then removed)
+ */
+static int compareOutOfCore(
+  context_t *ctx,
+  const struct data *reference,
+  const struct data *test,
+  const char *outputDirectory,
+  struct tolerances tolerances,
+  bool check,
+  struct violation_summary *summary
+) {
+  const struct options *options = &ctx->options;
+  const double *x = reference->x;
+  const size_t n = reference->n;
+  const size_t maxPoints = max(options->memoryBudget / OUT_OF_CORE_BYTES_PER_POINT, 2 * OUT_OF_CORE_MIN_WINDOW);
+  const size_t window = maxPoints / 2;
+  int nThreads = (options->nThreads > 0) ? options->nThreads : getNumberOfThreads();
+  struct data tube_size = {NULL, NULL, 0};
+  size_t capacityTubeSize = 0;
+  struct data prev[2] = {{NULL, NULL, 0}, {NULL, NULL, 0}};  // lower and upper curves of the previous window
+  struct data cur[2] = {{NULL, NULL, 0}, {NULL, NULL, 0}};  // lower and upper curves of the current window
+  struct pending_curve pend[2] = {{{NULL, NULL, 0}, 0, 1}, {{NULL, NULL, 0}, 0, 1}};
+  size_t start[2] = {0, 0};  // first point of the previous curves not emitted yet
+  struct output_file fil[5];
+  const char *names[5] = {"reference", "lowerBound", "upperBound", "test", "errors"};
+  const size_t nRows[5] = {n, SIZE_MAX, SIZE_MAX, test->n, test->n};
+  const bool intervalsOnly = options->errorOutput == ERRORS_INTERVALS;
+  const bool skip[5] = {check || options->skipInputs, check, check, check || options->skipInputs, check || intervalsOnly};
+  struct pending_intervals intervals = {{NULL, 0}, 0, false, 0.0, {0}};
+  size_t i, b, e, lo, hi, iTest = 0;
+  double txMax = 0;
+  bool constant = true;
+  int retVal = 0, c, k;
+
+  if (n == 0 || test->n == 0 || n <= maxPoints)
+    return OUT_OF_CORE_NOT_APPLICABLE;
+  for (i = 1; i < n; i++) {
+    if (x[i] < x[i-1])
+      return OUT_OF_CORE_NOT_APPLICABLE;
+  }
+  for (i = 1; i < test->n; i++) {
+    if (test->x[i] < test->x[i-1])
+      return OUT_OF_CORE_NOT_APPLICABLE;
+  }
+
+  initSummary(&intervals.summary);
+  for (k = 0; k < 5; k++) {
+    fil[k].format = options->outputFormat;
+    fil[k].csv.file = NULL;
+    fil[k].binary.file = NULL;
+  }
+  if (mkdir_p(outputDirectory) != 0) {
+    logError(ctx, "Error: Failed to create directory: %s\n", outputDirectory);
+    return -1;
+  }
+  // The report of a failed gate is appended to the log of the check pass.
+  ctx->log = init_log(outputDirectory, "c_funnel.log", !check && options->gate);
+  if (ctx->log == NULL)
+    logMessage(ctx, "Warning: Failed to open log file c_funnel.log in %s.\n", outputDirectory);
+  retVal = checkRange(ctx, reference, test);
+  if (retVal != 0)
+    goto end;
+
+  struct data_char dat_char = get_data_char((struct data *)reference);
+
+  // ===== 1. Largest tube half-width in x, and engine =====
+  for (b = 0; b < n; b += window) {
+    struct data sub = {reference->x + b, reference->y + b, min(window, n - b)};
+    if (reserveData(&tube_size, &capacityTubeSize, sub.n) != 0) {
+      logError(ctx, "Error: Failed to allocate memory for tube size.\n");
+      retVal = -1;
+      goto end;
+    }
+    set_tube_size(&tube_size, &sub, dat_char, tolerances);
+    for (i = 0; i < sub.n; i++) {
+      constant = constant && !(tube_size.x[i] < tube_size.x[0] || tube_size.x[i] > tube_size.x[0]);
+      if (tube_size.x[i] > txMax)
+        txMax = tube_size.x[i];
+    }
+  }
+  if (options->engine == ENGINE_WINDOW && !constant) {
+    logError(ctx, "Error: Window engine requires a constant tube size in x and sorted reference x values.\n");
+    retVal = 1;
+    goto end;
+  }
+  const int engine = (options->engine == ENGINE_WINDOW) ? ENGINE_WINDOW : ENGINE_RECTANGLE;
+
+  // ===== 2. Points of the tube of each window, within the memory budget =====
+  for (b = 0; b < n; b = e) {
+    windowRange(x, n, b, window, txMax, &e, &lo, &hi);
+    if (hi - lo > maxPoints) {
+      logError(ctx, "Error: The tube around x = %g is built from %zu reference points (16 tube half-widths in x), "
+        "more than the %zu points of the memory budget of %zu bytes.\n", x[b], hi - lo, maxPoints, options->memoryBudget);
+      retVal = 1;
+      goto end;
+    }
+  }
+
+  for (k = 0; k < 5; k++) {
+    if (!skip[k] && openOutput(ctx, outputDirectory, names[k], options->outputFormat, nRows[k], &fil[k]) != 0) {
+      retVal = -1;
+      goto end;
+    }
+  }
+
+  // ===== 3. Tube of each window, stitched to the tube of the previous window =====
+  for (b = 0; b < n; b = e) {
+    windowRange(x, n, b, window, txMax, &e, &lo, &hi);
+    struct data sub = {reference->x + lo, reference->y + lo, hi - lo};
+    if (reserveData(&tube_size, &capacityTubeSize, sub.n) != 0) {
+      logError(ctx, "Error: Failed to allocate memory for tube size.\n");
+      retVal = -1;
+      goto end;
+    }
+    set_tube_size(&tube_size, &sub, dat_char, tolerances);
+    if (buildTube(&sub, &tube_size, dat_char, engine, nThreads, &cur[0], &cur[1]) == -1) {
+      logError(ctx, "Error: Failed to build tube (memory allocation or loop removal failed).\n");
+      retVal = -1;
+      goto end;
+    }
+    if (cur[0].n == 0 || cur[1].n == 0) {
+      logError(ctx, "Error: lower or upper curve has 0 elements.\n");
+      retVal = 1;
+      goto end;
+    }
+    writeOutput(&fil[0], reference->x + b, reference->y + b, e - b);
+
+    if (b > 0) {
+      // Cut the curves of the previous window and of this window at a common vertex.
+      size_t ia[2], ib[2];
+      for (c = 0; c < 2; c++) {
+        if (!findCommonVertex(&prev[c], &cur[c], x[b] - 2 * txMax, x[b] + 2 * txMax, start[c], &ia[c], &ib[c])) {
+          retVal = OUT_OF_CORE_NOT_APPLICABLE;
+          goto end;
+        }
+      }
+      for (c = 0; c < 2; c++) {
+        if (emitCurve(&pend[c], &fil[1 + c], &prev[c], start[c], ia[c] + 1) != 0)
+          goto memory;
+        start[c] = ib[c] + 1;
+        freeMemory(prev[c].x);
+        freeMemory(prev[c].y);
+        prev[c] = (struct data){NULL, NULL, 0};
+      }
+      // Validate the test points covered by both curves.
+      if (validatePending(pend, test, &iTest,
+          min(pend[0].curve.x[pend[0].curve.n - 1], pend[1].curve.x[pend[1].curve.n - 1]), &fil[3], &fil[4], &intervals) != 0)
+        goto memory;
+      if (check && intervals.list.n > 0)
+        break;
+    }
+    for (c = 0; c < 2; c++) {
+      prev[c] = cur[c];
+      cur[c] = (struct data){NULL, NULL, 0};
+    }
+  }
+
+  // ===== 4. End of the tube, and remaining test points =====
+  for (c = 0; c < 2; c++) {
+    if (emitCurve(&pend[c], &fil[1 + c], &prev[c], start[c], prev[c].n) != 0)
+      goto memory;
+  }
+  if (check) {
+    if (intervals.list.n == 0 && validatePending(pend, test, &iTest, INFINITY, &fil[3], &fil[4], &intervals) != 0)
+      goto memory;
+    if (intervals.list.n > 0) {
+      logMessage(ctx, "Test failed: first test point out of the tube at x = %g.\n", intervals.list.intervals[0].xStart);
+      retVal = GATE_FAILED;
+    }
+    goto end;
+  }
+  if (validatePending(pend, test, &iTest, INFINITY, &fil[3], &fil[4], &intervals) != 0)
+    goto memory;
+  if (intervalsOnly)
+    retVal = writeViolations(ctx, outputDirectory, &intervals.list);
+  goto end;
+
+  memory:
+    logError(ctx, "Error: Failed to allocate memory for tube curves or violation intervals.\n");
+    retVal = -1;
+
+  end:
+    for (c = 0; c < 2; c++) {
+      freeMemory(prev[c].x);
+      freeMemory(prev[c].y);
+      freeMemory(cur[c].x);
+      freeMemory(cur[c].y);
+      freeMemory(pend[c].curve.x);
+      freeMemory(pend[c].curve.y);
+    }
+    freeMemory(tube_size.x);
+    freeMemory(tube_size.y);
+    freeMemory(intervals.list.intervals);
+    for (k = 0; k < 5; k++) {
+      if (closeOutput(&fil[k]) != 0 && retVal == 0) {
+        logError(ctx, "Error: Failed to write %s in output directory.\n", names[k]);
+        retVal = -1;
+      }
+    }
+    if (ctx->log != NULL)
+      fclose(ctx->log);
+    ctx->log = NULL;
+    if (retVal == OUT_OF_CORE_NOT_APPLICABLE) {
+      // Leave the output directory as it was for the in-memory comparison.
+      for (k = 0; k < 5; k++) {
+        if (!skip[k])
+          removeOutput(outputDirectory, names[k], options->outputFormat);
+      }
+      removeOutput(outputDirectory, "c_funnel", -1);
+    }
+    if (summary != NULL) {
+      finishSummary(&intervals.summary);
+      *summary = intervals.summary;
+    }
+    return retVal;
+}
+
+/*
+ * Function: compareWithContext
+ * -----------------------
+ *   Same as compareAndReportWithOptions, with the options of a context, and
+ *   the reference, test and tube size stored in the scratch memory of the
+ *   context, which is reused by the comparisons run with this context.
+ *
+ *   ctx: context of the comparison
+ *   summary: pointer receiving the summary metrics of the errors, or NULL
+ */
+static int compareWithContext(
+  context_t *ctx,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  const char *outputDirectory,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  struct violation_summary *summary
+) {
+  const struct options *options = &ctx->options;
+  struct scratch *scr = &ctx->scratch;
   int retVal;
   int rc_mkdir = mkdir_p(outputDirectory);
-  struct data *baseCSV = newData(nReference);
-  struct data *testCSV = newData(nTest);
-  struct data *tube_size = newData(nReference);
+  struct data *baseCSV = &scr->reference;
+  struct data *testCSV = &scr->test;
+  struct data *tube_size = &scr->tube_size;
+  tube_t tube = {0};
+  struct reports validateReport = {{{NULL, NULL, 0}, {NULL, NULL, 0}, {NULL, 0}, {0}, 0, 0}};
+  const int format = options->outputFormat;
+  const bool gate = options->gate;
+  bool failed = false;  // Set if the gate finds a test point out of the tube
+  const bool skipInputs = options->skipInputs;
+  const int nThreads = (options->nThreads > 0) ? options->nThreads : getNumberOfThreads();
+  struct pending_output pending[5] = {{0}};
+  int k;
+  initSummary(&validateReport.errors.summary);
+  if (reserveData(baseCSV, &scr->capacityReference, nReference) != 0
+      || reserveData(tube_size, &scr->capacityTubeSize, nReference) != 0
+      || reserveData(testCSV, &scr->capacityTest, nTest) != 0) {
+    logError(ctx, "Error: Failed to allocate memory for scratch data.\n");
+    return -1;
+  }
   setData(baseCSV, tReference, yReference);
   setData(testCSV, tTest, yTest);
 
   if (rc_mkdir != 0) {
-    fprintf(stderr, "Error: Failed to create directory: %s\n", outputDirectory);
+    logError(ctx, "Error: Failed to create directory: %s\n", outputDirectory);
     return -1;
   }
-  log_file = init_log(outputDirectory, "c_funnel.log");
+  ctx->log = init_log(outputDirectory, "c_funnel.log", false);
+  if (ctx->log == NULL)
+    logMessage(ctx, "Warning: Failed to open log file c_funnel.log in %s.\n", outputDirectory);
 
-  if (!equ(baseCSV->x[0], testCSV->x[0])){
-    fprintf(log_file, "Error: Reference and test data minimum x values are different.\n");
-    retVal = 1;
-    goto end;
-  }
-  if (!equ(baseCSV->x[baseCSV->n - 1], testCSV->x[testCSV->n - 1])){
-    fprintf(log_file, "Error: Reference and test data maximum x values are different.\n");
-    retVal = 1;
+  retVal = checkRange(ctx, baseCSV, testCSV);
+  if (retVal != 0)
     goto end;
+
+  // Each output file is written as soon as its curve is available: with several
+  // threads, large files are written concurrently while the tube is computed.
+  if (!skipInputs && !gate) {
+    startCurve(&pending[0], ctx, outputDirectory, "reference", format, baseCSV, nThreads > 1);
+    startCurve(&pending[3], ctx, outputDirectory, "test", format, testCSV, nThreads > 1);
   }
 
   struct tolerances tolerances = {
@@ -225,58 +1004,631 @@ int compareAndReport(
     .rtolx = rtolx,
     .rtoly = rtoly,
   };
-  // Compute tube size.
-  set_tube_size(tube_size, baseCSV, tolerances);
-
-  // Calculate values of lower and upper curve around base
-  struct data lowerCurve = getLower(baseCSV, tube_size);
-  struct data upperCurve = getUpper(baseCSV, tube_size);
-
-  // Validate test curve and generate error report
-  if (lowerCurve.n == 0 || lowerCurve.n == 0){
-    fputs("Error: lower or upper curve has 0 elements.\n", log_file);
+  // Load the tube from the cache file, or build it in the scratch memory.
+  const char *tubeCache = options->tubeCache;
+  if (tubeCache != NULL && loadTubeCache(&tube, tubeCache, baseCSV, tolerances, options) == 0) {
+    retVal = 0;
+  } else {
+    retVal = initTube(&tube, baseCSV, tube_size, tolerances, options);
+    if (retVal == 0 && tubeCache != NULL && saveTubeCache(&tube, tubeCache) != 0)
+      logMessage(ctx, "Warning: Failed to write tube cache file '%s'.\n", tubeCache);
+  }
+  if (retVal == -1){
+    logError(ctx, "Error: Failed to build tube (memory allocation or loop removal failed).\n");
+    goto end;
+  }
+  if (retVal == 1){
+    logError(ctx, "Error: Window engine requires a constant tube size in x and sorted reference x values.\n");
+    goto end;
+  }
+  if (retVal == 2){
+    logError(ctx, "Error: lower or upper curve has 0 elements.\n");
     retVal = 1;
     goto end;
   }
-  struct reports validateReport;
 
-  retVal = validate(lowerCurve, upperCurve, *testCSV, &validateReport.errors);
-  if (retVal != 0){
-    fputs("Error: Failed to run validate function.\n", log_file);
-    goto end;
+  if (gate) {
+    // Stop at the first test point out of the tube, and write the report only if there is one.
+    validateReport.errors.stopAtFirst = 1;
+    retVal = validateTube(&tube, testCSV->x, testCSV->y, testCSV->n, &validateReport.errors);
+    if (retVal != 0){
+      logError(ctx, "Error: Failed to run validate function.\n");
+      goto end;
+    }
+    if (validateReport.errors.intervals.n == 0)
+      goto end;
+    failed = true;
+    logMessage(ctx, "Test failed: first test point out of the tube at x = %g.\n",
+      validateReport.errors.intervals.intervals[0].xStart);
+    freeErrorReport(&validateReport.errors);
+    validateReport.errors.stopAtFirst = 0;
+    if (!skipInputs) {
+      startCurve(&pending[0], ctx, outputDirectory, "reference", format, baseCSV, nThreads > 1);
+      startCurve(&pending[3], ctx, outputDirectory, "test", format, testCSV, nThreads > 1);
+    }
   }
+  startCurve(&pending[1], ctx, outputDirectory, "lowerBound", format, &tube.lower, nThreads > 1);
+  startCurve(&pending[2], ctx, outputDirectory, "upperBound", format, &tube.upper, nThreads > 1);
 
-  /* Write data to files */
-  retVal = writeToFile(outputDirectory, "reference.csv", baseCSV);
+  // Validate test curve and generate error report
+  validateReport.errors.intervalsOnly = options->errorOutput == ERRORS_INTERVALS;
+  retVal = validateTube(&tube, testCSV->x, testCSV->y, testCSV->n, &validateReport.errors);
   if (retVal != 0){
-    fputs("Error: Failed to write reference.csv in output directory.\n", log_file);
+    logError(ctx, "Error: Failed to run validate function.\n");
     goto end;
   }
-  retVal = writeToFile(outputDirectory, "lowerBound.csv", &lowerCurve);
-  if (retVal != 0){
-    fputs("Error: Failed to write lowerBound.csv in output directory.\n", log_file);
+
+  if (validateReport.errors.intervalsOnly)
+    retVal = writeViolations(ctx, outputDirectory, &validateReport.errors.intervals);
+  else
+    startCurve(&pending[4], ctx, outputDirectory, "errors", format, &validateReport.errors.diff, false);
+
+  end:
+    // Wait for the output files before releasing their curves.
+    for (k = 0; k < 5; k++) {
+      if (pending[k].name != NULL && finishCurve(&pending[k]) != 0 && retVal == 0)
+        retVal = -1;
+    }
+    if (failed && retVal == 0)
+      retVal = GATE_FAILED;
+    if (summary != NULL)
+      *summary = validateReport.errors.summary;
+    releaseTube(&tube);
+    freeErrorReport(&validateReport.errors);
+    if (ctx->log != NULL)
+      fclose(ctx->log);
+    ctx->log = NULL;
+    return retVal;
+}
+
+/*
+ * Function: runComparison
+ * -----------------------
+ *   run a comparison with a context: by windows (see compareOutOfCore) if the
+ *   options of the context set a memory budget and the inputs are larger than
+ *   the budget, or else in memory (see compareWithContext)
+ *
+ *   ctx: context of the comparison
+ *   summary: pointer receiving the summary metrics of the errors, or NULL
+ *
+ *   return: same as compareAndReportWithOptions
+ */
+static int runComparison(
+  context_t *ctx,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  const char *outputDirectory,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  struct violation_summary *summary
+) {
+  if (ctx->options.memoryBudget > 0) {
+    const struct data reference = {(double *)tReference, (double *)yReference, nReference};
+    const struct data test = {(double *)tTest, (double *)yTest, nTest};
+    const struct tolerances tolerances = {
+      .atolx = atolx, .atoly = atoly, .ltolx = ltolx, .ltoly = ltoly, .rtolx = rtolx, .rtoly = rtoly};
+    int retVal = compareOutOfCore(ctx, &reference, &test, outputDirectory, tolerances, ctx->options.gate, summary);
+    if (retVal == GATE_FAILED) {
+      // Run again to write the report of the failed test: the files are written while the
+      // windows are processed, so the windows checked before the failure are processed
+      // again, and a passing test curve is processed only once.
+      retVal = compareOutOfCore(ctx, &reference, &test, outputDirectory, tolerances, false, summary);
+      if (retVal == 0)
+        retVal = GATE_FAILED;
+    }
+    if (retVal != OUT_OF_CORE_NOT_APPLICABLE)
+      return retVal;
+  }
+  return compareWithContext(
+    ctx,
+    tReference, yReference, nReference,
+    tTest, yTest, nTest,
+    outputDirectory,
+    atolx, atoly, ltolx, ltoly, rtolx, rtoly,
+    summary);
+}
+
+/*
+ * Function: compareAndReportWithOptions
+ * -----------------------
+ *   Same as compareAndReport, with additional options.
+ *
+ *   options: pointer to options struct, or NULL for default options
+ *            (engine: ENGINE_DEFAULT, nThreads: 0, tubeCache: NULL, memoryBudget: 0,
+ *            outputFormat: OUTPUT_CSV, errorOutput: ERRORS_DENSE, skipInputs: 0, gate: 0).
+ *            With ERRORS_INTERVALS, the errors are written as violation intervals
+ *            to violations.csv (see writeViolationsCSV) instead of errors.csv, so that
+ *            nothing but the header is written for a passing test curve. With
+ *            skipInputs set, reference and test files are not written.
+ *            With gate set, the validation stops at the first test point out of
+ *            the tube: if there is none, only the log file is written and 0 is
+ *            returned; otherwise, the full report is written and GATE_FAILED is
+ *            returned.
+ *            With a memory budget, inputs larger than the budget are compared
+ *            by windows (see compareOutOfCore), and the tube cache is not used;
+ *            an error is returned if the tube is too wide in x for the budget.
+ *            With several threads, the output files of large curves are written
+ *            on separate threads as soon as the curves are computed (see startCurve).
+ */
+int compareAndReportWithOptions(
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  const char *outputDirectory,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  const struct options *options
+) {
+  context_t ctx;
+  int retVal;
+  initContext(&ctx, options);
+  retVal = compareInContext(
+    &ctx,
+    tReference, yReference, nReference,
+    tTest, yTest, nTest,
+    outputDirectory,
+    atolx, atoly, ltolx, ltoly, rtolx, rtoly);
+  releaseContext(&ctx);
+  return retVal;
+}
+
+/*
+ * Function: compareInContext
+ * -----------------------
+ *   Same as compareAndReportWithOptions, with the options of a context (see
+ *   setContextOptions). The scratch memory of the context is reused from one
+ *   comparison to the next, and the first error message of the comparison is
+ *   kept in the context (see getContextError). The messages that are not
+ *   written to the log file go to the message callback of the context, or
+ *   to stderr. Comparisons run with different contexts can run concurrently.
+ *
+ *   ctx: context, used by one thread at a time
+ *
+ *   return: same as compareAndReportWithOptions
+ */
+int compareInContext(
+  context_t *ctx,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  const char *outputDirectory,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly
+) {
+  clearContextError(ctx);
+  return runComparison(
+    ctx,
+    tReference, yReference, nReference,
+    tTest, yTest, nTest,
+    outputDirectory,
+    atolx, atoly, ltolx, ltoly, rtolx, rtoly,
+    NULL);
+}
+
+/*
+ * Function: nextJob
+ * -----------------------
+ *   claim the next job of a worker: the largest job left in its own queue,
+ *   or else the largest job left in the queue of another worker (work stealing)
+ *
+ *   bat: shared state of the workers
+ *   w: worker index
+ *
+ *   return: job index, or -1 if all jobs are claimed
+ */
+static long nextJob(struct batch *bat, int w) {
+  int k;
+  for (k = 0; k < bat->nWorkers; k++) {
+    struct job_queue *q = &bat->queues[(w + k) % bat->nWorkers];
+    long job = -1;
+    mutexLock(&q->lock);
+    if (q->head < q->tail)
+      job = (long)q->jobs[q->head++];
+    mutexUnlock(&q->lock);
+    if (job >= 0)
+      return job;
+  }
+  return -1;
+}
+
+/*
+ * Function: runWorker
+ * -----------------------
+ *   run the jobs of a worker of compareAndReportBatch (task of parallelFor),
+ *   reusing the same context, and thus the same scratch memory, for all jobs
+ *
+ *   arg: pointer to batch struct
+ *   w: worker index
+ */
+static void runWorker(void *arg, int w) {
+  struct batch *bat = (struct batch *)arg;
+  const struct options options = {.engine = ENGINE_DEFAULT, .nThreads = 1};
+  context_t ctx;
+  long i;
+
+  initContext(&ctx, NULL);
+  while ((i = nextJob(bat, w)) >= 0) {
+    struct comparison_job *job = &bat->jobs[i];
+    const struct options *opt = (job->options != NULL) ? job->options : &options;
+    struct options jobOptions = *opt;
+    jobOptions.nThreads = 1;  // the batch is parallel over jobs
+    setContextOptions(&ctx, &jobOptions);
+    clearContextError(&ctx);
+    job->status = runComparison(
+      &ctx,
+      job->tReference, job->yReference, job->nReference,
+      job->tTest, job->yTest, job->nTest,
+      job->outputDirectory,
+      job->tolerances.atolx, job->tolerances.atoly,
+      job->tolerances.ltolx, job->tolerances.ltoly,
+      job->tolerances.rtolx, job->tolerances.rtoly,
+      &job->summary);
+  }
+  releaseContext(&ctx);
+}
+
+/*
+ * Function: jobSize
+ * -----------------------
+ *   estimate the cost of a comparison job
+ */
+static size_t jobSize(const struct comparison_job *job) {
+  return job->nReference + job->nTest;
+}
+
+/*
+ * Function: compareJobOrder
+ * -----------------------
+ *   compare two jobs for sorting by decreasing size with qsort
+ */
+static int compareJobOrder(const void *a, const void *b) {
+  const struct job_order *ja = (const struct job_order *)a;
+  const struct job_order *jb = (const struct job_order *)b;
+  if (ja->size != jb->size)
+    return (ja->size > jb->size) ? -1 : 1;
+  return (ja->ind < jb->ind) ? -1 : ((ja->ind > jb->ind) ? 1 : 0);
+}
+
+/*
+ * Function: compareAndReportBatch
+ * -----------------------
+ *   Run many comparisons on a pool of threads. Each comparison is the same as
+ *   compareAndReportWithOptions for one job, run on a single thread.
+ *
+ *   The jobs are dealt by decreasing size to the queues of the workers, each
+ *   worker runs the largest job left in its queue and, when its queue is empty,
+ *   steals the largest job left in the queue of another worker. Large jobs thus
+ *   start first and do not leave the other threads idle at the end of the batch.
+ *   Each worker reuses its scratch memory from one job to the next.
+ *
+ *   jobs: array of jobs; the status of each job (return value of
+ *         compareAndReport) is stored in jobs[i].status, and the summary
+ *         metrics of its errors in jobs[i].summary
+ *   nJobs: number of jobs
+ *   nThreads: number of threads, 0 for the library setting (see setNumberOfThreads)
+ *
+ *   return: number of jobs that failed (nonzero status), -1 if the memory cannot be allocated
+ */
+int compareAndReportBatch(
+  struct comparison_job *jobs,
+  const size_t nJobs,
+  int nThreads
+) {
+  size_t i;
+  long nFailed = 0;
+  int w;
+
+  if (nJobs == 0)
+    return 0;
+  if (nThreads <= 0)
+    nThreads = getNumberOfThreads();
+  if ((size_t)nThreads > nJobs)
+    nThreads = (int)nJobs;
+
+  struct batch bat = {jobs, NULL, nThreads};
+  struct job_order *order = allocateMemory(nJobs * sizeof(struct job_order));
+  bat.queues = allocateMemory(nThreads * sizeof(struct job_queue));
+  if ((order == NULL) || (bat.queues == NULL)) {
+    freeMemory(order);
+    freeMemory(bat.queues);
+    return -1;
+  }
+
+  // Sort jobs by decreasing size.
+  for (i = 0; i < nJobs; i++) {
+    order[i].size = jobSize(&jobs[i]);
+    order[i].ind = i;
+  }
+  qsort(order, nJobs, sizeof(struct job_order), compareJobOrder);
+
+  // Deal jobs to the worker queues, so that each queue is sorted by decreasing size.
+  for (w = 0; w < nThreads; w++) {
+    size_t n = nJobs / nThreads + (((size_t)w < nJobs % nThreads) ? 1 : 0);
+    bat.queues[w].jobs = allocateMemory(n * sizeof(size_t));
+    if (bat.queues[w].jobs == NULL) {
+      while (w-- > 0) {
+        mutexDestroy(&bat.queues[w].lock);
+        freeMemory(bat.queues[w].jobs);
+      }
+      freeMemory(bat.queues);
+      freeMemory(order);
+      return -1;
+    }
+    bat.queues[w].head = 0;
+    bat.queues[w].tail = 0;
+    mutexInit(&bat.queues[w].lock);
+  }
+  for (i = 0; i < nJobs; i++) {
+    struct job_queue *q = &bat.queues[i % nThreads];
+    q->jobs[q->tail++] = order[i].ind;
+  }
+
+  parallelFor(nThreads, nThreads, runWorker, &bat);
+
+  for (w = 0; w < nThreads; w++) {
+    mutexDestroy(&bat.queues[w].lock);
+    freeMemory(bat.queues[w].jobs);
+  }
+  freeMemory(bat.queues);
+  freeMemory(order);
+  for (i = 0; i < nJobs; i++) {
+    if (jobs[i].status != 0)
+      nFailed++;
+  }
+  return (int)nFailed;
+}
+
+/*
+ * Function: compareAndReturn
+ * -----------------------
+ *   Same as compareAndReportWithOptions, without writing files: the tube curves
+ *   and the error report are returned in memory owned by the library.
+ *   The error messages are written to stderr. The memory budget and tube cache
+ *   options are not used.
+ *
+ *   result: lower and upper tube curves, error at each test point (errors.diff),
+ *           at the test points out of the tube (errors.original) and violation
+ *           intervals (errors.intervals, the only errors returned if
+ *           options->errorOutput is ERRORS_INTERVALS) and summary metrics
+ *           (errors.summary), to be freed with freeComparisonResult
+ *
+ *   return: same as compareAndReport
+ */
+int compareAndReturn(
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  const struct options *options,
+  struct comparison_result *result
+) {
+  context_t ctx;
+  int retVal;
+  initContext(&ctx, options);
+  retVal = compareAndReturnInContext(
+    &ctx,
+    tReference, yReference, nReference,
+    tTest, yTest, nTest,
+    atolx, atoly, ltolx, ltoly, rtolx, rtoly,
+    result);
+  releaseContext(&ctx);
+  return retVal;
+}
+
+/*
+ * Function: compareAndReturnInContext
+ * -----------------------
+ *   Same as compareAndReturn, with the options of a context, the first error
+ *   message being kept in the context (see getContextError) and the messages
+ *   going to the message callback of the context, or to stderr.
+ *
+ *   ctx: context, used by one thread at a time
+ *
+ *   return: same as compareAndReturn
+ */
+int compareAndReturnInContext(
+  context_t *ctx,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  struct comparison_result *result
+) {
+  const struct options *options = &ctx->options;
+  struct data reference = {(double *)tReference, (double *)yReference, nReference};
+  struct data test = {(double *)tTest, (double *)yTest, nTest};
+  struct data tube_size = {NULL, NULL, 0};
+  size_t capacityTubeSize = 0;
+  tube_t tube = {0};
+  struct tolerances tolerances = {
+    .atolx = atolx,
+    .atoly = atoly,
+    .ltolx = ltolx,
+    .ltoly = ltoly,
+    .rtolx = rtolx,
+    .rtoly = rtoly,
+  };
+  int retVal;
+
+  *result = (struct comparison_result){{NULL, NULL, 0}, {NULL, NULL, 0}, {{NULL, NULL, 0}, {NULL, NULL, 0}, {NULL, 0}, {0}, 0, 0}};
+  clearContextError(ctx);
+  if (reserveData(&tube_size, &capacityTubeSize, nReference) != 0) {
+    logError(ctx, "Error: Failed to allocate memory for tube size.\n");
+    return -1;
+  }
+
+  retVal = checkRange(ctx, &reference, &test);
+  if (retVal != 0)
+    goto end;
+
+  retVal = initTube(&tube, &reference, &tube_size, tolerances, options);
+  if (retVal == -1){
+    logError(ctx, "Error: Failed to build tube (memory allocation or loop removal failed).\n");
     goto end;
   }
-  retVal = writeToFile(outputDirectory, "upperBound.csv", &upperCurve);
-  if (retVal != 0){
-    fputs("Error: Failed to write upperBound.csv in output directory.\n", log_file);
+  if (retVal == 1){
+    logError(ctx, "Error: Window engine requires a constant tube size in x and sorted reference x values.\n");
     goto end;
   }
-  retVal = writeToFile(outputDirectory, "test.csv", testCSV);
-  if (retVal != 0){
-    fputs("Error: Failed to write test.csv in output directory.\n", log_file);
+  if (retVal == 2){
+    logError(ctx, "Error: lower or upper curve has 0 elements.\n");
+    retVal = 1;
     goto end;
   }
-  retVal = writeToFile(outputDirectory, "errors.csv", &validateReport.errors.diff);
+
+  // Validate test curve and generate error report
+  result->errors.intervalsOnly = options->errorOutput == ERRORS_INTERVALS;
+  retVal = validateTube(&tube, tTest, yTest, nTest, &result->errors);
   if (retVal != 0){
-    fputs("Error: Failed to write errors.csv in output directory.\n", log_file);
+    logError(ctx, "Error: Failed to run validate function.\n");
     goto end;
   }
 
+  // Hand over the tube curves to the result.
+  result->lower = tube.lower;
+  result->upper = tube.upper;
+  tube.lower = (struct data){NULL, NULL, 0};
+  tube.upper = (struct data){NULL, NULL, 0};
+
   end:
-    freeData(baseCSV);
-    freeData(testCSV);
-    freeData(tube_size);
-    fclose(log_file);
+    releaseTube(&tube);
+    freeMemory(tube_size.x);
+    freeMemory(tube_size.y);
+    if (retVal != 0)
+      freeComparisonResult(result);
     return retVal;
 }
+
+/*
+ * Function: writeComparisonResult
+ * -----------------------
+ *   write the output files of compareAndReport (except the log file) from
+ *   the result of compareAndReturn, with violations.csv instead of errors.csv
+ *   if the result holds the violation intervals only. The error messages are
+ *   written to stderr (see writeComparisonResultInContext).
+ *
+ *   outputDirectory: directory to save the output files
+ *   tReference, yReference, nReference: reference values, as passed to compareAndReturn
+ *   tTest, yTest, nTest: test values, as passed to compareAndReturn
+ *   result: result of compareAndReturn
+ *
+ *   return: 0 if there was success
+ */
+int writeComparisonResult(
+  const char *outputDirectory,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  const struct comparison_result *result
+) {
+  context_t ctx;
+  int retVal;
+  initContext(&ctx, NULL);
+  retVal = writeComparisonResultInContext(
+    &ctx, outputDirectory,
+    tReference, yReference, nReference,
+    tTest, yTest, nTest,
+    result);
+  releaseContext(&ctx);
+  return retVal;
+}
+
+/*
+ * Function: writeComparisonResultInContext
+ * -----------------------
+ *   Same as writeComparisonResult, the error messages going to the message
+ *   callback of a context, or to stderr, and the first one being kept in the
+ *   context (see getContextError).
+ *
+ *   ctx: context, used by one thread at a time
+ *
+ *   return: same as writeComparisonResult
+ */
+int writeComparisonResultInContext(
+  context_t *ctx,
+  const char *outputDirectory,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  const struct comparison_result *result
+) {
+  struct data reference = {(double *)tReference, (double *)yReference, nReference};
+  struct data test = {(double *)tTest, (double *)yTest, nTest};
+  struct data lower = result->lower;
+  struct data upper = result->upper;
+  struct data errors = result->errors.diff;
+
+  clearContextError(ctx);
+  if (mkdir_p(outputDirectory) != 0) {
+    logError(ctx, "Error: Failed to create directory: %s\n", outputDirectory);
+    return -1;
+  }
+  if (result->errors.intervalsOnly) {
+    int retVal = writeViolations(ctx, outputDirectory, &result->errors.intervals);
+    if (retVal != 0)
+      return retVal;
+    return writeReport(ctx, outputDirectory, OUTPUT_CSV, &reference, &lower, &upper, &test, NULL);
+  }
+  return writeReport(ctx, outputDirectory, OUTPUT_CSV, &reference, &lower, &upper, &test, &errors);
+}
+
+/*
+ * Function: freeComparisonResult
+ * -----------------------
+ *   free the memory held by the result of compareAndReturn
+ *
+ *   result: result of compareAndReturn
+ */
+void freeComparisonResult(struct comparison_result *result) {
+  freeMemory(result->lower.x);
+  freeMemory(result->lower.y);
+  freeMemory(result->upper.x);
+  freeMemory(result->upper.y);
+  result->lower = (struct data){NULL, NULL, 0};
+  result->upper = (struct data){NULL, NULL, 0};
+  freeErrorReport(&result->errors);
+}
@@ -8,13 +8,26 @@
 
 #include "data_structure.h"
 #include "readCSV.h"
+#include "readMat.h"
+#include "writeCSV.h"
+#include "writeBinary.h"
 #include "algorithmRectangle.h"
+#include "algorithmWindow.h"
 #include "tube.h"
+#include "tubeHandle.h"
+#include "tubeCache.h"
+#include "tubeStream.h"
 #include "tubeSize.h"
 #include "mkdir_p.h"
+#include "memory.h"
+#include "parallel.h"
+#include "context.h"
 
 #define MAX 100
 
+/* Return value of compareAndReportWithOptions in gate mode if test points are out of the tube */
+#define GATE_FAILED 2
+
 /*
  * Function: compareAndReport
  * -----------------------
@@ -38,4 +51,153 @@ int compareAndReport(
   const double rtoly
 );
 
+/*
+ * Function: compareAndReportWithOptions
+ * -----------------------
+ *   Same as compareAndReport, with additional options
+ *   (NULL for default options).
+ */
+int compareAndReportWithOptions(
+  const double* tReference,
+  const double* yReference,
+  const size_t nReference,
+  const double* tTest,
+  const double* yTest,
+  const size_t nTest,
+  const char * outputDirectory,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  const struct options* options
+);
+
+/*
+ * Function: compareInContext
+ * -----------------------
+ *   Same as compareAndReportWithOptions, with the options, scratch memory,
+ *   messages and error message of a context (see createContext). Comparisons
+ *   run with different contexts can run concurrently.
+ */
+int compareInContext(
+  context_t* ctx,
+  const double* tReference,
+  const double* yReference,
+  const size_t nReference,
+  const double* tTest,
+  const double* yTest,
+  const size_t nTest,
+  const char * outputDirectory,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly
+);
+
+/*
+ * Function: compareAndReportBatch
+ * -----------------------
+ *   Runs many comparisons on a pool of threads, largest jobs first,
+ *   and stores the status of each comparison in jobs[i].status.
+ *   Returns the number of failed comparisons.
+ */
+int compareAndReportBatch(
+  struct comparison_job *jobs,
+  const size_t nJobs,
+  int nThreads
+);
+
+/*
+ * Function: compareAndReturn
+ * -----------------------
+ *   Same as compareAndReportWithOptions, without writing files: the tube
+ *   curves and the error report are returned in result, to be freed with
+ *   freeComparisonResult.
+ */
+int compareAndReturn(
+  const double* tReference,
+  const double* yReference,
+  const size_t nReference,
+  const double* tTest,
+  const double* yTest,
+  const size_t nTest,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  const struct options* options,
+  struct comparison_result* result
+);
+
+/*
+ * Function: compareAndReturnInContext
+ * -----------------------
+ *   Same as compareAndReturn, with the options, messages and error message
+ *   of a context.
+ */
+int compareAndReturnInContext(
+  context_t* ctx,
+  const double* tReference,
+  const double* yReference,
+  const size_t nReference,
+  const double* tTest,
+  const double* yTest,
+  const size_t nTest,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  struct comparison_result* result
+);
+
+/*
+ * Function: writeComparisonResult
+ * -----------------------
+ *   Writes the output files of compareAndReport from the result
+ *   of compareAndReturn.
+ */
+int writeComparisonResult(
+  const char * outputDirectory,
+  const double* tReference,
+  const double* yReference,
+  const size_t nReference,
+  const double* tTest,
+  const double* yTest,
+  const size_t nTest,
+  const struct comparison_result* result
+);
+
+/*
+ * Function: writeComparisonResultInContext
+ * -----------------------
+ *   Same as writeComparisonResult, with the messages and error message
+ *   of a context.
+ */
+int writeComparisonResultInContext(
+  context_t *ctx,
+  const char * outputDirectory,
+  const double* tReference,
+  const double* yReference,
+  const size_t nReference,
+  const double* tTest,
+  const double* yTest,
+  const size_t nTest,
+  const struct comparison_result* result
+);
+
+/*
+ * Function: freeComparisonResult
+ * -----------------------
+ *   Frees the memory held by the result of compareAndReturn.
+ */
+void freeComparisonResult(struct comparison_result* result);
+
 #endif /* COMPARE_H_ */
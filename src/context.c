@@ -0,0 +1,218 @@
+/*
+ * context.c
+ *
+ * Functions:
+ * ----------
+ *   initContext: initialize a comparison context
+ *   releaseContext: free the memory held by a comparison context
+ *   createContext: create a comparison context
+ *   freeContext: free a comparison context created with createContext
+ *   setContextOptions: set the options of the comparisons run with a context
+ *   setMessageCallback: set the function receiving the messages of a context
+ *   getContextError: get the error message of the last comparison run with a context
+ *   clearContextError: clear the error message of a context
+ *   writeMessage: write a message to the log file, the callback or stderr
+ *   logMessage: write a message of a comparison
+ *   logError: write an error message of a comparison and keep it in the error buffer
+ *
+ * A comparison context holds everything a comparison needs besides its inputs:
+ * the options, the scratch memory reused from one comparison to the next, the
+ * log file or message callback, and the error message returned to the caller.
+ * The library functions report errors with return codes and never exit, so that
+ * a host process (e.g. Python through ctypes) can run comparisons concurrently,
+ * with one context per thread, and survive their failures.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "context.h"
+#include "memory.h"
+
+/* Maximum length of a message (longer messages are truncated) */
+#define CONTEXT_MESSAGE_SIZE 1024
+
+/*
+ * Function: initContext
+ * ---------------------
+ *   initialize a comparison context, without scratch memory yet
+ *
+ *   ctx: context, to be released with releaseContext
+ *   options: pointer to options struct, or NULL for default options
+ *            (the strings it points to must stay valid while the context is used)
+ */
+void initContext(context_t *ctx, const struct options *options) {
+  memset(ctx, 0, sizeof(context_t));
+  setContextOptions(ctx, options);
+  mutexInit(&ctx->lock);
+}
+
+/*
+ * Function: releaseContext
+ * ------------------------
+ *   free the memory held by a comparison context (scratch memory)
+ *
+ *   ctx: context initialized with initContext
+ */
+void releaseContext(context_t *ctx) {
+  struct scratch *scr = &ctx->scratch;
+  freeMemory(scr->reference.x);
+  freeMemory(scr->reference.y);
+  freeMemory(scr->tube_size.x);
+  freeMemory(scr->tube_size.y);
+  freeMemory(scr->test.x);
+  freeMemory(scr->test.y);
+  memset(scr, 0, sizeof(struct scratch));
+  mutexDestroy(&ctx->lock);
+}
+
+/*
+ * Function: createContext
+ * -----------------------
+ *   create a comparison context, to be used by one thread at a time
+ *
+ *   options: pointer to options struct, or NULL for default options
+ *
+ *   return: context to be freed with freeContext, or NULL if the memory cannot be allocated
+ */
+context_t *createContext(const struct options *options) {
+  context_t *ctx = allocateMemory(sizeof(context_t));
+  if (ctx == NULL)
+    return NULL;
+  initContext(ctx, options);
+  return ctx;
+}
+
+/*
+ * Function: freeContext
+ * ---------------------
+ *   free a comparison context created with createContext
+ *
+ *   ctx: context, or NULL
+ */
+void freeContext(context_t *ctx) {
+  if (ctx == NULL)
+    return;
+  releaseContext(ctx);
+  freeMemory(ctx);
+}
+
+/*
+ * Function: setContextOptions
+ * ---------------------------
+ *   set the options of the comparisons run with a context
+ *
+ *   ctx: context
+ *   options: pointer to options struct, or NULL for default options
+ */
+void setContextOptions(context_t *ctx, const struct options *options) {
+  if (options != NULL)
+    ctx->options = *options;
+  else
+    memset(&ctx->options, 0, sizeof(struct options));
+}
+
+/*
+ * Function: setMessageCallback
+ * ----------------------------
+ *   set the function receiving the messages of a context that are not written
+ *   to a log file (by default, they are written to stderr)
+ *
+ *   ctx: context
+ *   onMessage: callback, called with one message at a time, or NULL for stderr
+ *   userData: passed to onMessage
+ */
+void setMessageCallback(context_t *ctx, message_callback onMessage, void *userData) {
+  ctx->onMessage = onMessage;
+  ctx->userData = userData;
+}
+
+/*
+ * Function: getContextError
+ * -------------------------
+ *   get the error message of the last comparison run with a context
+ *
+ *   ctx: context
+ *
+ *   return: first error message of the comparison (or of the file reading function
+ *           run with the context), empty if there was no error
+ */
+const char *getContextError(const context_t *ctx) {
+  return ctx->error;
+}
+
+/*
+ * Function: clearContextError
+ * ---------------------------
+ *   clear the error message of a context, before a comparison
+ *
+ *   ctx: context
+ */
+void clearContextError(context_t *ctx) {
+  ctx->error[0] = '\0';
+}
+
+/*
+ * Function: writeMessage
+ * ----------------------
+ *   write a message to the log file of the comparison in progress, or else
+ *   to the message callback or stderr, and keep the first error message
+ *
+ *   ctx: context
+ *   error: set if the message is an error message
+ *   format, args: message, as for vprintf
+ */
+static void writeMessage(context_t *ctx, int error, const char *format, va_list args) {
+  char message[CONTEXT_MESSAGE_SIZE];
+  vsnprintf(message, CONTEXT_MESSAGE_SIZE, format, args);
+
+  mutexLock(&ctx->lock);
+  if (ctx->log != NULL)
+    fputs(message, ctx->log);
+  else if (ctx->onMessage != NULL)
+    ctx->onMessage(ctx->userData, message);
+  else
+    fputs(message, stderr);
+  if (error && ctx->error[0] == '\0') {
+    size_t n = strlen(message);
+    while (n > 0 && message[n - 1] == '\n')
+      n--;
+    if (n > CONTEXT_ERROR_SIZE - 1)
+      n = CONTEXT_ERROR_SIZE - 1;
+    memcpy(ctx->error, message, n);
+    ctx->error[n] = '\0';
+  }
+  mutexUnlock(&ctx->lock);
+}
+
+/*
+ * Function: logMessage
+ * --------------------
+ *   write a message of a comparison (warning, test result), see writeMessage
+ *
+ *   ctx: context
+ *   format, ...: message, as for printf
+ */
+void logMessage(context_t *ctx, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  writeMessage(ctx, 0, format, args);
+  va_end(args);
+}
+
+/*
+ * Function: logError
+ * ------------------
+ *   write an error message of a comparison and keep it in the error buffer
+ *   of the context, if it is the first one (see getContextError)
+ *
+ *   ctx: context
+ *   format, ...: message, as for printf
+ */
+void logError(context_t *ctx, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  writeMessage(ctx, 1, format, args);
+  va_end(args);
+}
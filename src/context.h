@@ -0,0 +1,67 @@
+/*
+ * context.h
+ */
+
+#ifndef CONTEXT_H_
+#define CONTEXT_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "data_structure.h"
+#include "parallel.h"
+
+/* Size of the error message buffer of a comparison context */
+#define CONTEXT_ERROR_SIZE 256
+
+/* Function receiving the messages of a comparison context that are not written to a log file */
+typedef void (*message_callback)(void *userData, const char *message);
+
+/* Scratch memory reused by the comparisons run with one context */
+struct scratch {
+  struct data reference;
+  struct data test;
+  struct data tube_size;
+  size_t capacityReference;  /* allocated size of reference */
+  size_t capacityTest;       /* allocated size of test */
+  size_t capacityTubeSize;   /* allocated size of tube_size */
+};
+
+/*
+*   State of the comparisons run by one caller. A context is used by one thread at a time,
+*   and comparisons run with different contexts do not share any state, so that they can
+*   run concurrently.
+*/
+struct comparison_context {
+  struct options options;          /* Options of the comparisons */
+  struct scratch scratch;          /* Scratch memory reused from one comparison to the next */
+  FILE *log;                       /* Log file of the comparison in progress, NULL if none */
+  message_callback onMessage;      /* Callback for the messages without log file, NULL for stderr */
+  void *userData;                  /* Passed to onMessage */
+  char error[CONTEXT_ERROR_SIZE];  /* First error message of the last comparison, empty if none */
+  mutex_t lock;                    /* Protects log and error, which are also used by the output threads */
+};
+
+typedef struct comparison_context context_t;
+
+void initContext(context_t *ctx, const struct options *options);
+
+void releaseContext(context_t *ctx);
+
+context_t *createContext(const struct options *options);
+
+void freeContext(context_t *ctx);
+
+void setContextOptions(context_t *ctx, const struct options *options);
+
+void setMessageCallback(context_t *ctx, message_callback onMessage, void *userData);
+
+const char *getContextError(const context_t *ctx);
+
+void clearContextError(context_t *ctx);
+
+void logMessage(context_t *ctx, const char *format, ...);
+
+void logError(context_t *ctx, const char *format, ...);
+
+#endif /* CONTEXT_H_ */
@@ -23,9 +23,43 @@ struct data_char {
   double mag_y;    /* Magnitude of y */
 };
 
+/* Interval of consecutive test points out of the tube */
+struct violation {
+  double xStart;  /* x value of the first test point of the interval */
+  double xEnd;    /* x value of the last test point of the interval */
+  double peak;    /* Largest error value in the interval */
+  double xPeak;   /* x value of the first test point with the largest error value */
+};
+
+/* Violation intervals of a test curve, in the order of the test points */
+struct violations {
+  struct violation *intervals;
+  size_t n;
+};
+
+/* Number of worst test points kept in a violation summary */
+#define SUMMARY_TOP_K 10
+
+/* Summary metrics of the errors of a test curve, computed in the validation pass */
+struct violation_summary {
+  size_t nViolations;             /* Number of test points out of the tube */
+  double maxError;                /* Largest error value, 0 if there is no violation */
+  double xMaxError;               /* x value of the first test point with the largest error value, NAN if none */
+  double firstViolation;          /* x value of the first test point out of the tube, NAN if none */
+  double integral;                /* Integral of the error over x (L1 exceedance, trapezoidal rule) */
+  size_t nTop;                    /* Number of worst test points in topX and topError */
+  double topX[SUMMARY_TOP_K];     /* x values of the worst test points, by decreasing error value */
+  double topError[SUMMARY_TOP_K]; /* Error values of the worst test points */
+};
+
 struct errorReport {
   struct data original;
   struct data diff;
+  struct violations intervals;  /* Intervals of consecutive test points out of the tube */
+  struct violation_summary summary;  /* Summary metrics (partial if stopAtFirst is set) */
+  int intervalsOnly;            /* Set by the caller to build the intervals only (original and diff left empty) */
+  int stopAtFirst;              /* Set by the caller to stop at the first test point out of the tube
+                                   (original and diff left empty, one interval of one point at most) */
 };
 
 struct reports {
@@ -41,4 +75,66 @@ struct tolerances {
 	double rtoly;  /* Relative tolerance in y (relatively to range) */
 };
 
+/*
+*   Tube construction engines. The sliding window engine requires a constant tube half-width in x
+*   (ltolx = 0) and sorted reference x values. It builds the same tube as the rectangle engine up to
+*   rounding, but not the same vertices: it drops vertices aligned with their neighbors within 1e-10,
+*   and does not normalize x. The errors can therefore differ at test points on the tube curves
+*   (within rounding) or on a vertical segment of the tube (reference points with the same x value,
+*   where the rectangle engine may place the vertical segment at the other corner when the tube
+*   half-width in x is close to 0). The window engine is therefore never selected automatically.
+*/
+enum engines {
+  ENGINE_DEFAULT = 0,    /* Rectangle engine */
+  ENGINE_RECTANGLE = 1,  /* Rectangle corners and loop removal, see algorithmRectangle.c */
+  ENGINE_WINDOW = 2      /* Sliding window minimum and maximum, see algorithmWindow.c */
+};
+
+/* Outputs of the errors */
+enum error_outputs {
+  ERRORS_DENSE = 0,     /* Error at each test point (errors.csv or errors.bin) */
+  ERRORS_INTERVALS = 1  /* Violation intervals only (violations.csv), see writeViolationsCSV */
+};
+
+/* Formats of the output files */
+enum output_formats {
+  OUTPUT_CSV = 0,               /* Text files with "x,y" rows (.csv) */
+  OUTPUT_BINARY = 1,            /* Binary columnar files (.bin), see writeBinary.c */
+  OUTPUT_BINARY_COMPRESSED = 2  /* Binary columnar files with losslessly compressed x columns (.bin) */
+};
+
+struct options {
+  int engine;    /* Tube construction engine, see enum engines */
+  int nThreads;  /* Number of threads, 0 for the library setting (see setNumberOfThreads) */
+  const char *tubeCache;  /* Tube cache file name, NULL for no cache (see tubeCache.c) */
+  size_t memoryBudget;    /* Memory budget in bytes for the out-of-core mode, 0 to process in memory */
+  int outputFormat;       /* Format of the output files, see enum output_formats */
+  int errorOutput;        /* Output of the errors, see enum error_outputs */
+  int skipInputs;         /* Set to not write reference and test files (the caller has them on disk) */
+  int gate;               /* Set for a pass/fail verdict: the output files are written only if the test fails */
+};
+
+/* Comparison run by compareAndReportBatch */
+struct comparison_job {
+  const double *tReference;          /* Reference x values */
+  const double *yReference;          /* Reference y values */
+  size_t nReference;                 /* Number of reference points */
+  const double *tTest;               /* Test x values */
+  const double *yTest;               /* Test y values */
+  size_t nTest;                      /* Number of test points */
+  const char *outputDirectory;       /* Output directory */
+  struct tolerances tolerances;      /* Tolerances */
+  const struct options *options;     /* Options, NULL for default options */
+  int status;                        /* Return value of the comparison, set by compareAndReportBatch */
+  struct violation_summary summary;  /* Summary of the errors, set by compareAndReportBatch */
+};
+
+/* Result of compareAndReturn, freed with freeComparisonResult */
+struct comparison_result {
+  struct data lower;          /* Lower tube curve */
+  struct data upper;          /* Upper tube curve */
+  struct errorReport errors;  /* Error at each test point (diff), at the test points out of the tube (original),
+                                 and violation intervals */
+};
+
 #endif /* DATA_STRUCTURE_H_ */
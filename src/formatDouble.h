@@ -0,0 +1,13 @@
+/*
+ * formatDouble.h
+ */
+
+#ifndef FORMATDOUBLE_H_
+#define FORMATDOUBLE_H_
+
+/* Largest number of characters written by formatDouble ("-d.dddddddddddddddde-XXX") */
+#define FORMAT_DOUBLE_MAX_LENGTH 24
+
+char *formatDouble(char *p, double value);
+
+#endif /* FORMATDOUBLE_H_ */
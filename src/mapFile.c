@@ -0,0 +1,115 @@
+/*
+ * mapFile.c
+ *
+ * Functions:
+ * ----------
+ *   mapFile: map a whole file in memory, read-only
+ *   unmapFile: release a file mapped with mapFile
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mapFile.h"
+
+#if defined(_WIN32)     /* Win32 or Win64                */
+
+#include <windows.h>
+
+#else                   /* OSX or Linux                */
+
+#include <fcntl.h>      /* open(2) */
+#include <unistd.h>     /* close(2) */
+#include <sys/mman.h>   /* mmap(2) */
+#include <sys/stat.h>   /* fstat(2) */
+
+#endif
+
+/*
+ * Function: mapFile
+ * -----------------
+ *   map a whole file in memory, read-only.
+ *   The pages are loaded by the operating system when they are first accessed.
+ *
+ *   fileName: file name
+ *   map: mapping, to be released with unmapFile
+ *
+ *   return: 0 if there was success, -1 if the file cannot be opened or mapped
+ *           (an empty file is mapped with data set to NULL)
+ */
+int mapFile(const char *fileName, struct mapped_file *map) {
+  map->data = NULL;
+  map->size = 0;
+#if defined(_WIN32)
+  LARGE_INTEGER size;
+  map->mapping = NULL;
+  map->file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (map->file == INVALID_HANDLE_VALUE)
+    return -1;
+  if (!GetFileSizeEx(map->file, &size)) {
+    CloseHandle(map->file);
+    return -1;
+  }
+  map->size = (size_t)size.QuadPart;
+  if (map->size == 0)
+    return 0;
+  map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (map->mapping == NULL) {
+    CloseHandle(map->file);
+    return -1;
+  }
+  map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+  if (map->data == NULL) {
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+    return -1;
+  }
+#else
+  struct stat st;
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -1;
+  }
+  map->size = (size_t)st.st_size;
+  if (map->size > 0) {
+    void *data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return -1;
+    }
+    map->data = data;
+  }
+  // The mapping remains valid after the file is closed.
+  close(fd);
+#endif
+  return 0;
+}
+
+/*
+ * Function: unmapFile
+ * -------------------
+ *   release a file mapped with mapFile
+ *
+ *   map: mapping
+ */
+void unmapFile(struct mapped_file *map) {
+#if defined(_WIN32)
+  if (map->data != NULL)
+    UnmapViewOfFile(map->data);
+  if (map->mapping != NULL)
+    CloseHandle(map->mapping);
+  if (map->file != INVALID_HANDLE_VALUE)
+    CloseHandle(map->file);
+  map->mapping = NULL;
+  map->file = INVALID_HANDLE_VALUE;
+#else
+  if (map->data != NULL)
+    munmap((void *)map->data, map->size);
+#endif
+  map->data = NULL;
+  map->size = 0;
+}
@@ -0,0 +1,28 @@
+/*
+ * mapFile.h
+ */
+
+#ifndef MAPFILE_H_
+#define MAPFILE_H_
+
+#include <stddef.h>
+
+#if defined(_WIN32)     /* Win32 or Win64                */
+#include <windows.h>
+#endif
+
+/* Read-only memory mapping of a whole file */
+struct mapped_file {
+  const void *data;   /* Content of the file, NULL if not mapped */
+  size_t size;        /* Size of the file in bytes */
+#if defined(_WIN32)
+  HANDLE file;
+  HANDLE mapping;
+#endif
+};
+
+int mapFile(const char *fileName, struct mapped_file *map);
+
+void unmapFile(struct mapped_file *map);
+
+#endif /* MAPFILE_H_ */
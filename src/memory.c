@@ -0,0 +1,142 @@
+/*
+ * memory.c
+ *
+ * Functions:
+ * ----------
+ *   countAllocation: update the allocation counters
+ *   allocateMemory: allocate a block of memory
+ *   allocateZeroed: allocate a block of memory set to zero
+ *   reallocateMemory: resize a block of memory
+ *   freeMemory: free a block of memory
+ *   getAllocationCount: find the number of allocations made by the library
+ *   getLiveAllocationCount: find the number of blocks allocated by the library and not freed
+ *
+ * The comparison pipeline (tube construction, validation, output files) allocates
+ * through these functions, so that the memory it holds can be checked from a
+ * long-lived host process or from a test: once the results of a comparison are
+ * freed, the number of live blocks returns to its previous value. The input
+ * readers (readCSV.c, readMat.c) allocate with malloc, as their arrays are freed
+ * by the caller. The counters are updated atomically, as allocations are made
+ * from several threads.
+ */
+
+#include <stdlib.h>
+
+#include "memory.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+static volatile LONG64 nAllocations = 0;
+static volatile LONG64 nLive = 0;
+#define atomicAdd(counter, value) InterlockedExchangeAdd64(&(counter), (value))
+#define atomicGet(counter) InterlockedCompareExchange64(&(counter), 0, 0)
+#else
+#include <stdatomic.h>
+static atomic_llong nAllocations = 0;
+static atomic_llong nLive = 0;
+#define atomicAdd(counter, value) atomic_fetch_add_explicit(&(counter), (value), memory_order_relaxed)
+#define atomicGet(counter) atomic_load_explicit(&(counter), memory_order_relaxed)
+#endif
+
+/*
+ * Function: countAllocation
+ * -------------------------
+ *   update the allocation counters
+ *
+ *   allocated: 1 if a block was allocated or resized, 0 otherwise
+ *   live: change of the number of live blocks (-1, 0 or 1)
+ */
+static void countAllocation(int allocated, int live) {
+  if (allocated != 0)
+    atomicAdd(nAllocations, allocated);
+  if (live != 0)
+    atomicAdd(nLive, live);
+}
+
+/*
+ * Function: allocateMemory
+ * ------------------------
+ *   allocate a block of memory (same as malloc, counted)
+ *
+ *   size: number of bytes
+ *
+ *   return: pointer to the block, to be freed with freeMemory, or NULL
+ */
+void *allocateMemory(size_t size) {
+  void *p = malloc(size);
+  if (p != NULL)
+    countAllocation(1, 1);
+  return p;
+}
+
+/*
+ * Function: allocateZeroed
+ * ------------------------
+ *   allocate a block of memory set to zero (same as calloc, counted)
+ *
+ *   n: number of elements
+ *   size: number of bytes of an element
+ *
+ *   return: pointer to the block, to be freed with freeMemory, or NULL
+ */
+void *allocateZeroed(size_t n, size_t size) {
+  void *p = calloc(n, size);
+  if (p != NULL)
+    countAllocation(1, 1);
+  return p;
+}
+
+/*
+ * Function: reallocateMemory
+ * --------------------------
+ *   resize a block of memory (same as realloc, counted)
+ *
+ *   p: block allocated with allocateMemory, allocateZeroed or reallocateMemory, or NULL
+ *   size: new number of bytes (not 0)
+ *
+ *   return: pointer to the resized block, or NULL (p is then left unchanged)
+ */
+void *reallocateMemory(void *p, size_t size) {
+  void *q = realloc(p, size);
+  if (q != NULL)
+    countAllocation(1, (p == NULL) ? 1 : 0);
+  return q;
+}
+
+/*
+ * Function: freeMemory
+ * --------------------
+ *   free a block of memory (same as free, counted)
+ *
+ *   p: block allocated with allocateMemory, allocateZeroed or reallocateMemory, or NULL
+ */
+void freeMemory(void *p) {
+  if (p == NULL)
+    return;
+  free(p);
+  countAllocation(0, -1);
+}
+
+/*
+ * Function: getAllocationCount
+ * ----------------------------
+ *   find the number of allocations made by the library (including resizing)
+ *   since it was loaded
+ *
+ *   return: number of allocations
+ */
+size_t getAllocationCount(void) {
+  return (size_t)atomicGet(nAllocations);
+}
+
+/*
+ * Function: getLiveAllocationCount
+ * --------------------------------
+ *   find the number of blocks allocated by the library and not freed yet
+ *   (for checking that the results of the comparisons are freed)
+ *
+ *   return: number of blocks
+ */
+size_t getLiveAllocationCount(void) {
+  return (size_t)atomicGet(nLive);
+}
@@ -0,0 +1,22 @@
+/*
+ * memory.h
+ */
+
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <stddef.h>
+
+void *allocateMemory(size_t size);
+
+void *allocateZeroed(size_t n, size_t size);
+
+void *reallocateMemory(void *p, size_t size);
+
+void freeMemory(void *p);
+
+size_t getAllocationCount(void);
+
+size_t getLiveAllocationCount(void);
+
+#endif /* MEMORY_H_ */
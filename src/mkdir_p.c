@@ -31,9 +31,10 @@ int mkdir_p(const char *path)
     char *_path = NULL;
     char *p;
 
-    _path = (char*)malloc((len+1)*sizeof(char));
+    _path = (char*)allocateMemory((len+1)*sizeof(char));
     if (_path == NULL){
-      perror("Error: Failed to allocate memory for _path in mkdir_p.");
+      errno = ENOMEM;
+      return -1;
     }
     errno = 0;
 
@@ -47,8 +48,10 @@ int mkdir_p(const char *path)
             *p = '\0';
 
             if (mkdir(_path, S_IRWXU) != 0) {
-                if (errno != EEXIST)
+                if (errno != EEXIST) {
+                    freeMemory(_path);
                     return -1;
+                }
             }
 
             *p = '/';
@@ -56,9 +59,12 @@ int mkdir_p(const char *path)
     }
 
     if (mkdir(_path, S_IRWXU) != 0) {
-        if (errno != EEXIST)
+        if (errno != EEXIST) {
+            freeMemory(_path);
             return -1;
+        }
     }
 
+    freeMemory(_path);
     return 0;
 }
@@ -0,0 +1,243 @@
+/*
+ * parallel.c
+ *
+ * Functions:
+ * ----------
+ *   getNumberOfProcessors: find the number of online processors
+ *   setNumberOfThreads: set the number of threads used by the library
+ *   getNumberOfThreads: find the number of threads used by the library
+ *   parallelFor: run independent tasks on a pool of threads
+ *   startThread: run a function on a new thread
+ *   joinThread: wait for the end of a thread started with startThread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "memory.h"
+#include "parallel.h"
+
+#if !defined(_WIN32)   /* OSX or Linux                */
+#include <unistd.h>     /* sysconf */
+#endif
+
+/*
+*   Number of threads set with setNumberOfThreads
+*   (0: one thread per online processor). Atomic, as it can be set
+*   while comparisons read it on other threads.
+*/
+static atomic_int_t numberOfThreads = 0;
+
+/* Shared state of the threads running parallelFor */
+struct parallel_for {
+  void (*task)(void *arg, int i);
+  void *arg;
+  int nTasks;
+  int next;        /* next task to be run */
+  mutex_t lock;    /* protects next */
+};
+
+/*
+ * Function: getNumberOfProcessors
+ * -------------------------------
+ *   find the number of online processors
+ *
+ *   return: number of processors, at least 1
+ */
+int getNumberOfProcessors(void) {
+  long n;
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  n = (long)info.dwNumberOfProcessors;
+#else
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return (n > 0) ? (int)n : 1;
+}
+
+/*
+ * Function: setNumberOfThreads
+ * ----------------------------
+ *   set the number of threads used by the library (the comparisons running
+ *   on other threads use the previous or the new number of threads)
+ *
+ *   nThreads: number of threads, 0 (default) for one thread per online processor,
+ *             1 to run sequentially
+ */
+void setNumberOfThreads(int nThreads) {
+  atomicStore(&numberOfThreads, (nThreads > 0) ? nThreads : 0);
+}
+
+/*
+ * Function: getNumberOfThreads
+ * ----------------------------
+ *   find the number of threads used by the library
+ *
+ *   return: number of threads set with setNumberOfThreads,
+ *           or number of online processors if not set
+ */
+int getNumberOfThreads(void) {
+  const int n = atomicLoad(&numberOfThreads);
+  return (n > 0) ? n : getNumberOfProcessors();
+}
+
+/*
+ * Function: nextTask
+ * ------------------
+ *   claim the next task to be run
+ *
+ *   pf: shared state of parallelFor
+ *
+ *   return: task index, or -1 if all tasks are claimed
+ */
+static int nextTask(struct parallel_for *pf) {
+  int i;
+  mutexLock(&pf->lock);
+  i = pf->next;
+  if (i < pf->nTasks)
+    pf->next++;
+  mutexUnlock(&pf->lock);
+  return (i < pf->nTasks) ? i : -1;
+}
+
+/*
+ * Function: runTasks
+ * ------------------
+ *   run tasks until all tasks are claimed
+ *
+ *   pf: shared state of parallelFor
+ */
+static void runTasks(struct parallel_for *pf) {
+  int i;
+  while ((i = nextTask(pf)) >= 0)
+    pf->task(pf->arg, i);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI worker(LPVOID pf) {
+  runTasks((struct parallel_for *)pf);
+  return 0;
+}
+#else
+static void *worker(void *pf) {
+  runTasks((struct parallel_for *)pf);
+  return NULL;
+}
+#endif
+
+/*
+ * Function: parallelFor
+ * ---------------------
+ *   run task(arg, i) for i = 0, ..., nTasks-1 on a pool of threads.
+ *   Tasks are claimed in increasing order by the first idle thread,
+ *   the calling thread being one of the threads of the pool.
+ *   If a thread cannot be created, its share of the work is done by the other threads.
+ *
+ *   nTasks: number of tasks
+ *   nThreads: maximum number of threads, including the calling thread
+ *   task: function running task i, which must be safe to call concurrently for different i
+ *   arg: argument passed to task
+ *
+ *   return: number of threads actually used
+ */
+int parallelFor(int nTasks, int nThreads, void (*task)(void *arg, int i), void *arg) {
+  struct parallel_for pf;
+  thread_t *threads;
+  int nStarted = 0;
+  int k;
+
+  if (nThreads > nTasks)
+    nThreads = nTasks;
+  if (nThreads <= 1) {
+    for (k = 0; k < nTasks; k++)
+      task(arg, k);
+    return 1;
+  }
+
+  pf.task = task;
+  pf.arg = arg;
+  pf.nTasks = nTasks;
+  pf.next = 0;
+  mutexInit(&pf.lock);
+
+  threads = allocateMemory((nThreads - 1) * sizeof(thread_t));
+  if (threads != NULL) {
+    for (k = 0; k < nThreads - 1; k++) {
+#if defined(_WIN32)
+      threads[nStarted] = CreateThread(NULL, 0, worker, &pf, 0, NULL);
+      if (threads[nStarted] == NULL)
+        break;
+#else
+      if (pthread_create(&threads[nStarted], NULL, worker, &pf) != 0)
+        break;
+#endif
+      nStarted++;
+    }
+  }
+
+  runTasks(&pf);
+
+  for (k = 0; k < nStarted; k++) {
+#if defined(_WIN32)
+    WaitForSingleObject(threads[k], INFINITE);
+    CloseHandle(threads[k]);
+#else
+    pthread_join(threads[k], NULL);
+#endif
+  }
+  freeMemory(threads);
+  mutexDestroy(&pf.lock);
+  return nStarted + 1;
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI threadMain(LPVOID thread) {
+  ((struct thread *)thread)->run(((struct thread *)thread)->arg);
+  return 0;
+}
+#else
+static void *threadMain(void *thread) {
+  ((struct thread *)thread)->run(((struct thread *)thread)->arg);
+  return NULL;
+}
+#endif
+
+/*
+ * Function: startThread
+ * ---------------------
+ *   run a function on a new thread
+ *
+ *   thread: thread, which must stay valid until joinThread is called
+ *   run: function to be run
+ *   arg: argument passed to run
+ *
+ *   return: 0 if there was success, -1 if the thread cannot be created
+ *           (the caller is then expected to run the work itself)
+ */
+int startThread(struct thread *thread, void (*run)(void *arg), void *arg) {
+  thread->run = run;
+  thread->arg = arg;
+#if defined(_WIN32)
+  thread->handle = CreateThread(NULL, 0, threadMain, thread, 0, NULL);
+  return (thread->handle == NULL) ? -1 : 0;
+#else
+  return (pthread_create(&thread->handle, NULL, threadMain, thread) != 0) ? -1 : 0;
+#endif
+}
+
+/*
+ * Function: joinThread
+ * --------------------
+ *   wait for the end of a thread started with startThread
+ *
+ *   thread: thread
+ */
+void joinThread(struct thread *thread) {
+#if defined(_WIN32)
+  WaitForSingleObject(thread->handle, INFINITE);
+  CloseHandle(thread->handle);
+#else
+  pthread_join(thread->handle, NULL);
+#endif
+}
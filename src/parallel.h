@@ -0,0 +1,65 @@
+/*
+ * parallel.h
+ */
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#if defined(_WIN32)     /* Win32 or Win64                */
+
+#include <windows.h>
+typedef CRITICAL_SECTION mutex_t;
+#define mutexInit(m) InitializeCriticalSection(m)
+#define mutexLock(m) EnterCriticalSection(m)
+#define mutexUnlock(m) LeaveCriticalSection(m)
+#define mutexDestroy(m) DeleteCriticalSection(m)
+typedef CONDITION_VARIABLE cond_t;
+#define condInit(c) InitializeConditionVariable(c)
+#define condWait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define condBroadcast(c) WakeAllConditionVariable(c)
+#define condDestroy(c) ((void)(c))
+typedef HANDLE thread_t;
+typedef volatile LONG atomic_int_t;
+#define atomicLoad(a) ((int)InterlockedCompareExchange(a, 0, 0))
+#define atomicStore(a, v) ((void)InterlockedExchange(a, (LONG)(v)))
+
+#else                   /* OSX or Linux                */
+
+#include <pthread.h>
+typedef pthread_mutex_t mutex_t;
+#define mutexInit(m) pthread_mutex_init(m, NULL)
+#define mutexLock(m) pthread_mutex_lock(m)
+#define mutexUnlock(m) pthread_mutex_unlock(m)
+#define mutexDestroy(m) pthread_mutex_destroy(m)
+typedef pthread_cond_t cond_t;
+#define condInit(c) pthread_cond_init(c, NULL)
+#define condWait(c, m) pthread_cond_wait(c, m)
+#define condBroadcast(c) pthread_cond_broadcast(c)
+#define condDestroy(c) pthread_cond_destroy(c)
+typedef pthread_t thread_t;
+typedef int atomic_int_t;
+#define atomicLoad(a) __atomic_load_n(a, __ATOMIC_RELAXED)
+#define atomicStore(a, v) __atomic_store_n(a, v, __ATOMIC_RELAXED)
+
+#endif
+
+/* Thread started with startThread */
+struct thread {
+  thread_t handle;
+  void (*run)(void *arg);
+  void *arg;
+};
+
+int getNumberOfProcessors(void);
+
+void setNumberOfThreads(int nThreads);
+
+int getNumberOfThreads(void);
+
+int parallelFor(int nTasks, int nThreads, void (*task)(void *arg, int i), void *arg);
+
+int startThread(struct thread *thread, void (*run)(void *arg), void *arg);
+
+void joinThread(struct thread *thread);
+
+#endif /* PARALLEL_H_ */
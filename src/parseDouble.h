@@ -0,0 +1,10 @@
+/*
+ * parseDouble.h
+ */
+
+#ifndef PARSEDOUBLE_H_
+#define PARSEDOUBLE_H_
+
+const char *parseDouble(const char *p, const char *end, double *value);
+
+#endif /* PARSEDOUBLE_H_ */
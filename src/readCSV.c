@@ -6,16 +6,58 @@
  *
  * Functions:
  * ----------
- *   readCSV : reads in CSV file and returns data structure
+ *   file_exist : test if file is in file system
+ *   isSpace : test if a character is white space
+ *   estimateRows : estimate the number of rows of a CSV file
+ *   parsePairs : parse the rows of two numbers of a part of a CSV file
+ *   allocatePairs : allocate the arrays of the data structure returned by readCSV
+ *   readGzipCSV : reads in gzip-compressed CSV file, block by block
+ *   readCSVInContext : reads in CSV file and returns data structure
+ *   readCSV : same as readCSVInContext, with the error messages on stderr
+ *   findColumns : find the indices of columns from their names in a header line
+ *   countRows : count the rows of a chunk of a CSV file
+ *   parseRows : parse the selected columns of a chunk of a CSV file
+ *   loadText : map a CSV file in memory, or decompress it if gzip-compressed
+ *   releaseText : release the content loaded by loadText
+ *   readCSVColumnsInContext : reads in selected columns of a CSV file on several threads
+ *   readCSVColumns : same as readCSVColumnsInContext, with the error messages on stderr
+ *   freeCSVColumns : free the series returned by readCSVColumns
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <sys/stat.h>
 
+#include "context.h"
 #include "data_structure.h"
+#include "mapFile.h"
+#include "parseDouble.h"
+#include "parallel.h"
 #include "readCSV.h"
+#include "readGzip.h"
+
+/* Number of rows used to estimate the number of rows of a file */
+#define ESTIMATE_SAMPLE_ROWS 64
+
+/* Minimum number of bytes per chunk for reading a file on several threads */
+#ifndef MIN_CSV_CHUNK_SIZE
+#define MIN_CSV_CHUNK_SIZE (1 << 20)
+#endif
+
+/* Chunks of a CSV file read by readCSVColumns */
+struct csv_chunks {
+  const char **begin;       /* First character of each chunk (at a row start), begin[nChunks] is the end */
+  size_t *firstRow;         /* First row of each chunk, firstRow[nChunks] is the number of rows */
+  size_t *failedRow;        /* Row of each chunk that cannot be parsed, or SIZE_MAX */
+  const int *columns;       /* Indices of the selected columns (0 is the x column) */
+  const char *selected;     /* Flag of each column index, set if the column is selected */
+  size_t nColumns;          /* Number of selected columns */
+  int lastColumn;           /* Largest selected column index */
+  double *x;                /* x values */
+  double **y;               /* y values of each selected column */
+};
 
 
 /*
@@ -33,85 +75,719 @@ int file_exist (const char *filename)
   return (stat(filename, &buffer) == 0);
 }
 
+/*
+ * Function: isSpace
+ * -----------------
+ *   test if a character is white space, as isspace in the "C" locale
+ *
+ *   c: character
+ *
+ *   returns: TRUE if white space
+ */
+static int isSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+/*
+ * Function: estimateRows
+ * -----------------
+ *   estimate the number of rows of a CSV file from the length of its first rows
+ *
+ *   p: first character of the data rows
+ *   end: end of the file
+ *
+ *   returns: estimated number of rows, with a margin
+ */
+static size_t estimateRows(const char *p, const char *end) {
+  const char *q = p;
+  size_t nLines = 0;
+  while (nLines < ESTIMATE_SAMPLE_ROWS && q < end) {
+    const char *nl = memchr(q, '\n', (size_t)(end - q));
+    q = (nl == NULL) ? end : nl + 1;
+    nLines++;
+  }
+  if (nLines == 0)
+    return 1;
+  // Average row length of the sample, with a margin of 1/8 for shorter rows.
+  size_t nRows = (size_t)((double)(end - p) / ((double)(q - p) / nLines));
+  return nRows + nRows / 8 + 16;
+}
+
+/*
+ * Function: parsePairs
+ * -----------------
+ *   parse the rows of two numbers of a part of a CSV file, delimited by comma or semicolon.
+ *   The rows are the same as with fscanf(fp, "%lf%*[,;]%lf\n", ...).
+ *
+ *   ctx: context receiving the error messages
+ *   p: first character
+ *   end: end of the part
+ *   final: set if the part is the end of the file; otherwise, the part must end with
+ *          a new line, and a row continued after the part is left for the next call
+ *   inputs: data structure receiving the rows
+ *   arraySize: number of rows allocated in inputs, updated when the arrays grow
+ *   stop: set to 1 if a row does not hold two numbers (reading stops there),
+ *         or to -1 if the memory cannot be allocated
+ *
+ *   returns: first character not parsed
+ */
+static const char *parsePairs(context_t *ctx, const char *p, const char *end, int final, struct data *inputs, size_t *arraySize, int *stop) {
+  for (;;) {
+    const char *row = p;
+    double t, v;
+    while (p < end && isSpace(*p))
+      p++;
+    if (p == end && !final)
+      return row;
+    p = parseDouble(p, end, &t);
+    if (p == NULL || p >= end || (*p != ',' && *p != ';'))
+      break;
+    while (p < end && (*p == ',' || *p == ';'))
+      p++;
+    while (p < end && isSpace(*p))
+      p++;
+    if (p == end && !final)
+      return row;
+    p = parseDouble(p, end, &v);
+    if (p == NULL)
+      break;
+    if (inputs->n == *arraySize) {
+      // need more space
+      double *time_tmp = realloc(inputs->x, sizeof(double)*(2 * *arraySize));
+      if (time_tmp != NULL)
+        inputs->x = time_tmp;
+      double *value_tmp = realloc(inputs->y, sizeof(double)*(2 * *arraySize));
+      if (value_tmp != NULL)
+        inputs->y = value_tmp;
+      if (time_tmp == NULL || value_tmp == NULL) {
+        logError(ctx, "Fatal error -- out of memory!\n");
+        *stop = -1;
+        return p;
+      }
+      *arraySize *= 2;
+    }
+    inputs->x[inputs->n] = t;
+    inputs->y[inputs->n] = v;
+    inputs->n++;
+  }
+  *stop = 1;
+  return p;
+}
+
+/*
+ * Function: allocatePairs
+ * -----------------
+ *   allocate the arrays of the data structure returned by readCSV
+ *
+ *   ctx: context receiving the error messages
+ *   inputs: data structure
+ *   arraySize: number of rows
+ *
+ *   returns: 0 if there was success, -1 if the memory cannot be allocated
+ */
+static int allocatePairs(context_t *ctx, struct data *inputs, size_t arraySize) {
+  inputs->n = 0;
+  inputs->x = malloc(sizeof(double) * arraySize);
+  if (inputs->x == NULL){
+    logError(ctx, "Error: Failed to allocate memory for time.\n");
+    return -1;
+  }
+  inputs->y = malloc(sizeof(double) * arraySize);
+  if (inputs->y == NULL){
+    logError(ctx, "Error: Failed to allocate memory for value.\n");
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Function: readGzipCSV
+ * -----------------
+ *   read in gzip-compressed CSV file, block by block as the content is decompressed
+ *   (see openGzip), without temporary file. The complete rows of each block are parsed,
+ *   and the last row is carried over to the next block.
+ *
+ *   ctx: context receiving the error messages
+ *   filename: path to the CSV file
+ *   skipLines: number of head lines to be skipped (of any length)
+ *   inputs: data structure receiving the rows
+ *   arraySize: number of rows allocated in inputs
+ *
+ *   returns: 0 if there was success, -1 otherwise (with a message in the context)
+ */
+static int readGzipCSV(context_t *ctx, const char *filename, int skipLines, struct data *inputs, size_t *arraySize) {
+  struct gzip_reader *reader = openGzip(ctx, filename);
+  char *buffer = NULL;
+  size_t length = 0, capacity = 0;
+  const char *block;
+  size_t blockSize;
+  int skipped = 0, stop = 0, retVal = 0;
+
+  if (reader == NULL)
+    return -1;
+  for (;;) {
+    if (readGzip(reader, &block, &blockSize) != 0) {
+      logError(ctx, "Error: Failed to read %s.\n", filename);
+      retVal = -1;
+      break;
+    }
+    if (length + blockSize > capacity) {
+      capacity = 2 * (length + blockSize);
+      char *buffer_tmp = realloc(buffer, capacity);
+      if (buffer_tmp == NULL) {
+        logError(ctx, "Fatal error -- out of memory!\n");
+        retVal = -1;
+        break;
+      }
+      buffer = buffer_tmp;
+    }
+    if (blockSize > 0)
+      memcpy(buffer + length, block, blockSize);
+    length += blockSize;
+
+    const char *p = buffer;
+    const char *end = buffer + length;
+    const char *last = end;  // end of the last complete row
+    while (blockSize > 0 && last > p && last[-1] != '\n')
+      last--;
+    for (; skipped < skipLines; skipped++) {
+      const char *nl = memchr(p, '\n', (size_t)(last - p));
+      if (nl == NULL)
+        break;
+      p = nl + 1;
+    }
+    if (blockSize == 0) {
+      // End of the content
+      for (; skipped < skipLines && retVal == 0; skipped++) {
+        if (p >= end) {
+          logError(ctx, "Error: Failed to skip lines.\n");
+          retVal = -1;
+          break;
+        }
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        p = (nl == NULL) ? end : nl + 1;
+      }
+      if (retVal == 0 && inputs->x == NULL)
+        retVal = allocatePairs(ctx, inputs, *arraySize = estimateRows(p, end));
+      if (retVal == 0)
+        parsePairs(ctx, p, end, 1, inputs, arraySize, &stop);
+      break;
+    }
+    if (skipped == skipLines && last > p) {
+      if (inputs->x == NULL && allocatePairs(ctx, inputs, *arraySize = estimateRows(p, last)) != 0) {
+        retVal = -1;
+        break;
+      }
+      p = parsePairs(ctx, p, last, 0, inputs, arraySize, &stop);
+      if (stop)
+        break;
+    }
+    length = (size_t)(end - p);
+    memmove(buffer, p, length);
+  }
+
+  free(buffer);
+  closeGzip(reader);
+  return (stop < 0) ? -1 : retVal;
+}
+
 /*
  * Function: readCSV
  * -----------------
  *   read in CSV file and returns data structure. The CSV file should be two columns, delimited by comma or semicolon.
+ *   The file is mapped in memory, and the numbers are parsed independently of the locale (see parseDouble).
+ *   A gzip-compressed file is decompressed while it is parsed, without temporary file (see readGzipCSV).
+ *   Reading stops at the first row that does not hold two numbers.
  *
+ *   ctx: context receiving the error messages
  *   filename: path to the CSV file
- *   skipLines: number of head lines to be skipped
+ *   skipLines: number of head lines to be skipped (of any length)
  *
  *   returns: the data structure "inputs", which includes fist and second data set, and the number of rows
+ *            (no arrays and 0 rows if the file cannot be read, with a message in the context)
  */
-struct data readCSV(const char * filename, int skipLines) {
+struct data readCSVInContext(context_t *ctx, const char * filename, int skipLines) {
   int i;
-  struct data inputs;
-  double *time;
-  double *value;
-  int arraySize = 1;
-  int rowCount = 0;
-  char buf[100];
-
-  FILE *fp;
+  struct data inputs = {NULL, NULL, 0};
+  struct mapped_file map;
+  size_t arraySize = 0;
+  int stop = 0, retVal = 0;
 
+  clearContextError(ctx);
   if (!file_exist(filename))
   {
-    fprintf(stderr, "No such file: %s\n", filename);
-    exit(1);
+    logError(ctx, "No such file: %s\n", filename);
+    return inputs;
   }
 
-  fp = fopen(filename, "r");
-  if (!(fp)) {
-    fprintf(stderr, "Cannot open file: %s\n", filename);
-    exit(1);
+  if (isGzipFile(filename)) {
+    retVal = readGzipCSV(ctx, filename, skipLines, &inputs, &arraySize);
+  } else {
+    if (mapFile(filename, &map) != 0) {
+      logError(ctx, "Cannot open file: %s\n", filename);
+      return inputs;
+    }
+    const char *p = map.data;
+    const char *end = p + map.size;
+
+    for (i=0; i<skipLines; i++) {
+      if (p >= end) { // skip the first "skipLines" lines
+        logError(ctx, "Error: Failed to skip lines.\n");
+        unmapFile(&map);
+        return inputs;
+      }
+      const char *nl = memchr(p, '\n', (size_t)(end - p));
+      p = (nl == NULL) ? end : nl + 1;
+    }
+
+    arraySize = estimateRows(p, end);
+    retVal = allocatePairs(ctx, &inputs, arraySize);
+    if (retVal == 0) {
+      parsePairs(ctx, p, end, 1, &inputs, &arraySize, &stop);
+      retVal = (stop < 0) ? -1 : 0;
+    }
+    unmapFile(&map);
+  }
+  if (retVal != 0) {
+    free(inputs.x);
+    free(inputs.y);
+    return (struct data){NULL, NULL, 0};
   }
 
-  time = malloc(sizeof(double) * arraySize);
-  if (time == NULL){
-    fputs("Error: Failed to allocate memory for time.\n", stderr);
-    fclose(fp);
-    exit(1);
+  // Release the memory reserved beyond the estimated number of rows.
+  if (inputs.n > 0 && inputs.n < arraySize) {
+    double *time_tmp = realloc(inputs.x, sizeof(double)*inputs.n);
+    double *value_tmp = realloc(inputs.y, sizeof(double)*inputs.n);
+    if (time_tmp != NULL)
+      inputs.x = time_tmp;
+    if (value_tmp != NULL)
+      inputs.y = value_tmp;
   }
-  value = malloc(sizeof(double) * arraySize);
-  if (value == NULL){
-    fputs("Error: Failed to allocate memory for value.\n", stderr);
-    fclose(fp);
-    exit(1);
+
+  return inputs;
+}
+
+/*
+ * Function: readCSV
+ * -----------------
+ *   same as readCSVInContext, with the error messages on stderr
+ */
+struct data readCSV(const char * filename, int skipLines) {
+  context_t ctx;
+  initContext(&ctx, NULL);
+  struct data inputs = readCSVInContext(&ctx, filename, skipLines);
+  releaseContext(&ctx);
+  return inputs;
+}
+
+/*
+ * Function: findColumns
+ * -----------------
+ *   find the indices of columns from their names in a header line.
+ *   The names are delimited by comma or semicolon, and may be surrounded by
+ *   white space and double quotes.
+ *
+ *   p: first character of the header line
+ *   end: end of the file
+ *   names: column names
+ *   nColumns: number of column names
+ *   columns: array receiving the column indices
+ *
+ *   returns: index of the first name not found, or nColumns if all names were found
+ */
+static size_t findColumns(const char *p, const char *end, const char **names, size_t nColumns, int *columns) {
+  const char *eol = memchr(p, '\n', (size_t)(end - p));
+  size_t k;
+  int column = 0;
+
+  if (eol == NULL)
+    eol = end;
+  for (k = 0; k < nColumns; k++)
+    columns[k] = -1;
+  while (p <= eol) {
+    const char *q = p;
+    while (q < eol && *q != ',' && *q != ';')
+      q++;
+    const char *b = p, *e = q;  // trimmed name
+    while (b < e && (isSpace(*b) || *b == '"'))
+      b++;
+    while (e > b && (isSpace(e[-1]) || e[-1] == '"'))
+      e--;
+    for (k = 0; k < nColumns; k++) {
+      if (columns[k] < 0 && strlen(names[k]) == (size_t)(e - b) && memcmp(names[k], b, (size_t)(e - b)) == 0)
+        columns[k] = column;
+    }
+    column++;
+    p = q + 1;
+  }
+  for (k = 0; k < nColumns; k++) {
+    if (columns[k] < 0)
+      return k;
+  }
+  return nColumns;
+}
+
+/*
+ * Function: countRows
+ * -----------------
+ *   count the rows of a chunk of a CSV file (task of parallelFor).
+ *   Blank lines are not counted.
+ *
+ *   arg: pointer to csv_chunks struct
+ *   k: chunk index
+ */
+static void countRows(void *arg, int k) {
+  struct csv_chunks *ch = (struct csv_chunks *)arg;
+  const char *p = ch->begin[k], *end = ch->begin[k+1];
+  size_t nRows = 0;
+  while (p < end) {
+    while (p < end && isSpace(*p))
+      p++;
+    if (p == end)
+      break;
+    nRows++;
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    p = (nl == NULL) ? end : nl + 1;
   }
+  ch->firstRow[k+1] = nRows;
+}
+
+/*
+ * Function: parseRows
+ * -----------------
+ *   parse the selected columns of a chunk of a CSV file (task of parallelFor).
+ *   The values are written at the rows of the chunk found by countRows.
+ *   The columns after the last selected column are not parsed.
+ *
+ *   arg: pointer to csv_chunks struct
+ *   k: chunk index
+ */
+static void parseRows(void *arg, int k) {
+  struct csv_chunks *ch = (struct csv_chunks *)arg;
+  const char *p = ch->begin[k], *end = ch->begin[k+1];
+  size_t row = ch->firstRow[k];
+  size_t j;
 
-  memset(time,0,sizeof(double)*arraySize);
-  memset(value,0,sizeof(double)*arraySize);
+  ch->failedRow[k] = SIZE_MAX;
+  while (p < end) {
+    while (p < end && isSpace(*p))
+      p++;
+    if (p == end)
+      break;
+    for (int column = 0; column <= ch->lastColumn; column++) {
+      while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+      if (column == 0 || ch->selected[column]) {
+        double value;
+        p = parseDouble(p, end, &value);
+        if (p == NULL) {
+          ch->failedRow[k] = row;
+          return;
+        }
+        if (column == 0)
+          ch->x[row] = value;
+        for (j = 0; j < ch->nColumns; j++) {
+          if (ch->columns[j] == column)
+            ch->y[j][row] = value;
+        }
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+          p++;
+      } else {
+        while (p < end && *p != ',' && *p != ';' && *p != '\n')
+          p++;
+      }
+      // Delimiter, or end of row after the last selected column
+      if (p < end && (*p == ',' || *p == ';')) {
+        p++;
+      } else if (column < ch->lastColumn || (p < end && *p != '\n')) {
+        ch->failedRow[k] = row;
+        return;
+      }
+    }
+    row++;
+    const char *nl = memchr(p - 1, '\n', (size_t)(end - p + 1));
+    p = (nl == NULL) ? end : nl + 1;
+  }
+}
 
-  for (i=0; i<skipLines; i++) {
-    if (fgets(buf, 100, fp) == NULL) { // skip the first "skipLines" lines
-      fputs("Error: Failed to skip lines with fgets.\n", stderr);
-      fclose(fp);
-      exit(1);
+/*
+ * Function: loadText
+ * -----------------
+ *   map a CSV file in memory, or decompress it in memory if gzip-compressed
+ *
+ *   ctx: context receiving the error messages
+ *   filename: path to the CSV file
+ *   map: mapping of the file, set if the file is not compressed
+ *   text: decompressed content, set if the file is compressed
+ *   begin, end: pointers receiving the first character and the end of the content
+ *
+ *   returns: 0 if there was success, -1 otherwise (with a message in the context)
+ */
+static int loadText(context_t *ctx, const char *filename, struct mapped_file *map, char **text, const char **begin, const char **end) {
+  map->data = NULL;
+  map->size = 0;
+  *text = NULL;
+  if (!isGzipFile(filename)) {
+    if (mapFile(filename, map) != 0) {
+      logError(ctx, "Cannot open file: %s\n", filename);
+      return -1;
     }
+    *begin = map->data;
+    *end = *begin + map->size;
+    return 0;
   }
 
-  while (fscanf(fp, "%lf%*[,;]%lf\n", &time[rowCount], &value[rowCount]) == 2) {
-    if (rowCount == arraySize ) {
-      // need more space
-      arraySize += 5;
-      double *time_tmp = realloc(time, sizeof(double)*(arraySize+1));
-      double *value_tmp = realloc(value, sizeof(double)*(arraySize+1));
-      if (time_tmp == NULL || value_tmp == NULL) {
-        fputs("Fatal error -- out of memory!\n", stderr);
-        fclose(fp);
-        exit(1);
+  struct gzip_reader *reader = openGzip(ctx, filename);
+  const char *block;
+  size_t blockSize, length = 0, capacity = 1 << 20;
+  if (reader == NULL)
+    return -1;
+  *text = malloc(capacity);
+  if (*text == NULL) {
+    logError(ctx, "Fatal error -- out of memory!\n");
+    closeGzip(reader);
+    return -1;
+  }
+  do {
+    if (readGzip(reader, &block, &blockSize) != 0) {
+      logError(ctx, "Error: Failed to read %s.\n", filename);
+      free(*text);
+      *text = NULL;
+      closeGzip(reader);
+      return -1;
+    }
+    if (length + blockSize > capacity) {
+      capacity = 2 * (length + blockSize);
+      char *text_tmp = realloc(*text, capacity);
+      if (text_tmp == NULL) {
+        logError(ctx, "Fatal error -- out of memory!\n");
+        free(*text);
+        *text = NULL;
+        closeGzip(reader);
+        return -1;
       }
-      time = time_tmp;
-      value = value_tmp;
+      *text = text_tmp;
     }
-    rowCount++;
+    if (blockSize > 0)
+      memcpy(*text + length, block, blockSize);
+    length += blockSize;
+  } while (blockSize > 0);
+  closeGzip(reader);
+  *begin = *text;
+  *end = *begin + length;
+  return 0;
+}
+
+/*
+ * Function: releaseText
+ * -----------------
+ *   release the content loaded by loadText
+ *
+ *   map: mapping of the file
+ *   text: decompressed content
+ */
+static void releaseText(struct mapped_file *map, char *text) {
+  if (text != NULL)
+    free(text);
+  else
+    unmapFile(map);
+}
+
+/*
+ * Function: readCSVColumns
+ * -----------------
+ *   read in selected columns of a CSV file. The first column holds the x values,
+ *   and the other columns are delimited by comma or semicolon. Blank lines are skipped.
+ *   The file is mapped in memory and split into chunks at row boundaries, which are
+ *   parsed on several threads in a single pass for all selected columns.
+ *   A gzip-compressed file is first decompressed in memory (see loadText).
+ *
+ *   ctx: context receiving the error messages
+ *   filename: path to the CSV file
+ *   skipLines: number of head lines to be skipped; the column names are read from the last one
+ *   names: names of the columns to read, or NULL to select the columns by indices
+ *   indices: indices of the columns to read (the x column has index 0), used if names is NULL
+ *   nColumns: number of columns to read
+ *   nThreads: number of threads, 0 for the library setting (see setNumberOfThreads)
+ *   series: array of nColumns data structures receiving the columns, which share
+ *           the same x array; to be freed with freeCSVColumns
+ *
+ *   returns: 0 if there was success, -1 otherwise (with a message in the context)
+ */
+int readCSVColumnsInContext(
+  context_t *ctx,
+  const char *filename,
+  int skipLines,
+  const char **names,
+  const int *indices,
+  size_t nColumns,
+  int nThreads,
+  struct data *series
+) {
+  struct mapped_file map;
+  char *text;
+  const char *p, *end;
+  const char *header = NULL;
+  size_t j;
+  int i, k, retVal = 0;
+  struct csv_chunks ch = {NULL, NULL, NULL, NULL, NULL, nColumns, 0, NULL, NULL};
+  char *selected = NULL;
+
+  clearContextError(ctx);
+  for (j = 0; j < nColumns; j++)
+    series[j] = (struct data){NULL, NULL, 0};
+  if (loadText(ctx, filename, &map, &text, &p, &end) != 0)
+    return -1;
+  for (i = 0; i < skipLines; i++) {
+    if (p >= end) {
+      logError(ctx, "Error: Failed to skip lines.\n");
+      releaseText(&map, text);
+      return -1;
+    }
+    header = p;
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    p = (nl == NULL) ? end : nl + 1;
   }
 
-  fclose(fp);
+  int *columns = malloc((nColumns + 1) * sizeof(int));
+  if (columns == NULL) {
+    logError(ctx, "Error: Failed to allocate memory for columns.\n");
+    retVal = -1;
+    goto cleanup;
+  }
+  if (names != NULL) {
+    j = (header == NULL) ? 0 : findColumns(header, end, names, nColumns, columns);
+    if (j < nColumns) {
+      logError(ctx, "Error: Column %s not found in %s.\n", names[j], filename);
+      retVal = -1;
+      goto cleanup;
+    }
+  } else {
+    memcpy(columns, indices, nColumns * sizeof(int));
+  }
+  ch.columns = columns;
+  for (j = 0; j < nColumns; j++) {
+    if (columns[j] < 0) {
+      logError(ctx, "Error: Invalid column index %d.\n", columns[j]);
+      retVal = -1;
+      goto cleanup;
+    }
+    if (columns[j] > ch.lastColumn)
+      ch.lastColumn = columns[j];
+  }
+  selected = calloc((size_t)ch.lastColumn + 1, 1);
+  if (selected == NULL) {
+    logError(ctx, "Error: Failed to allocate memory for columns.\n");
+    retVal = -1;
+    goto cleanup;
+  }
+  for (j = 0; j < nColumns; j++)
+    selected[columns[j]] = 1;
+  ch.selected = selected;
 
-  inputs.x = time;
-  inputs.y = value;
-  inputs.n = rowCount;
+  // ===== 1. Chunks starting at row boundaries =====
+  if (nThreads <= 0)
+    nThreads = getNumberOfThreads();
+  int nChunks = (int)((size_t)(end - p) / MIN_CSV_CHUNK_SIZE);
+  nChunks = (nChunks < nThreads) ? nChunks : nThreads;
+  nChunks = (nChunks < 1) ? 1 : nChunks;
+  ch.begin = malloc((nChunks + 1) * sizeof(const char *));
+  ch.firstRow = malloc((nChunks + 1) * sizeof(size_t));
+  ch.failedRow = malloc(nChunks * sizeof(size_t));
+  ch.y = calloc(nColumns + 1, sizeof(double *));
+  if ((ch.begin == NULL) || (ch.firstRow == NULL) || (ch.failedRow == NULL) || (ch.y == NULL)) {
+    logError(ctx, "Error: Failed to allocate memory for chunks.\n");
+    retVal = -1;
+    goto cleanup;
+  }
+  ch.begin[0] = p;
+  ch.begin[nChunks] = end;
+  for (k = 1; k < nChunks; k++) {
+    const char *q = p + (size_t)k * (size_t)(end - p) / (size_t)nChunks;
+    const char *nl = (q < ch.begin[k-1]) ? NULL : memchr(q, '\n', (size_t)(end - q));
+    ch.begin[k] = (q < ch.begin[k-1]) ? ch.begin[k-1] : ((nl == NULL) ? end : nl + 1);
+  }
 
-  return inputs;
+  // ===== 2. Rows of each chunk =====
+  parallelFor(nChunks, nThreads, countRows, &ch);
+  ch.firstRow[0] = 0;
+  for (k = 0; k < nChunks; k++)
+    ch.firstRow[k+1] += ch.firstRow[k];
+  const size_t nRows = ch.firstRow[nChunks];
+
+  // ===== 3. Values of each chunk =====
+  ch.x = malloc((nRows + 1) * sizeof(double));
+  for (j = 0; j < nColumns; j++) {
+    series[j] = (struct data){ch.x, NULL, nRows};
+    ch.y[j] = malloc((nRows + 1) * sizeof(double));
+    series[j].y = ch.y[j];
+    if (ch.y[j] == NULL)
+      retVal = -1;
+  }
+  if (ch.x == NULL || retVal != 0) {
+    logError(ctx, "Error: Failed to allocate memory for values.\n");
+    retVal = -1;
+    goto cleanup;
+  }
+  parallelFor(nChunks, nThreads, parseRows, &ch);
+  for (k = 0; k < nChunks && retVal == 0; k++) {
+    if (ch.failedRow[k] != SIZE_MAX) {
+      logError(ctx, "Error: Failed to parse data row %zu of %s.\n", ch.failedRow[k] + 1, filename);
+      retVal = -1;
+    }
+  }
+
+  cleanup:
+  if (nColumns == 0 || series[0].x == NULL)
+    free(ch.x);
+  if (retVal != 0)
+    freeCSVColumns(series, nColumns);
+  free(ch.begin);
+  free(ch.firstRow);
+  free(ch.failedRow);
+  free(ch.y);
+  free(selected);
+  free(columns);
+  releaseText(&map, text);
+  return retVal;
+}
+
+/*
+ * Function: readCSVColumns
+ * -----------------
+ *   same as readCSVColumnsInContext, with the error messages on stderr
+ */
+int readCSVColumns(
+  const char *filename,
+  int skipLines,
+  const char **names,
+  const int *indices,
+  size_t nColumns,
+  int nThreads,
+  struct data *series
+) {
+  context_t ctx;
+  int retVal;
+  initContext(&ctx, NULL);
+  retVal = readCSVColumnsInContext(&ctx, filename, skipLines, names, indices, nColumns, nThreads, series);
+  releaseContext(&ctx);
+  return retVal;
+}
+
+/*
+ * Function: freeCSVColumns
+ * -----------------
+ *   free the series returned by readCSVColumns
+ *
+ *   series: series returned by readCSVColumns
+ *   nColumns: number of series
+ */
+void freeCSVColumns(struct data *series, size_t nColumns) {
+  size_t j;
+  if (nColumns > 0)
+    free(series[0].x);
+  for (j = 0; j < nColumns; j++) {
+    free(series[j].y);
+    series[j] = (struct data){NULL, NULL, 0};
+  }
 }
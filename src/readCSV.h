@@ -8,6 +8,36 @@
 #ifndef READCSV_H_
 #define READCSV_H_
 
+#include <stddef.h>
+
+#include "context.h"
+#include "data_structure.h"
+
+struct data readCSVInContext(context_t *ctx, const char * filename, int skipLines);
+
 struct data readCSV(const char * filename, int skipLines);
 
+int readCSVColumnsInContext(
+  context_t *ctx,
+  const char *filename,
+  int skipLines,
+  const char **names,
+  const int *indices,
+  size_t nColumns,
+  int nThreads,
+  struct data *series
+);
+
+int readCSVColumns(
+  const char *filename,
+  int skipLines,
+  const char **names,
+  const int *indices,
+  size_t nColumns,
+  int nThreads,
+  struct data *series
+);
+
+void freeCSVColumns(struct data *series, size_t nColumns);
+
 #endif /* READCSV_H_ */
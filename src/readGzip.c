@@ -0,0 +1,301 @@
+/*
+ * readGzip.c
+ *
+ * Functions:
+ * ----------
+ *   isGzipFile: test if a file starts with the gzip magic number
+ *   inflateBlock: decompress the next block of a gzip file
+ *   inflateLoop: decompress all blocks of a gzip file (second thread)
+ *   openGzip: open a gzip file to read its decompressed content
+ *   readGzip: get the next block of decompressed content
+ *   closeGzip: close a gzip file opened with openGzip
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "context.h"
+#include "mapFile.h"
+#include "memory.h"
+#include "parallel.h"
+#include "readGzip.h"
+
+#if defined(FUNNEL_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+/* Number of bytes of decompressed content per block */
+#define GZIP_BLOCK_SIZE (1 << 20)
+
+/* Number of blocks shared with the second thread */
+#define GZIP_QUEUE_LENGTH 4
+
+/* Minimum number of compressed bytes for decompressing on a second thread */
+#ifndef GZIP_THREAD_MIN_SIZE
+#define GZIP_THREAD_MIN_SIZE (1 << 20)
+#endif
+
+/* Maximum number of compressed bytes passed to zlib at once (avail_in is an unsigned int) */
+#define GZIP_MAX_INPUT (1 << 30)
+
+/*
+ * Function: isGzipFile
+ * --------------------
+ *   test if a file starts with the gzip magic number
+ *
+ *   filename: path to the file
+ *
+ *   return: true if the file is compressed with gzip
+ */
+bool isGzipFile(const char *filename) {
+  unsigned char magic[2];
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL)
+    return false;
+  size_t n = fread(magic, 1, 2, fp);
+  fclose(fp);
+  return n == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+#if defined(FUNNEL_HAVE_ZLIB)
+
+/* Gzip file and blocks of decompressed content */
+struct gzip_reader {
+  context_t *ctx;           /* Context receiving the error messages */
+  struct mapped_file map;   /* Compressed file */
+  z_stream stream;          /* State of zlib */
+  size_t offset;            /* Number of bytes of the file passed to zlib */
+  bool ended;               /* Set when the whole content is decompressed */
+  char *buffer;             /* Blocks of decompressed content */
+  size_t sizes[GZIP_QUEUE_LENGTH];  /* Number of bytes in each block */
+  bool threaded;            /* Set if the blocks are decompressed on a second thread */
+  struct thread thread;     /* Second thread */
+  mutex_t lock;             /* Protects the members below */
+  cond_t changed;           /* Signaled when the members below change */
+  size_t produced;          /* Number of blocks decompressed */
+  size_t consumed;          /* Number of blocks returned by readGzip */
+  int status;               /* Status of the second thread: 0 running, 1 ended, -1 failed */
+  bool stop;                /* Set by closeGzip to stop the second thread */
+};
+
+/*
+ * Function: inflateBlock
+ * ----------------------
+ *   decompress the next block of a gzip file.
+ *   Files with several gzip members (concatenated files) are read as one file.
+ *
+ *   reader: gzip file
+ *   out: block receiving GZIP_BLOCK_SIZE bytes at most
+ *
+ *   return: number of decompressed bytes (less than GZIP_BLOCK_SIZE at the end only),
+ *           or -1 if the data is corrupted (with a message in the context of the reader)
+ */
+static long inflateBlock(struct gzip_reader *reader, char *out) {
+  z_stream *s = &reader->stream;
+  const unsigned char *in = reader->map.data;
+
+  s->next_out = (Bytef *)out;
+  s->avail_out = GZIP_BLOCK_SIZE;
+  while (s->avail_out > 0 && !reader->ended) {
+    if (s->avail_in == 0) {
+      size_t n = reader->map.size - reader->offset;
+      if (n == 0) {
+        logError(reader->ctx, "Error: Unexpected end of gzip data.\n");
+        return -1;
+      }
+      n = (n < GZIP_MAX_INPUT) ? n : GZIP_MAX_INPUT;
+      s->next_in = (Bytef *)(in + reader->offset);
+      s->avail_in = (uInt)n;
+      reader->offset += n;
+    }
+    int ret = inflate(s, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END) {
+      if (s->avail_in == 0 && reader->offset == reader->map.size)
+        reader->ended = true;
+      else if (inflateReset(s) != Z_OK)
+        return -1;
+    } else if (ret != Z_OK) {
+      logError(reader->ctx, "Error: Failed to decompress gzip data (%s).\n", (s->msg != NULL) ? s->msg : "invalid data");
+      return -1;
+    }
+  }
+  return (long)(GZIP_BLOCK_SIZE - s->avail_out);
+}
+
+/*
+ * Function: inflateLoop
+ * ---------------------
+ *   decompress all blocks of a gzip file (function run on the second thread).
+ *   Up to GZIP_QUEUE_LENGTH - 1 blocks are decompressed ahead of readGzip,
+ *   the remaining block being the one in use by the caller of readGzip.
+ *
+ *   arg: gzip file
+ */
+static void inflateLoop(void *arg) {
+  struct gzip_reader *reader = (struct gzip_reader *)arg;
+  for (;;) {
+    mutexLock(&reader->lock);
+    while (!reader->stop && reader->produced - reader->consumed >= GZIP_QUEUE_LENGTH - 1)
+      condWait(&reader->changed, &reader->lock);
+    bool stop = reader->stop;
+    size_t k = reader->produced % GZIP_QUEUE_LENGTH;
+    mutexUnlock(&reader->lock);
+    if (stop)
+      return;
+
+    long n = inflateBlock(reader, reader->buffer + k * GZIP_BLOCK_SIZE);
+
+    mutexLock(&reader->lock);
+    if (n < 0) {
+      reader->status = -1;
+    } else {
+      reader->sizes[k] = (size_t)n;
+      reader->produced++;
+      if (reader->ended)
+        reader->status = 1;
+    }
+    condBroadcast(&reader->changed);
+    mutexUnlock(&reader->lock);
+    if (n < 0 || reader->ended)
+      return;
+  }
+}
+
+/*
+ * Function: openGzip
+ * ------------------
+ *   open a gzip file to read its decompressed content block by block, without temporary file.
+ *   If the file is large and the library uses several threads (see setNumberOfThreads),
+ *   the content is decompressed on a second thread while the caller processes the blocks.
+ *
+ *   ctx: context receiving the error messages, used until closeGzip
+ *   filename: path to the gzip file
+ *
+ *   return: reader to be closed with closeGzip, or NULL if the file cannot
+ *           be opened or the memory cannot be allocated (with a message in the context)
+ */
+struct gzip_reader *openGzip(context_t *ctx, const char *filename) {
+  struct gzip_reader *reader = allocateZeroed(1, sizeof(struct gzip_reader));
+  if (reader == NULL) {
+    logError(ctx, "Error: Failed to allocate memory for gzip reader.\n");
+    return NULL;
+  }
+  reader->ctx = ctx;
+  if (mapFile(filename, &reader->map) != 0) {
+    logError(ctx, "Cannot open file: %s\n", filename);
+    freeMemory(reader);
+    return NULL;
+  }
+  if (inflateInit2(&reader->stream, 15 + 16) != Z_OK) {  // gzip header only
+    logError(ctx, "Error: Failed to initialize zlib.\n");
+    unmapFile(&reader->map);
+    freeMemory(reader);
+    return NULL;
+  }
+  reader->threaded = reader->map.size >= GZIP_THREAD_MIN_SIZE && getNumberOfThreads() > 1;
+  reader->buffer = allocateMemory((reader->threaded ? GZIP_QUEUE_LENGTH : 1) * (size_t)GZIP_BLOCK_SIZE);
+  if (reader->buffer == NULL) {
+    logError(ctx, "Error: Failed to allocate memory for gzip reader.\n");
+    inflateEnd(&reader->stream);
+    unmapFile(&reader->map);
+    freeMemory(reader);
+    return NULL;
+  }
+  if (reader->threaded) {
+    mutexInit(&reader->lock);
+    condInit(&reader->changed);
+    if (startThread(&reader->thread, inflateLoop, reader) != 0) {
+      condDestroy(&reader->changed);
+      mutexDestroy(&reader->lock);
+      reader->threaded = false;
+    }
+  }
+  return reader;
+}
+
+/*
+ * Function: readGzip
+ * ------------------
+ *   get the next block of decompressed content, which is valid until the next call
+ *
+ *   reader: reader returned by openGzip
+ *   data: pointer receiving the first byte of the block
+ *   size: pointer receiving the number of bytes of the block, 0 at the end of the content
+ *
+ *   return: 0 if there was success, -1 if the data is corrupted (with a message in the context of the reader)
+ */
+int readGzip(struct gzip_reader *reader, const char **data, size_t *size) {
+  int retVal = 0;
+
+  *size = 0;
+  if (!reader->threaded) {
+    if (reader->ended)
+      return 0;
+    long n = inflateBlock(reader, reader->buffer);
+    if (n < 0)
+      return -1;
+    *data = reader->buffer;
+    *size = (size_t)n;
+    return 0;
+  }
+
+  mutexLock(&reader->lock);
+  while (reader->produced == reader->consumed && reader->status == 0)
+    condWait(&reader->changed, &reader->lock);
+  if (reader->produced > reader->consumed) {
+    size_t k = reader->consumed % GZIP_QUEUE_LENGTH;
+    *data = reader->buffer + k * GZIP_BLOCK_SIZE;
+    *size = reader->sizes[k];
+    reader->consumed++;
+  } else if (reader->status < 0) {
+    retVal = -1;
+  }
+  condBroadcast(&reader->changed);
+  mutexUnlock(&reader->lock);
+  return retVal;
+}
+
+/*
+ * Function: closeGzip
+ * -------------------
+ *   close a gzip file opened with openGzip, before or after the end of its content
+ *
+ *   reader: reader returned by openGzip, or NULL
+ */
+void closeGzip(struct gzip_reader *reader) {
+  if (reader == NULL)
+    return;
+  if (reader->threaded) {
+    mutexLock(&reader->lock);
+    reader->stop = true;
+    condBroadcast(&reader->changed);
+    mutexUnlock(&reader->lock);
+    joinThread(&reader->thread);
+    condDestroy(&reader->changed);
+    mutexDestroy(&reader->lock);
+  }
+  inflateEnd(&reader->stream);
+  unmapFile(&reader->map);
+  freeMemory(reader->buffer);
+  freeMemory(reader);
+}
+
+#else   /* Library built without zlib */
+
+struct gzip_reader *openGzip(context_t *ctx, const char *filename) {
+  logError(ctx, "Error: Cannot read %s: gzip files are not supported (library built without zlib).\n", filename);
+  return NULL;
+}
+
+int readGzip(struct gzip_reader *reader, const char **data, size_t *size) {
+  (void)reader;
+  (void)data;
+  *size = 0;
+  return -1;
+}
+
+void closeGzip(struct gzip_reader *reader) {
+  (void)reader;
+}
+
+#endif
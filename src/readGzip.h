@@ -0,0 +1,25 @@
+/*
+ * readGzip.h
+ */
+
+#ifndef READGZIP_H_
+#define READGZIP_H_
+
+#include <stddef.h>
+
+#include "stdbool.h"
+
+#include "context.h"
+
+/* Reader of the decompressed content of a gzip file, block by block (opaque) */
+struct gzip_reader;
+
+bool isGzipFile(const char *filename);
+
+struct gzip_reader *openGzip(context_t *ctx, const char *filename);
+
+int readGzip(struct gzip_reader *reader, const char **data, size_t *size);
+
+void closeGzip(struct gzip_reader *reader);
+
+#endif /* READGZIP_H_ */
@@ -0,0 +1,420 @@
+/*
+ * readMat.c
+ *
+ * Functions:
+ * ----------
+ *   isBigEndian: test the byte order of the host
+ *   elementSize: size of a matrix element in bytes
+ *   matValue: read an element of a matrix
+ *   matInt: read an element of a matrix as an integer
+ *   findMatrices: find the matrices of a Modelica result file
+ *   rowEquals: compare a row of a text matrix with a string
+ *   variableEquals: compare the name of a variable with a string
+ *   openMatResult: map a Modelica result file in memory
+ *   readMatVariables: read variables of a Modelica result file
+ *   freeMatVariables: free the series returned by readMatVariables
+ *   readMatFileInContext: read variables of a Modelica result file in one call
+ *   readMatFile: same as readMatFileInContext, with the error messages on stderr
+ *   closeMatResult: release a Modelica result file
+ *
+ * Modelica result files (written by Dymola and OpenModelica) are MATLAB v4 files
+ * with the matrices Aclass, name, description, dataInfo, data_1 and data_2.
+ * The variables are columns of data_1 (parameters) or data_2 (trajectories),
+ * referred to by dataInfo: several variables may share a column (aliases), with
+ * a negative column index if the sign of the values is flipped. With the
+ * "binTrans" format, all matrices are stored transposed.
+ *
+ * The file is mapped in memory, and only the columns of the requested variables
+ * are decoded.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "context.h"
+#include "data_structure.h"
+#include "mapFile.h"
+#include "readMat.h"
+
+/* Size of the header of a matrix (type, mrows, ncols, imagf, namlen) */
+#define MAT_HEADER_SIZE 20
+
+/*
+ * Function: isBigEndian
+ * ---------------------
+ *   test the byte order of the host
+ *
+ *   return: true if the host is big-endian
+ */
+static bool isBigEndian(void) {
+  const uint32_t one = 1;
+  unsigned char b;
+  memcpy(&b, &one, 1);
+  return b == 0;
+}
+
+/*
+ * Function: elementSize
+ * ---------------------
+ *   size of a matrix element in bytes
+ *
+ *   type: matrix type MOPT
+ *
+ *   return: size in bytes, 0 if the precision is not supported
+ */
+static size_t elementSize(int32_t type) {
+  static const size_t sizes[6] = {8, 4, 4, 2, 2, 1};
+  const int32_t precision = (type / 10) % 10;
+  return (precision >= 0 && precision < 6) ? sizes[precision] : 0;
+}
+
+/*
+ * Function: matValue
+ * ------------------
+ *   read an element of a matrix, converted to double
+ *
+ *   m: matrix
+ *   k: index of the element (column-major)
+ *
+ *   return: value of the element
+ */
+static double matValue(const struct mat_matrix *m, size_t k) {
+  const size_t size = elementSize(m->type);
+  unsigned char b[8];
+  size_t i;
+  memcpy(b, m->data + k * size, size);
+  if ((m->type / 1000 == 1) != isBigEndian()) {
+    for (i = 0; i < size / 2; i++) {
+      unsigned char tmp = b[i];
+      b[i] = b[size - 1 - i];
+      b[size - 1 - i] = tmp;
+    }
+  }
+  switch ((m->type / 10) % 10) {
+    case 0: { double v; memcpy(&v, b, 8); return v; }
+    case 1: { float v; memcpy(&v, b, 4); return (double)v; }
+    case 2: { int32_t v; memcpy(&v, b, 4); return (double)v; }
+    case 3: { int16_t v; memcpy(&v, b, 2); return (double)v; }
+    case 4: { uint16_t v; memcpy(&v, b, 2); return (double)v; }
+    default: return (double)b[0];
+  }
+}
+
+/*
+ * Function: matInt
+ * ----------------
+ *   read an element of a matrix, converted to an integer
+ *
+ *   m: matrix
+ *   row, col: row and column of the element
+ *
+ *   return: value of the element
+ */
+static long matInt(const struct mat_matrix *m, size_t row, size_t col) {
+  return (long)matValue(m, col * m->mrows + row);
+}
+
+/*
+ * Function: findMatrices
+ * ----------------------
+ *   find the matrices of a Modelica result file. The headers are read in the
+ *   byte order of the file, given by the type of the first matrix.
+ *
+ *   res: result file, with the file mapped
+ *   aclass: matrix receiving Aclass
+ *
+ *   return: 0 if there was success, -1 if the file is not a MATLAB v4 file
+ */
+static int findMatrices(struct mat_result *res, struct mat_matrix *aclass) {
+  const unsigned char *p = res->map.data;
+  const unsigned char *end = p + res->map.size;
+  bool swap = false;
+  int i;
+
+  while (p < end) {
+    int32_t header[5];
+    if ((size_t)(end - p) < MAT_HEADER_SIZE)
+      return -1;
+    memcpy(header, p, MAT_HEADER_SIZE);
+    if (p == res->map.data && (header[0] < 0 || header[0] > 4052))
+      swap = true;
+    if (swap) {
+      for (i = 0; i < 5; i++) {
+        uint32_t u;
+        memcpy(&u, &header[i], 4);
+        u = (u >> 24) | ((u >> 8) & 0xFF00) | ((u << 8) & 0xFF0000) | (u << 24);
+        memcpy(&header[i], &u, 4);
+      }
+    }
+    struct mat_matrix m = {NULL, header[0], (size_t)header[1], (size_t)header[2]};
+    const size_t size = elementSize(m.type);
+    if (header[0] < 0 || header[0] > 4052 || (header[0] / 100) % 10 != 0 || header[0] % 10 > 1
+        || header[1] < 0 || header[2] < 0 || header[4] <= 0 || size == 0)
+      return -1;
+    const char *matName = (const char *)p + MAT_HEADER_SIZE;
+    if ((size_t)(end - p) - MAT_HEADER_SIZE < (size_t)header[4] || matName[header[4] - 1] != '\0')
+      return -1;
+    p += MAT_HEADER_SIZE + (size_t)header[4];
+    if (m.ncols > 0 && m.mrows > SIZE_MAX / size / m.ncols / 2)
+      return -1;
+    const size_t bytes = m.mrows * m.ncols * size * (header[3] ? 2 : 1);
+    if ((size_t)(end - p) < bytes)
+      return -1;
+    m.data = p;
+    p += bytes;
+
+    if (strcmp(matName, "Aclass") == 0)
+      *aclass = m;
+    else if (strcmp(matName, "name") == 0)
+      res->name = m;
+    else if (strcmp(matName, "dataInfo") == 0)
+      res->dataInfo = m;
+    else if (strcmp(matName, "data_1") == 0)
+      res->data_1 = m;
+    else if (strcmp(matName, "data_2") == 0)
+      res->data_2 = m;
+  }
+  return 0;
+}
+
+/*
+ * Function: rowEquals
+ * -------------------
+ *   compare a string stored in a text matrix with a string.
+ *   Trailing blanks and null characters of the stored string are ignored.
+ *
+ *   m: text matrix
+ *   i: index of the stored string
+ *   byColumns: true if the strings are the columns of the matrix, false for the rows
+ *   s: string
+ *
+ *   return: true if the strings are equal
+ */
+static bool rowEquals(const struct mat_matrix *m, size_t i, bool byColumns, const char *s) {
+  const size_t length = byColumns ? m->mrows : m->ncols;
+  size_t j;
+  bool end = false;  // end of s reached
+  for (j = 0; j < length; j++) {
+    const size_t k = byColumns ? i * m->mrows + j : j * m->mrows + i;
+    const char c = (char)matValue(m, k);
+    end = end || s[j] == '\0';
+    if (end ? (c != ' ' && c != '\0') : (c != s[j]))
+      return false;
+  }
+  return end || s[j] == '\0';
+}
+
+/*
+ * Function: variableEquals
+ * ------------------------
+ *   compare the name of a variable with a string
+ *
+ *   res: result file
+ *   i: index of the variable
+ *   s: string
+ *
+ *   return: true if the name of the variable is s
+ */
+static bool variableEquals(const struct mat_result *res, size_t i, const char *s) {
+  return rowEquals(&res->name, i, res->transposed, s);
+}
+
+/*
+ * Function: openMatResult
+ * -----------------------
+ *   map a Modelica result file (MATLAB v4 format) in memory and find its matrices.
+ *   No variable is decoded.
+ *
+ *   ctx: context receiving the error messages
+ *   filename: path to the result file
+ *   res: result file, to be released with closeMatResult
+ *
+ *   return: 0 if there was success, -1 otherwise (with a message in the context)
+ */
+int openMatResult(context_t *ctx, const char *filename, struct mat_result *res) {
+  struct mat_matrix aclass = {NULL, 0, 0, 0};
+
+  memset(res, 0, sizeof(struct mat_result));
+  if (mapFile(filename, &res->map) != 0) {
+    logError(ctx, "Cannot open file: %s\n", filename);
+    return -1;
+  }
+  if (res->map.data == NULL || findMatrices(res, &aclass) != 0) {
+    logError(ctx, "Error: %s is not a MATLAB v4 file.\n", filename);
+    closeMatResult(res);
+    return -1;
+  }
+  if (res->name.data == NULL || res->dataInfo.data == NULL || res->data_2.data == NULL) {
+    logError(ctx, "Error: %s is not a Modelica result file (name, dataInfo or data_2 is missing).\n", filename);
+    closeMatResult(res);
+    return -1;
+  }
+  // The fourth string of Aclass gives the storage format.
+  res->transposed = aclass.data != NULL && aclass.mrows >= 4 && rowEquals(&aclass, 3, false, "binTrans");
+  res->nVariables = res->transposed ? res->name.ncols : res->name.mrows;
+  const size_t nInfo = res->transposed ? res->dataInfo.ncols : res->dataInfo.mrows;
+  const size_t nFields = res->transposed ? res->dataInfo.mrows : res->dataInfo.ncols;
+  const size_t nTime = res->transposed ? res->data_2.ncols : res->data_2.mrows;
+  if (nInfo != res->nVariables || nFields < 2 || nTime == 0) {
+    logError(ctx, "Error: Inconsistent dimensions of name, dataInfo or data_2 in %s.\n", filename);
+    closeMatResult(res);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Function: readMatVariables
+ * --------------------------
+ *   read variables of a Modelica result file, with the time of data_2 as x values.
+ *   Only the columns of the requested variables are decoded. The values of aliases
+ *   with a negative column index are negated, and the parameters of data_1 are
+ *   returned as constant series.
+ *
+ *   ctx: context receiving the error messages
+ *   res: result file
+ *   names: names of the variables
+ *   nVariables: number of variables
+ *   series: array of nVariables data structures receiving the variables, which
+ *           share the same x array; to be freed with freeMatVariables
+ *
+ *   return: 0 if there was success, -1 otherwise (with a message in the context)
+ */
+int readMatVariables(
+  context_t *ctx,
+  const struct mat_result *res,
+  const char **names,
+  size_t nVariables,
+  struct data *series
+) {
+  const struct mat_matrix *data_2 = &res->data_2;
+  const size_t nTime = res->transposed ? data_2->ncols : data_2->mrows;
+  const size_t nColumns = res->transposed ? data_2->mrows : data_2->ncols;
+  size_t i, j, t;
+
+  for (j = 0; j < nVariables; j++)
+    series[j] = (struct data){NULL, NULL, 0};
+  double *x = malloc(nTime * sizeof(double));
+  if (x == NULL) {
+    logError(ctx, "Error: Failed to allocate memory for time.\n");
+    return -1;
+  }
+  // Time is the first column of data_2.
+  for (t = 0; t < nTime; t++)
+    x[t] = matValue(data_2, res->transposed ? t * data_2->mrows : t);
+
+  for (j = 0; j < nVariables; j++) {
+    for (i = 0; i < res->nVariables && !variableEquals(res, i, names[j]); i++)
+      ;
+    if (i == res->nVariables) {
+      logError(ctx, "Error: Variable %s not found in result file.\n", names[j]);
+      break;
+    }
+    const long matrix = res->transposed ? matInt(&res->dataInfo, 0, i) : matInt(&res->dataInfo, i, 0);
+    const long column = res->transposed ? matInt(&res->dataInfo, 1, i) : matInt(&res->dataInfo, i, 1);
+    const size_t c = (size_t)labs(column) - 1;
+    const double sign = (column < 0) ? -1.0 : 1.0;
+    const struct mat_matrix *m = (matrix == 1) ? &res->data_1 : data_2;
+    const size_t nm = (m->data == NULL) ? 0 : (res->transposed ? m->mrows : m->ncols);
+    if ((matrix != 0 && matrix != 1 && matrix != 2) || (matrix != 0 && (column == 0 || c >= nm))) {
+      logError(ctx, "Error: Invalid dataInfo of variable %s.\n", names[j]);
+      break;
+    }
+    series[j].x = x;
+    series[j].n = nTime;
+    series[j].y = malloc(nTime * sizeof(double));
+    if (series[j].y == NULL) {
+      logError(ctx, "Error: Failed to allocate memory for values.\n");
+      break;
+    }
+    if (matrix == 0) {
+      // Abscissa (time)
+      memcpy(series[j].y, x, nTime * sizeof(double));
+    } else if (matrix == 1) {
+      // Parameter: value at the first time of data_1
+      const double value = sign * matValue(m, res->transposed ? c : c * m->mrows);
+      for (t = 0; t < nTime; t++)
+        series[j].y[t] = value;
+    } else {
+      for (t = 0; t < nTime; t++)
+        series[j].y[t] = sign * matValue(m, res->transposed ? t * nColumns + c : c * nTime + t);
+    }
+  }
+  if (j < nVariables || nVariables == 0) {
+    // x is freed with the first series if it was read.
+    if (nVariables == 0 || series[0].x == NULL)
+      free(x);
+    freeMatVariables(series, nVariables);
+    return (j < nVariables) ? -1 : 0;
+  }
+  return 0;
+}
+
+/*
+ * Function: freeMatVariables
+ * --------------------------
+ *   free the series returned by readMatVariables
+ *
+ *   series: series returned by readMatVariables
+ *   nVariables: number of series
+ */
+void freeMatVariables(struct data *series, size_t nVariables) {
+  size_t j;
+  if (nVariables > 0)
+    free(series[0].x);
+  for (j = 0; j < nVariables; j++) {
+    free(series[j].y);
+    series[j] = (struct data){NULL, NULL, 0};
+  }
+}
+
+/*
+ * Function: readMatFile
+ * ---------------------
+ *   read variables of a Modelica result file in one call
+ *   (openMatResult, readMatVariables and closeMatResult)
+ *
+ *   ctx: context receiving the error messages
+ *   filename: path to the result file
+ *   names, nVariables, series: see readMatVariables
+ *
+ *   return: 0 if there was success, -1 otherwise (with a message in the context)
+ */
+int readMatFileInContext(context_t *ctx, const char *filename, const char **names, size_t nVariables,
+  struct data *series) {
+  struct mat_result res;
+  int retVal;
+  clearContextError(ctx);
+  if (openMatResult(ctx, filename, &res) != 0)
+    return -1;
+  retVal = readMatVariables(ctx, &res, names, nVariables, series);
+  closeMatResult(&res);
+  return retVal;
+}
+
+/*
+ * Function: readMatFile
+ * ---------------------
+ *   same as readMatFileInContext, with the error messages on stderr
+ */
+int readMatFile(const char *filename, const char **names, size_t nVariables, struct data *series) {
+  context_t ctx;
+  int retVal;
+  initContext(&ctx, NULL);
+  retVal = readMatFileInContext(&ctx, filename, names, nVariables, series);
+  releaseContext(&ctx);
+  return retVal;
+}
+
+/*
+ * Function: closeMatResult
+ * ------------------------
+ *   release a Modelica result file opened with openMatResult
+ *
+ *   res: result file
+ */
+void closeMatResult(struct mat_result *res) {
+  unmapFile(&res->map);
+  memset(res, 0, sizeof(struct mat_result));
+}
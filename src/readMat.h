@@ -0,0 +1,55 @@
+/*
+ * readMat.h
+ */
+
+#ifndef READMAT_H_
+#define READMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stdbool.h"
+
+#include "context.h"
+#include "data_structure.h"
+#include "mapFile.h"
+
+/* Matrix of a MATLAB v4 file, stored in the mapped file */
+struct mat_matrix {
+  const unsigned char *data;  /* Real part of the matrix (column-major), NULL if not found */
+  int32_t type;               /* Type MOPT (M: byte order, P: precision, T: numeric/text) */
+  size_t mrows;               /* Number of rows */
+  size_t ncols;               /* Number of columns */
+};
+
+/* Modelica result file (MATLAB v4 format) mapped in memory */
+struct mat_result {
+  struct mapped_file map;     /* Mapped file */
+  bool transposed;            /* True for the binTrans format (one column per variable in name) */
+  size_t nVariables;          /* Number of variables */
+  struct mat_matrix name;     /* Variable names */
+  struct mat_matrix dataInfo; /* Matrix and signed column of each variable */
+  struct mat_matrix data_1;   /* Parameters and constants */
+  struct mat_matrix data_2;   /* Trajectories */
+};
+
+int openMatResult(context_t *ctx, const char *filename, struct mat_result *res);
+
+int readMatVariables(
+  context_t *ctx,
+  const struct mat_result *res,
+  const char **names,
+  size_t nVariables,
+  struct data *series
+);
+
+void freeMatVariables(struct data *series, size_t nVariables);
+
+int readMatFileInContext(context_t *ctx, const char *filename, const char **names, size_t nVariables,
+  struct data *series);
+
+int readMatFile(const char *filename, const char **names, size_t nVariables, struct data *series);
+
+void closeMatResult(struct mat_result *res);
+
+#endif /* READMAT_H_ */
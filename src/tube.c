@@ -6,9 +6,27 @@
  *
  * Functions:
  * ----------
+ *   lowerBound: find the first index of a sorted array with a value not lower than a given value
+ *   findCommonVertex: find a vertex shared by two curves within an x range
+ *   buildChunk: build the tube curves of one chunk of the reference
+ *   stitchCurves: concatenate the curves of the chunks between their cut points
+ *   buildTubeChunks: build the tube curves on several threads, by chunks of the reference
+ *   buildTube: find the data sets of lower and upper tube curves with the selected engine
  *   interpolateValues: interpolate sources data points
+ *   appendViolation: add a test point out of the tube to the violation intervals
+ *   initSummary: initialize the summary metrics of the errors
+ *   pushWorst: keep a test point in the bounded heap of the worst test points
+ *   summarizeViolation: add a test point out of the tube to the summary metrics
+ *   mergeSummary: add the summary metrics of a following range of test points
+ *   finishSummary: sort the worst test points by decreasing error value
  *   compare: compare test value with tube
  *   validate: validate test curve and generate error report
+ *   segmentAt: find the segment of a curve used to interpolate at a given x value
+ *   interpolateAt: interpolate a curve at a given x value, advancing an interpolation cursor
+ *   validateRange: validate a range of test points
+ *   mergeIntervals: concatenate the violation intervals of the ranges
+ *   validateParallel: validate test curve on several threads, by ranges of test points
+ *   computeSlopes: compute the slopes of the segments of a curve
  */
 
 
@@ -16,19 +34,353 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include "stdbool.h"
 
 #include "data_structure.h"
+#include "memory.h"
 #include "tubeSize.h"
+#include "algorithmRectangle.h"
+#include "algorithmWindow.h"
+#include "parallel.h"
 #include "tube.h"
 
 #ifndef min
 #define min(a,b) ((a) < (b) ? (a) : (b))
 #endif
 
+#ifndef max
+#define max(a,b) ((a) > (b) ? (a) : (b))
+#endif
+
 #ifndef equ
 #define equ(a,b) (fabs(a-b) < 1e-10 ? true : false)
 #endif
 
+/* Minimum number of reference points per chunk for building the tube on several threads */
+#ifndef MIN_CHUNK_SIZE
+#define MIN_CHUNK_SIZE 100000
+#endif
+
+/* Minimum number of test points per range for validating on several threads */
+#ifndef MIN_RANGE_SIZE
+#define MIN_RANGE_SIZE 100000
+#endif
+
+/* Chunks of the reference processed by buildChunk */
+struct tube_chunks {
+  struct data *reference;
+  struct data *tube_size;
+  struct data_char dat_char;
+  bool window;          /* true to use the sliding window engine */
+  size_t *lo;           /* first reference point of each chunk, including the halo */
+  size_t *hi;           /* last reference point (excluded) of each chunk, including the halo */
+  struct data *lower;   /* lower curve of each chunk */
+  struct data *upper;   /* upper curve of each chunk */
+};
+
+/* Violation intervals and summary metrics of a range of test points */
+struct range_intervals {
+  struct violations list;
+  size_t capacity;            /* allocated size of list.intervals */
+  bool firstOut;              /* true if the first test point of the range is out of the tube */
+  bool lastOut;               /* true if the last test point of the range is out of the tube */
+  double firstError;          /* error value of the first test point of the range */
+  double lastError;           /* error value of the last test point of the range */
+  struct violation_summary summary;  /* summary metrics of the range */
+};
+
+/* Ranges of test points processed by validateRange */
+struct validate_ranges {
+  const struct data *lower;
+  const struct data *upper;
+  const double *slopeLower;   /* slopes of the segments of lower, or NULL */
+  const double *slopeUpper;   /* slopes of the segments of upper, or NULL */
+  const struct data *test;
+  size_t *first;              /* first test point of each range, followed by test->n */
+  struct data *violations;    /* test points out of the tube for each range */
+  struct range_intervals *intervals;  /* violation intervals of each range */
+  bool *rangeFailed;          /* true for each range where a memory allocation failed */
+  struct errorReport *err;
+  bool failed;                /* true if a memory allocation failed (set by the calling thread only) */
+};
+
+/*
+ * Function: lowerBound
+ * --------------------
+ *   find the first index of a sorted array with a value not lower than a given value
+ *
+ *   x: array sorted in increasing order
+ *   n: size of x
+ *   val: value to search
+ *
+ *   return: index i such that x[i-1] < val <= x[i], n if all values are lower than val
+ */
+size_t lowerBound(const double *x, size_t n, double val) {
+  size_t lo = 0, hi = n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (x[mid] < val)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/*
+ * Function: findCommonVertex
+ * --------------------------
+ *   find a vertex shared by two curves (same x and y values) within an x range.
+ *   Away from the ends of their chunks, the curves of two neighboring chunks are
+ *   computed from the same reference points with the same operations, so that the
+ *   first curve can be followed up to a common vertex and the second one from there.
+ *
+ *   a: first curve, with x sorted in increasing order
+ *   b: second curve, with x sorted in increasing order
+ *   xMin, xMax: x range for the vertex
+ *   from: first index of a to consider
+ *   ia: index of the vertex in a
+ *   ib: index of the vertex in b
+ *
+ *   return: true if a common vertex was found
+ */
+bool findCommonVertex(const struct data *a, const struct data *b,
+  double xMin, double xMax, size_t from, size_t *ia, size_t *ib) {
+  size_t i, j;
+  for (i = lowerBound(a->x, a->n, xMin); i < a->n && a->x[i] <= xMax; i++) {
+    if (i < from)
+      continue;
+    for (j = lowerBound(b->x, b->n, a->x[i]); j < b->n && !(b->x[j] > a->x[i]); j++) {
+      if (!(b->y[j] < a->y[i] || b->y[j] > a->y[i])) {
+        *ia = i;
+        *ib = j;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/*
+ * Function: buildChunk
+ * --------------------
+ *   build the tube curves of one chunk of the reference (task of parallelFor);
+ *   the curves of the chunk are empty if the memory cannot be allocated
+ *
+ *   arg: pointer to tube_chunks struct
+ *   k: chunk index
+ */
+static void buildChunk(void *arg, int k) {
+  struct tube_chunks *tc = (struct tube_chunks *)arg;
+  size_t lo = tc->lo[k], hi = tc->hi[k];
+  struct data reference = {tc->reference->x + lo, tc->reference->y + lo, hi - lo};
+  struct data tube_size = {tc->tube_size->x + lo, tc->tube_size->y + lo, hi - lo};
+  if (tc->window)
+    getTubeWindow(&reference, &tube_size, &tc->lower[k], &tc->upper[k]);
+  else
+    getTube(&reference, &tube_size, tc->dat_char, &tc->lower[k], &tc->upper[k]);
+}
+
+/*
+ * Function: stitchCurves
+ * ----------------------
+ *   concatenate the curves of the chunks between their cut points
+ *
+ *   pieces: curves of the chunks
+ *   first: first index of each piece to keep
+ *   last: last index (excluded) of each piece to keep
+ *   nChunks: number of chunks
+ *
+ *   return: stitched curve, empty if the memory cannot be allocated
+ */
+static struct data stitchCurves(struct data *pieces, size_t *first, size_t *last, int nChunks) {
+  struct data curve;
+  size_t n = 0;
+  int k;
+  for (k = 0; k < nChunks; k++)
+    n += last[k] - first[k];
+  curve.x = allocateMemory(n * sizeof(double));
+  curve.y = allocateMemory(n * sizeof(double));
+  if ((curve.x == NULL) || (curve.y == NULL)){
+    freeMemory(curve.x);
+    freeMemory(curve.y);
+    return (struct data){NULL, NULL, 0};
+  }
+  curve.n = 0;
+  for (k = 0; k < nChunks; k++) {
+    memcpy(curve.x + curve.n, pieces[k].x + first[k], (last[k] - first[k]) * sizeof(double));
+    memcpy(curve.y + curve.n, pieces[k].y + first[k], (last[k] - first[k]) * sizeof(double));
+    curve.n += last[k] - first[k];
+  }
+  return curve;
+}
+
+/*
+ * Function: buildTubeChunks
+ * -------------------------
+ *   build the tube curves on several threads, by chunks of the reference.
+ *
+ *   The reference is split at breakpoints between distinct x values. Each chunk is
+ *   extended on both sides by a halo of 6 times the largest tube half-width in x,
+ *   so that its curves match the curves built from the whole reference around the
+ *   breakpoints. The curves of two neighboring chunks are then cut at a common vertex
+ *   within two tube half-widths of the breakpoint, and concatenated.
+ *   The result is identical to the result of the sequential algorithm.
+ *
+ *   reference: pointer to reference data struct
+ *   tube_size: pointer to tube_size struct
+ *   dat_char: data characteristics of the whole reference, see get_data_char
+ *   window: true to use the sliding window engine, false to use the rectangle engine
+ *   nThreads: number of threads
+ *   lower: pointer to data struct receiving the lower curve of the tube
+ *   upper: pointer to data struct receiving the upper curve of the tube
+ *
+ *   return: 0 if there was success, 1 if the reference cannot be split
+ *           (short or unsorted reference, no common vertex), in which case the
+ *           tube must be built sequentially, -1 if the memory cannot be allocated
+ */
+static int buildTubeChunks(struct data *reference, struct data *tube_size, struct data_char dat_char,
+  bool window, int nThreads, struct data *lower, struct data *upper) {
+  const double *x = reference->x;
+  const size_t n = reference->n;
+  int nChunks = (int)min((size_t)nThreads, n / MIN_CHUNK_SIZE);
+  double txMax = 0;
+  size_t i;
+  int k, retVal = 0;
+  bool success = true;
+
+  if (nChunks < 2)
+    return 1;
+  for (i = 0; i < n; i++) {
+    if ((i > 0 && x[i] < x[i-1]) || !(tube_size->x[i] >= 0))
+      return 1;
+    if (tube_size->x[i] > txMax)
+      txMax = tube_size->x[i];
+  }
+  const double halo = 6 * txMax;
+
+  size_t *cuts = allocateMemory(7 * nChunks * sizeof(size_t));
+  struct data *pieces = allocateMemory(2 * nChunks * sizeof(struct data));
+  if ((cuts == NULL) || (pieces == NULL)){
+    freeMemory(cuts);
+    freeMemory(pieces);
+    return -1;
+  }
+  size_t *brk = cuts;                     // first reference point of each chunk
+  size_t *firstLower = cuts + nChunks;    // first point of each lower curve to keep
+  size_t *lastLower = cuts + 2 * nChunks; // last point (excluded) of each lower curve to keep
+  size_t *firstUpper = cuts + 3 * nChunks;
+  size_t *lastUpper = cuts + 4 * nChunks;
+  struct tube_chunks tc = {reference, tube_size, dat_char, window,
+    cuts + 5 * nChunks, cuts + 6 * nChunks, pieces, pieces + nChunks};
+
+  // ===== 1. Breakpoints between distinct x values, and chunks with their halo =====
+  for (k = 0; k < nChunks; k++) {
+    brk[k] = (k == 0) ? 0 : (size_t)k * (n / nChunks);
+    while (k > 0 && brk[k] < n && !(x[brk[k]] > x[brk[k]-1]))
+      brk[k]++;
+    if (k > 0 && (brk[k] >= n || x[brk[k]] - x[brk[k-1]] <= 4 * txMax || brk[k] < brk[k-1] + 8)) {
+      freeMemory(cuts);
+      freeMemory(pieces);
+      return 1;
+    }
+  }
+  for (k = 0; k < nChunks; k++) {
+    tc.lo[k] = (k == 0) ? 0 : min(lowerBound(x, n, x[brk[k]] - halo), brk[k] - 4);
+    if (k == nChunks - 1) {
+      tc.hi[k] = n;
+    } else {
+      tc.hi[k] = lowerBound(x, n, x[brk[k+1]] + halo);
+      while (tc.hi[k] < n && !(x[tc.hi[k]] > x[brk[k+1]] + halo))
+        tc.hi[k]++;
+      tc.hi[k] = min(max(tc.hi[k], brk[k+1] + 4), n);
+    }
+  }
+
+  // ===== 2. Tube curves of each chunk =====
+  parallelFor(nChunks, nThreads, buildChunk, &tc);
+  for (k = 0; k < nChunks; k++) {
+    if (tc.lower[k].x == NULL || tc.upper[k].x == NULL)
+      retVal = -1;
+  }
+  success = retVal == 0;
+
+  // ===== 3. Cut the curves of neighboring chunks at common vertices =====
+  firstLower[0] = 0;
+  firstUpper[0] = 0;
+  for (k = 1; k < nChunks && success; k++) {
+    double a = x[brk[k]];
+    size_t ia, ib;
+    success = findCommonVertex(&tc.lower[k-1], &tc.lower[k], a - 2 * txMax, a + 2 * txMax, firstLower[k-1], &ia, &ib);
+    lastLower[k-1] = ia + 1;
+    firstLower[k] = ib + 1;
+    success = success && findCommonVertex(&tc.upper[k-1], &tc.upper[k], a - 2 * txMax, a + 2 * txMax, firstUpper[k-1], &ia, &ib);
+    lastUpper[k-1] = ia + 1;
+    firstUpper[k] = ib + 1;
+  }
+  lastLower[nChunks-1] = tc.lower[nChunks-1].n;
+  lastUpper[nChunks-1] = tc.upper[nChunks-1].n;
+  for (k = 0; k < nChunks && success; k++)
+    success = firstLower[k] <= lastLower[k] && firstUpper[k] <= lastUpper[k];
+  if (retVal == 0 && !success)
+    retVal = 1;
+
+  // ===== 4. Concatenate the curves =====
+  if (retVal == 0) {
+    *lower = stitchCurves(tc.lower, firstLower, lastLower, nChunks);
+    *upper = stitchCurves(tc.upper, firstUpper, lastUpper, nChunks);
+    if (lower->x == NULL || upper->x == NULL) {
+      freeMemory(lower->x);
+      freeMemory(lower->y);
+      freeMemory(upper->x);
+      freeMemory(upper->y);
+      *lower = (struct data){NULL, NULL, 0};
+      *upper = (struct data){NULL, NULL, 0};
+      retVal = -1;
+    }
+  }
+  for (k = 0; k < 2 * nChunks; k++) {
+    freeMemory(pieces[k].x);
+    freeMemory(pieces[k].y);
+  }
+  freeMemory(cuts);
+  freeMemory(pieces);
+  return retVal;
+}
+
+/*
+ * Function: buildTube
+ * -------------------
+ *   find the data sets of lower and upper tube curves with the selected engine
+ *
+ *   reference: pointer to reference data struct
+ *   tube_size: pointer to tube_size struct
+ *   dat_char: data characteristics of the reference, see get_data_char
+ *   engine: ENGINE_DEFAULT, ENGINE_RECTANGLE or ENGINE_WINDOW
+ *   nThreads: number of threads (the tube is built sequentially for short references)
+ *   lower: pointer to data struct receiving the lower curve of the tube
+ *   upper: pointer to data struct receiving the upper curve of the tube
+ *
+ *   return: 0 if there was success, 1 if the engine cannot be used with this tube size,
+ *           -1 if the memory cannot be allocated or a loop cannot be removed
+ *           (both curves are then empty)
+ */
+int buildTube(struct data *reference, struct data *tube_size, struct data_char dat_char,
+  int engine, int nThreads, struct data *lower, struct data *upper) {
+  const bool window = (engine == ENGINE_WINDOW);
+
+  if (window && !isWindowTube(reference, tube_size))
+    return 1;
+  if (nThreads > 1) {
+    int retVal = buildTubeChunks(reference, tube_size, dat_char, window, nThreads, lower, upper);
+    if (retVal != 1)
+      return retVal;
+  }
+  if (window)
+    return getTubeWindow(reference, tube_size, lower, upper);
+  return getTube(reference, tube_size, dat_char, lower, upper);
+}
+
 /*
  * Function: interpolateValues
  * ---------------------------
@@ -43,30 +395,26 @@
  *   targetX: target data x value
  *   targetLength: total target data points
  *
- *   return: targetY -- target data y value
+ *   return: targetY -- target data y value, NULL if the memory cannot be allocated
  */
 double * interpolateValues(double* sourceX, double* sourceY, int sourceLength, double* targetX, int targetLength) {
   if (sourceY == NULL || sourceLength == 0) {
     return sourceY;
   }
   int i;
-  double* targetY = malloc(targetLength * sizeof(double));
-  if (targetY == NULL){
-  	  fputs("Error: Failed to allocate memory for targetY.\n", stderr);
-  	  exit(1);
-  }
+  double* targetY = allocateMemory(targetLength * sizeof(double));
+  if (targetY == NULL)
+    return NULL;
   int j = 1;
   double x, x0, x1, y0, y1;
 
   for (i=0; i<targetLength; i++) {
     // Prevent extrapolating
     if (targetX[i] > sourceX[sourceLength-1]) {
-      double *tmp = realloc(targetY, sizeof(double)*i);
-      if (tmp == NULL){
-    	  fputs("Error: Failed to reallocate memory for tmp.\n", stderr);
-    	  exit(1);
-      }
-      targetY = tmp;
+      // Release the memory beyond the interpolated values (kept if it cannot be released).
+      double *tmp = (i > 0) ? reallocateMemory(targetY, sizeof(double)*i) : NULL;
+      if (tmp != NULL)
+        targetY = tmp;
       break;
     }
 
@@ -95,6 +443,160 @@ double * interpolateValues(double* sourceX, double* sourceY, int sourceLength, d
   return targetY;
 }
 
+/*
+ * Function: appendViolation
+ * -------------------------
+ *   add a test point out of the tube to the violation intervals, either extending
+ *   the last interval or starting a new one. The intervals are grown by doubling.
+ *
+ *   v: violation intervals
+ *   capacity: allocated size of v->intervals, updated
+ *   extend: true if the previous test point is out of the tube as well
+ *   x: x value of the test point
+ *   e: error value of the test point
+ *
+ *   return: 0 if there was success, -1 if the memory cannot be allocated
+ */
+int appendViolation(struct violations *v, size_t *capacity, bool extend, double x, double e) {
+  if (extend && v->n > 0) {
+    struct violation *last = &v->intervals[v->n - 1];
+    last->xEnd = x;
+    if (e > last->peak) {
+      last->peak = e;
+      last->xPeak = x;
+    }
+    return 0;
+  }
+  if (v->n == *capacity) {
+    size_t newCapacity = (*capacity > 0) ? 2 * *capacity : 16;
+    struct violation *tmp = reallocateMemory(v->intervals, newCapacity * sizeof(struct violation));
+    if (tmp == NULL)
+      return -1;
+    v->intervals = tmp;
+    *capacity = newCapacity;
+  }
+  v->intervals[v->n] = (struct violation){x, x, e, x};
+  v->n++;
+  return 0;
+}
+
+/*
+ * Function: initSummary
+ * ---------------------
+ *   initialize the summary metrics of the errors (no violation)
+ *
+ *   summary: summary metrics
+ */
+void initSummary(struct violation_summary *summary) {
+  memset(summary, 0, sizeof(struct violation_summary));
+  summary->xMaxError = NAN;
+  summary->firstViolation = NAN;
+}
+
+/*
+ * Function: pushWorst
+ * -------------------
+ *   keep a test point in the worst test points of the summary, stored as a min-heap
+ *   of SUMMARY_TOP_K elements on the error value until finishSummary is called
+ *
+ *   summary: summary metrics
+ *   x: x value of the test point
+ *   e: error value of the test point
+ */
+static void pushWorst(struct violation_summary *summary, double x, double e) {
+  size_t i, child;
+  if (summary->nTop < SUMMARY_TOP_K) {
+    // Sift up the new element.
+    for (i = summary->nTop++; i > 0 && summary->topError[(i - 1) / 2] > e; i = (i - 1) / 2) {
+      summary->topX[i] = summary->topX[(i - 1) / 2];
+      summary->topError[i] = summary->topError[(i - 1) / 2];
+    }
+  } else {
+    if (!(e > summary->topError[0]))
+      return;
+    // Replace the smallest element and sift it down.
+    for (i = 0; (child = 2 * i + 1) < SUMMARY_TOP_K; i = child) {
+      if (child + 1 < SUMMARY_TOP_K && summary->topError[child + 1] < summary->topError[child])
+        child++;
+      if (!(summary->topError[child] < e))
+        break;
+      summary->topX[i] = summary->topX[child];
+      summary->topError[i] = summary->topError[child];
+    }
+  }
+  summary->topX[i] = x;
+  summary->topError[i] = e;
+}
+
+/*
+ * Function: summarizeViolation
+ * ----------------------------
+ *   add a test point out of the tube to the summary metrics (except the integral,
+ *   which is accumulated over all test points by the caller)
+ *
+ *   summary: summary metrics
+ *   x: x value of the test point
+ *   e: error value of the test point
+ */
+void summarizeViolation(struct violation_summary *summary, double x, double e) {
+  if (summary->nViolations == 0)
+    summary->firstViolation = x;
+  summary->nViolations++;
+  if (e > summary->maxError) {
+    summary->maxError = e;
+    summary->xMaxError = x;
+  }
+  pushWorst(summary, x, e);
+}
+
+/*
+ * Function: mergeSummary
+ * ----------------------
+ *   add the summary metrics of a following range of test points
+ *
+ *   summary: summary metrics, updated
+ *   next: summary metrics of the test points following the points of summary
+ */
+void mergeSummary(struct violation_summary *summary, const struct violation_summary *next) {
+  struct violation_summary worst = *next;
+  size_t k;
+  // Push the worst points in order, so that the first points are kept for equal error values.
+  finishSummary(&worst);
+  if (summary->nViolations == 0)
+    summary->firstViolation = next->firstViolation;
+  summary->nViolations += next->nViolations;
+  if (next->maxError > summary->maxError) {
+    summary->maxError = next->maxError;
+    summary->xMaxError = next->xMaxError;
+  }
+  summary->integral += next->integral;
+  for (k = 0; k < worst.nTop; k++)
+    pushWorst(summary, worst.topX[k], worst.topError[k]);
+}
+
+/*
+ * Function: finishSummary
+ * -----------------------
+ *   sort the worst test points of the summary by decreasing error value
+ *   (by increasing x value for equal error values)
+ *
+ *   summary: summary metrics
+ */
+void finishSummary(struct violation_summary *summary) {
+  size_t i, j;
+  for (i = 1; i < summary->nTop; i++) {
+    double x = summary->topX[i];
+    double e = summary->topError[i];
+    for (j = i; j > 0 && (summary->topError[j-1] < e
+        || (!(summary->topError[j-1] > e) && summary->topX[j-1] > x)); j--) {
+      summary->topX[j] = summary->topX[j-1];
+      summary->topError[j] = summary->topError[j-1];
+    }
+    summary->topX[j] = x;
+    summary->topError[j] = e;
+  }
+}
+
 /*
  * Function: compare
  * -------------------
@@ -111,66 +613,79 @@ double * interpolateValues(double* sourceX, double* sourceY, int sourceLength, d
  *              err->x -- time when there is error
  *              err->y -- error value
  *           err->n -- total time moment when there is error
+ *           and the intervals of consecutive test points out of the tube
+ *           (only the intervals if err->intervalsOnly is set, and only the
+ *           first test point out of the tube if err->stopAtFirst is set)
  */
 int compare(double* lower, double* upper, int refLen,
   double* testY, double* testX, int testLen,
   struct errorReport* err) {
   size_t i;
-  size_t errArrSize = 1;
-  err->original.n = 0;
-  err->original.x = malloc(errArrSize * sizeof(double));
-  if (err->original.x == NULL){
-    fputs("Error: Failed to allocate memory for err->original.x.\n", stderr);
-    return -1;
-  }
-  err->original.y = malloc(errArrSize * sizeof(double));
-  if (err->original.y == NULL){
-    fputs("Error: Failed to allocate memory for err->original.y.\n", stderr);
-    return -1;
-  }
+  size_t n = min(testLen, refLen);
+  size_t errArrSize = 16;
+  size_t capacity = 0;
+  bool dense = !err->intervalsOnly && !err->stopAtFirst;
+  bool out = false;
+  double ePrev = 0.0;
+  err->original = (struct data){NULL, NULL, 0};
+  err->diff = (struct data){NULL, NULL, 0};
+  err->intervals = (struct violations){NULL, 0};
+  initSummary(&err->summary);
+  if (dense) {
+    err->original.x = allocateMemory(errArrSize * sizeof(double));
+    if (err->original.x == NULL)
+      return -1;
+    err->original.y = allocateMemory(errArrSize * sizeof(double));
+    if (err->original.y == NULL)
+      return -1;
 
-  err->diff.n = min(testLen, refLen);
-  err->diff.x = malloc(err->diff.n * sizeof(double));
-  if (err->diff.x == NULL){
-    fputs("Error: Failed to allocate memory for err->diff.x.\n", stderr);
-    return -1;
-  }
-  err->diff.y = malloc(err->diff.n * sizeof(double));
-  if (err->diff.y == NULL){
-    fputs("Error: Failed to allocate memory for err->diff.y.\n", stderr);
-    return -1;
+    err->diff.n = n;
+    err->diff.x = allocateMemory(err->diff.n * sizeof(double));
+    if (err->diff.x == NULL)
+      return -1;
+    err->diff.y = allocateMemory(err->diff.n * sizeof(double));
+    if (err->diff.y == NULL)
+      return -1;
   }
 
-  for (i=0; i < err->diff.n; i++) {
-    if (testY[i] < lower[i] || testY[i] > upper[i]) {
-      err->original.x[err->original.n] = testX[i];
-      if (testY[i] < lower[i]) {
-        err->original.y[err->original.n] = lower[i]-testY[i];
-      } else {
-        err->original.y[err->original.n] = testY[i]-upper[i];
-      }
-      err->diff.y[i] = err->original.y[err->original.n];
-      err->original.n++;
-    } else {
-      err->diff.y[i] = 0.0;
+  for (i=0; i < n; i++) {
+    double e = 0.0;
+    bool extend = out;
+    out = testY[i] < lower[i] || testY[i] > upper[i];
+    if (out) {
+      e = (testY[i] < lower[i]) ? lower[i]-testY[i] : testY[i]-upper[i];
+      if (appendViolation(&err->intervals, &capacity, extend, testX[i], e) != 0)
+        return -1;
+      summarizeViolation(&err->summary, testX[i], e);
     }
+    if (i > 0 && (out || extend))
+      err->summary.integral += 0.5 * (ePrev + e) * (testX[i] - testX[i-1]);
+    ePrev = e;
+    if (out && err->stopAtFirst)
+      break;
+    if (!dense)
+      continue;
     err->diff.x[i] = testX[i];
-    // resize error arrays
-    if (err->original.n == errArrSize) {
-      errArrSize += 10;
-      err->original.x = realloc(err->original.x, sizeof(double)*errArrSize);
-      if (err->original.x == NULL){
-        fputs("Error: Failed to reallocate memory for err->original.x.\n", stderr);
-        return -1;
-      }
-
-      err->original.y = realloc(err->original.y, sizeof(double)*errArrSize);
-      if (err->original.y == NULL){
-        fputs("Error: Failed to reallocate memory for err->original.y.\n", stderr);
-        return -1;
+    err->diff.y[i] = e;
+    if (out) {
+      // resize error arrays by doubling
+      if (err->original.n == errArrSize) {
+        errArrSize *= 2;
+        double *x_tmp = reallocateMemory(err->original.x, sizeof(double)*errArrSize);
+        if (x_tmp == NULL)
+          return -1;
+        err->original.x = x_tmp;
+        double *y_tmp = reallocateMemory(err->original.y, sizeof(double)*errArrSize);
+        if (y_tmp == NULL)
+          return -1;
+        err->original.y = y_tmp;
       }
+      err->original.x[err->original.n] = testX[i];
+      err->original.y[err->original.n] = e;
+      err->original.n++;
     }
   }
+  finishSummary(&err->summary);
   return 0;
 }
 
@@ -184,7 +699,7 @@ int compare(double* lower, double* upper, int refLen,
  *   upper: data structure for upper curve
  *   test: data structure for test curve
  *
- *   return: 0 if there was success
+ *   return: 0 if there was success, -1 if the memory cannot be allocated
  */
 int validate(
   const struct data lower,
@@ -193,6 +708,350 @@ int validate(
   struct errorReport* err) {
     double *newLower = interpolateValues(lower.x, lower.y, lower.n, test.x, test.n);
     double *newUpper = interpolateValues(upper.x, upper.y, upper.n, test.x, test.n);
+    if ((newLower == NULL && lower.n > 0) || (newUpper == NULL && upper.n > 0)) {
+      if (newLower != lower.y) freeMemory(newLower);
+      if (newUpper != upper.y) freeMemory(newUpper);
+      return -1;
+    }
     int retVal = compare(newLower, newUpper, test.n, test.y, test.x, test.n, err);
+    if (newLower != lower.y) freeMemory(newLower);
+    if (newUpper != upper.y) freeMemory(newUpper);
     return retVal;
 }
+
+/*
+ * Function: segmentAt
+ * -------------------
+ *   find the segment of a curve used by interpolateValues to interpolate at a given x value
+ *   (first segment [j-1, j] with sourceX[j] >= x, or last segment),
+ *   which is also the segment reached by interpolateValues for sorted target x values
+ *
+ *   sourceX: source data x value, sorted in increasing order
+ *   sourceLength: total source data points (at least 2)
+ *   x: x value
+ *
+ *   return: index j of the end of the segment
+ */
+static size_t segmentAt(const double *sourceX, size_t sourceLength, double x) {
+  size_t j = lowerBound(sourceX, sourceLength, x);
+  if (j < 1)
+    j = 1;
+  if (j > sourceLength - 1)
+    j = sourceLength - 1;
+  return j;
+}
+
+/*
+ * Function: interpolateAt
+ * -----------------------
+ *   interpolate a curve at a given x value, advancing an interpolation cursor
+ *   as interpolateValues does for sorted target x values
+ *
+ *   curve: source curve (at least 2 points)
+ *   slopes: slopes of the segments of the curve (see computeSlopes), or NULL
+ *   j: interpolation cursor (end of the current segment), 1 for the first x value
+ *   x: x value, not lower than the previous x value
+ *
+ *   return: interpolated y value
+ */
+double interpolateAt(const struct data *curve, const double *slopes, size_t *j, double x) {
+  const double *sourceX = curve->x;
+  const double *sourceY = curve->y;
+  // Step sourceX to current x
+  while ((sourceX[*j] < x) && (*j + 1 < curve->n))
+    (*j)++;
+  double x0 = sourceX[*j-1], x1 = sourceX[*j];
+  double y0 = sourceY[*j-1], y1 = sourceY[*j];
+  // Prevent NaN -> division by zero
+  if (!equ((x1-x0)*(x-x0), 0)) {
+    double slope = (slopes != NULL) ? slopes[*j-1] : (y1 - y0) / (x1 - x0);
+    return y0 + (slope * (x - x0));
+  }
+  return y0;
+}
+
+/*
+ * Function: validateRange
+ * -----------------------
+ *   validate a range of test points (task of parallelFor). The values of the tube
+ *   curves are interpolated as in interpolateValues, starting from the segments
+ *   found by binary search, and compared to the test values as in compare.
+ *   The dense error values are written in place, the test points out of the tube
+ *   and the violation intervals are stored for the range and merged afterwards.
+ *
+ *   arg: pointer to validate_ranges struct
+ *   k: range index
+ */
+static void validateRange(void *arg, int k) {
+  struct validate_ranges *vr = (struct validate_ranges *)arg;
+  const struct data *curves[2] = {vr->lower, vr->upper};
+  const double *slopes[2] = {vr->slopeLower, vr->slopeUpper};
+  const double *testX = vr->test->x;
+  const double *testY = vr->test->y;
+  struct data *violations = &vr->violations[k];
+  struct range_intervals *intervals = &vr->intervals[k];
+  const bool dense = !vr->err->intervalsOnly && !vr->err->stopAtFirst;
+  size_t capacity = 16;
+  size_t i0 = vr->first[k], i1 = vr->first[k+1];
+  size_t i, j[2];
+  bool out = false;
+  int c;
+
+  violations->n = 0;
+  if (dense) {
+    violations->x = allocateMemory(capacity * sizeof(double));
+    violations->y = allocateMemory(capacity * sizeof(double));
+    if ((violations->x == NULL) || (violations->y == NULL)) {
+      vr->rangeFailed[k] = true;
+      return;
+    }
+  }
+  for (c = 0; c < 2; c++)
+    j[c] = segmentAt(curves[c]->x, curves[c]->n, testX[i0]);
+  initSummary(&intervals->summary);
+
+  for (i = i0; i < i1; i++) {
+    const double x = testX[i];
+    double bounds[2];
+    double e = 0.0;
+    for (c = 0; c < 2; c++)
+      bounds[c] = interpolateAt(curves[c], slopes[c], &j[c], x);
+
+    const bool extend = out;
+    out = testY[i] < bounds[0] || testY[i] > bounds[1];
+    if (out) {
+      e = (testY[i] < bounds[0]) ? bounds[0] - testY[i] : testY[i] - bounds[1];
+      if (appendViolation(&intervals->list, &intervals->capacity, extend, x, e) != 0) {
+        vr->rangeFailed[k] = true;
+        return;
+      }
+      summarizeViolation(&intervals->summary, x, e);
+    }
+    if (i == i0) {
+      intervals->firstOut = out;
+      intervals->firstError = e;
+    } else if (out || extend) {
+      intervals->summary.integral += 0.5 * (intervals->lastError + e) * (x - testX[i-1]);
+    }
+    intervals->lastError = e;
+    if (out) {
+      if (vr->err->stopAtFirst)
+        return;  // the range ends at its first violation (lastOut not set)
+      if (!dense)
+        continue;
+      vr->err->diff.x[i] = x;
+      vr->err->diff.y[i] = e;
+      if (violations->n == capacity) {
+        capacity = 2 * capacity;
+        double *x_tmp = reallocateMemory(violations->x, capacity * sizeof(double));
+        double *y_tmp = reallocateMemory(violations->y, capacity * sizeof(double));
+        if (x_tmp != NULL)
+          violations->x = x_tmp;
+        if (y_tmp != NULL)
+          violations->y = y_tmp;
+        if ((x_tmp == NULL) || (y_tmp == NULL)) {
+          vr->rangeFailed[k] = true;
+          return;
+        }
+      }
+      violations->x[violations->n] = x;
+      violations->y[violations->n] = e;
+      violations->n++;
+    } else if (dense) {
+      vr->err->diff.x[i] = x;
+      vr->err->diff.y[i] = 0.0;
+    }
+  }
+  intervals->lastOut = out;
+}
+
+/*
+ * Function: mergeIntervals
+ * ------------------------
+ *   concatenate the violation intervals of the ranges in order, joining the
+ *   intervals that continue from one range to the next one
+ *
+ *   vr: ranges validated by validateRange
+ *   nRanges: number of ranges
+ *   list: violation intervals of the whole test curve
+ *
+ *   return: 0 if there was success, -1 if the memory cannot be allocated
+ */
+static int mergeIntervals(const struct validate_ranges *vr, int nRanges, struct violations *list) {
+  size_t n = 0;
+  int k;
+  for (k = 0; k < nRanges; k++)
+    n += vr->intervals[k].list.n;
+  *list = (struct violations){NULL, 0};
+  if (n == 0)
+    return 0;
+  list->intervals = allocateMemory(n * sizeof(struct violation));
+  if (list->intervals == NULL)
+    return -1;
+  for (k = 0; k < nRanges; k++) {
+    const struct violations *part = &vr->intervals[k].list;
+    size_t first = 0;
+    if (part->n > 0 && k > 0 && vr->intervals[k].firstOut && vr->intervals[k-1].lastOut) {
+      struct violation *last = &list->intervals[list->n - 1];
+      last->xEnd = part->intervals[0].xEnd;
+      if (part->intervals[0].peak > last->peak) {
+        last->peak = part->intervals[0].peak;
+        last->xPeak = part->intervals[0].xPeak;
+      }
+      first = 1;
+    }
+    memcpy(list->intervals + list->n, part->intervals + first, (part->n - first) * sizeof(struct violation));
+    list->n += part->n - first;
+  }
+  return 0;
+}
+
+/*
+ * Function: validateParallel
+ * --------------------------
+ *   validate test curve and generate error report on several threads.
+ *
+ *   The test points are split into ranges of at least MIN_RANGE_SIZE points.
+ *   Each range finds its starting segments of the tube curves by binary search,
+ *   then is interpolated and compared on its own thread. The test points out of
+ *   the tube are merged in order, so that the report is identical to the report
+ *   of validate. If the test or tube curve x values are not sorted, or if the test
+ *   x values are not covered by the tube curves, validate is used instead.
+ *   With err->stopAtFirst set, each range stops at its first test point out of
+ *   the tube, and the first of these points is reported.
+ *
+ *   lower: data structure for lower curve
+ *   upper: data structure for upper curve
+ *   slopeLower: slopes of the segments of lower curve (see computeSlopes), or NULL
+ *   slopeUpper: slopes of the segments of upper curve (see computeSlopes), or NULL
+ *   test: data structure for test curve
+ *   nThreads: number of threads
+ *   err: error report
+ *
+ *   return: 0 if there was success, -1 if the memory cannot be allocated
+ *           (the report is then empty)
+ */
+int validateParallel(
+  const struct data lower,
+  const struct data upper,
+  const double *slopeLower,
+  const double *slopeUpper,
+  const struct data test,
+  int nThreads,
+  struct errorReport* err) {
+  int nRanges = (int)max(min((size_t)nThreads, test.n / MIN_RANGE_SIZE), 1);
+  size_t i, n;
+  int k;
+  bool sorted = true;
+
+  for (i = 1; i < test.n && sorted; i++)
+    sorted = !(test.x[i] < test.x[i-1]);
+  for (i = 1; i < lower.n && sorted; i++)
+    sorted = !(lower.x[i] < lower.x[i-1]);
+  for (i = 1; i < upper.n && sorted; i++)
+    sorted = !(upper.x[i] < upper.x[i-1]);
+  if (test.n == 0 || !sorted || lower.n < 2 || upper.n < 2
+      || test.x[test.n-1] > lower.x[lower.n-1] || test.x[test.n-1] > upper.x[upper.n-1])
+    return validate(lower, upper, test, err);
+
+  struct validate_ranges vr = {&lower, &upper, slopeLower, slopeUpper, &test, NULL, NULL, NULL, NULL, err, false};
+  const bool dense = !err->intervalsOnly && !err->stopAtFirst;
+  vr.first = allocateMemory((nRanges + 1) * sizeof(size_t));
+  vr.violations = allocateZeroed(nRanges, sizeof(struct data));
+  vr.intervals = allocateZeroed(nRanges, sizeof(struct range_intervals));
+  vr.rangeFailed = allocateZeroed(nRanges, sizeof(bool));
+  err->original = (struct data){NULL, NULL, 0};
+  err->diff = (struct data){NULL, NULL, 0};
+  err->intervals = (struct violations){NULL, 0};
+  if (dense) {
+    err->diff.n = test.n;
+    err->diff.x = allocateMemory(test.n * sizeof(double));
+    err->diff.y = allocateMemory(test.n * sizeof(double));
+  }
+  if ((vr.first == NULL) || (vr.violations == NULL) || (vr.intervals == NULL) || (vr.rangeFailed == NULL)
+      || (dense && ((err->diff.x == NULL) || (err->diff.y == NULL)))){
+    vr.failed = true;
+    goto end;
+  }
+  for (k = 0; k <= nRanges; k++)
+    vr.first[k] = (size_t)k * (test.n / nRanges) + ((k == nRanges) ? test.n % nRanges : 0);
+
+  parallelFor(nRanges, nThreads, validateRange, &vr);
+  for (k = 0; k < nRanges; k++)
+    vr.failed = vr.failed || vr.rangeFailed[k];
+
+  // Merge the test points out of the tube and the violation intervals in order.
+  if (!vr.failed && mergeIntervals(&vr, nRanges, &err->intervals) != 0)
+    vr.failed = true;
+  if (err->stopAtFirst && err->intervals.n > 1)
+    err->intervals.n = 1;
+  initSummary(&err->summary);
+  for (k = 0; k < nRanges && !vr.failed && !(err->stopAtFirst && err->summary.nViolations > 0); k++) {
+    if (k > 0 && (vr.intervals[k].firstOut || vr.intervals[k-1].lastOut))
+      err->summary.integral += 0.5 * (vr.intervals[k-1].lastError + vr.intervals[k].firstError)
+        * (test.x[vr.first[k]] - test.x[vr.first[k] - 1]);
+    mergeSummary(&err->summary, &vr.intervals[k].summary);
+  }
+  finishSummary(&err->summary);
+  for (k = 0, n = 0; k < nRanges; k++)
+    n += vr.violations[k].n;
+  if (dense) {
+    err->original.x = allocateMemory((n + 1) * sizeof(double));
+    err->original.y = allocateMemory((n + 1) * sizeof(double));
+    if ((err->original.x == NULL) || (err->original.y == NULL))
+      vr.failed = true;
+  }
+  for (k = 0; k < nRanges && !vr.failed && dense; k++) {
+    memcpy(err->original.x + err->original.n, vr.violations[k].x, vr.violations[k].n * sizeof(double));
+    memcpy(err->original.y + err->original.n, vr.violations[k].y, vr.violations[k].n * sizeof(double));
+    err->original.n += vr.violations[k].n;
+  }
+
+  end:
+    for (k = 0; k < nRanges; k++) {
+      if (vr.violations != NULL) {
+        freeMemory(vr.violations[k].x);
+        freeMemory(vr.violations[k].y);
+      }
+      if (vr.intervals != NULL)
+        freeMemory(vr.intervals[k].list.intervals);
+    }
+    freeMemory(vr.violations);
+    freeMemory(vr.intervals);
+    freeMemory(vr.rangeFailed);
+    freeMemory(vr.first);
+    if (vr.failed) {
+      // Release the partial report, so that the caller gets an empty report.
+      freeMemory(err->original.x);
+      freeMemory(err->original.y);
+      freeMemory(err->diff.x);
+      freeMemory(err->diff.y);
+      freeMemory(err->intervals.intervals);
+      err->original = (struct data){NULL, NULL, 0};
+      err->diff = (struct data){NULL, NULL, 0};
+      err->intervals = (struct violations){NULL, 0};
+      return -1;
+    }
+    return 0;
+}
+
+/*
+ * Function: computeSlopes
+ * -----------------------
+ *   compute the slopes of the segments of a curve, as used by interpolateValues
+ *
+ *   curve: data structure for the curve
+ *
+ *   return: slopes -- slopes[j] is the slope of the segment [j, j+1]
+ *           (not finite for vertical segments, which are not interpolated),
+ *           NULL if the memory cannot be allocated
+ */
+double * computeSlopes(const struct data curve) {
+  size_t j;
+  double *slopes = allocateMemory(((curve.n > 1) ? curve.n - 1 : 1) * sizeof(double));
+  if (slopes == NULL)
+    return NULL;
+  for (j = 1; j < curve.n; j++)
+    slopes[j-1] = (curve.y[j] - curve.y[j-1]) / (curve.x[j] - curve.x[j-1]);
+  return slopes;
+}
@@ -8,8 +8,28 @@
 #ifndef TUBE_H_
 #define TUBE_H_
 
+#include "stdbool.h"
+
+size_t lowerBound(const double *x, size_t n, double val);
+
+bool findCommonVertex(const struct data *a, const struct data *b,
+  double xMin, double xMax, size_t from, size_t *ia, size_t *ib);
+
+int buildTube(struct data *reference, struct data *tube_size, struct data_char dat_char,
+  int engine, int nThreads, struct data *lower, struct data *upper);
+
 double * interpolateValues(double* sourceX, double* sourceY, int sourceLength, double* targetX, int targetLength);
 
+int appendViolation(struct violations *v, size_t *capacity, bool extend, double x, double e);
+
+void initSummary(struct violation_summary *summary);
+
+void summarizeViolation(struct violation_summary *summary, double x, double e);
+
+void mergeSummary(struct violation_summary *summary, const struct violation_summary *next);
+
+void finishSummary(struct violation_summary *summary);
+
 int compare(double* lower, double* upper, int refLen,
   double* testY, double* testX, int testLen,
   struct errorReport* err);
@@ -20,4 +40,17 @@ int validate(
   const struct data test,
   struct errorReport* err);
 
+int validateParallel(
+  const struct data lower,
+  const struct data upper,
+  const double *slopeLower,
+  const double *slopeUpper,
+  const struct data test,
+  int nThreads,
+  struct errorReport* err);
+
+double * computeSlopes(const struct data curve);
+
+double interpolateAt(const struct data *curve, const double *slopes, size_t *j, double x);
+
 #endif /* TUBE_H_ */
@@ -0,0 +1,327 @@
+/*
+ * tubeCache.c
+ *
+ * Functions:
+ * ----------
+ *   hashWords: fold 64-bit words into a running hash
+ *   hashReference: compute the content hash of a reference curve
+ *   slopesLength: find the number of slopes stored for a tube curve
+ *   nextTempId: get a number that is unique within the process, for temporary file names
+ *   loadTubeCache: load a tube from a cache file, if it matches the reference and tolerances
+ *   saveTubeCache: save a tube to a cache file
+ *   createTubeCached: load a tube from a cache file, or build it and update the cache file
+ *
+ * A tube cache file holds a tube_cache_header followed by the arrays
+ *   lower.x, lower.y, slopeLower, upper.x, upper.y, slopeUpper
+ * of doubles in the byte order of the writer. The header size is a multiple of 8 bytes,
+ * so that the arrays are aligned when the file is mapped in memory and used in place.
+ * The header holds a checksum of the arrays, so that a file that was not written
+ * completely (or mixed from several writers) is a cache miss rather than a wrong tube.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)     /* Win32 or Win64                */
+#include <windows.h>
+#define getProcessId() ((unsigned long)GetCurrentProcessId())
+#else
+#include <unistd.h>     /* getpid(2) */
+#define getProcessId() ((unsigned long)getpid())
+#endif
+
+#include "data_structure.h"
+#include "memory.h"
+#include "tubeHandle.h"
+#include "mapFile.h"
+#include "tubeCache.h"
+
+#define TUBE_CACHE_MAGIC "FUNTUBE"
+#define TUBE_CACHE_VERSION 2
+#define TUBE_CACHE_BYTE_ORDER 0x01020304
+
+/* Seed of the checksum of the arrays of a tube cache file */
+#define TUBE_CACHE_SEED 0x9E3779B97F4A7C15ULL
+
+/* Last number returned by nextTempId */
+static volatile long tempId = 0;
+
+/*
+ * Function: hashWords
+ * -------------------
+ *   fold 64-bit words into a running hash (multiply-xorshift), so that the hash
+ *   of consecutive arrays is the hash of their concatenation
+ *
+ *   words: words, as raw bytes (need not be aligned)
+ *   n: number of words
+ *   h: running hash, TUBE_CACHE_SEED for the first array
+ *
+ *   return: updated hash
+ */
+static uint64_t hashWords(const void *words, size_t n, uint64_t h) {
+  const unsigned char *p = (const unsigned char *)words;
+  size_t i;
+  for (i = 0; i < n; i++) {
+    uint64_t w;
+    memcpy(&w, p + i * sizeof(uint64_t), sizeof(uint64_t));
+    h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 32;
+  }
+  return h;
+}
+
+/*
+ * Function: hashReference
+ * -----------------------
+ *   compute the content hash of a reference curve (64-bit multiply-xorshift
+ *   hash of the bits of the x and y values, with one lane for each)
+ *
+ *   reference: reference curve
+ *
+ *   return: hash value
+ */
+uint64_t hashReference(const struct data *reference) {
+  uint64_t hx = 0x9E3779B97F4A7C15ULL ^ (uint64_t)reference->n;
+  uint64_t hy = 0xC2B2AE3D27D4EB4FULL ^ (uint64_t)reference->n;
+  size_t i;
+  for (i = 0; i < reference->n; i++) {
+    uint64_t bx, by;
+    memcpy(&bx, &reference->x[i], sizeof(uint64_t));
+    memcpy(&by, &reference->y[i], sizeof(uint64_t));
+    hx = (hx ^ bx) * 0xFF51AFD7ED558CCDULL;
+    hx ^= hx >> 32;
+    hy = (hy ^ by) * 0xC4CEB9FE1A85EC53ULL;
+    hy ^= hy >> 32;
+  }
+  hx ^= hy * 0x9E3779B97F4A7C15ULL;
+  hx ^= hx >> 29;
+  return hx;
+}
+
+/*
+ * Function: slopesLength
+ * ----------------------
+ *   find the number of slopes stored for a tube curve (see computeSlopes)
+ *
+ *   n: number of points of the curve
+ *
+ *   return: number of slopes
+ */
+static size_t slopesLength(size_t n) {
+  return (n > 1) ? n - 1 : 1;
+}
+
+/*
+ * Function: nextTempId
+ * --------------------
+ *   get a number that is unique within the process, so that the temporary file
+ *   names made of the process id and this number are unique across the processes
+ *   and threads writing the same cache file
+ *
+ *   return: number
+ */
+static unsigned long nextTempId(void) {
+#if defined(_WIN32)
+  return (unsigned long)InterlockedIncrement(&tempId);
+#else
+  return (unsigned long)__atomic_add_fetch(&tempId, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/*
+ * Function: loadTubeCache
+ * -----------------------
+ *   load a tube from a cache file, if the file was built from the same reference
+ *   (same content hash and number of points), tolerances and engine, and if the
+ *   arrays match the checksum of the header.
+ *   The file is mapped in memory and the tube curves and slopes are used in place.
+ *
+ *   tube: tube to initialize; the reference is not stored in the tube
+ *   fileName: cache file name
+ *   reference: reference curve
+ *   tolerances: tolerances
+ *   options: pointer to options struct, or NULL for default options
+ *
+ *   return: 0 if the tube was loaded (cache hit), 1 otherwise (cache miss)
+ */
+int loadTubeCache(tube_t *tube, const char *fileName, const struct data *reference,
+  struct tolerances tolerances, const struct options *options) {
+  int engine = (options != NULL) ? options->engine : ENGINE_DEFAULT;
+  struct tube_cache_header header;
+  struct mapped_file map;
+  size_t nLower, nUpper, size, maxPoints;
+
+  if (mapFile(fileName, &map) != 0)
+    return 1;
+  if (map.size < sizeof(header)) {
+    unmapFile(&map);
+    return 1;
+  }
+  memcpy(&header, map.data, sizeof(header));
+  // A tube curve of n points takes 3 n - 1 values (x, y and slopes) at least: larger point
+  // counts do not fit in the file, and would make the expected size below overflow.
+  maxPoints = ((map.size - sizeof(header)) / sizeof(double) + 1) / 3;
+  if (header.nLower > maxPoints || header.nUpper > maxPoints) {
+    unmapFile(&map);
+    return 1;
+  }
+  nLower = (size_t)header.nLower;
+  nUpper = (size_t)header.nUpper;
+  size = sizeof(header) + sizeof(double) * (2 * nLower + slopesLength(nLower) + 2 * nUpper + slopesLength(nUpper));
+  if (memcmp(header.magic, TUBE_CACHE_MAGIC, sizeof(TUBE_CACHE_MAGIC)) != 0
+      || header.version != TUBE_CACHE_VERSION
+      || header.byteOrder != TUBE_CACHE_BYTE_ORDER
+      || header.nReference != (uint64_t)reference->n
+      || memcmp(&header.tolerances, &tolerances, sizeof(struct tolerances)) != 0
+      || header.engine != engine
+      || nLower == 0 || nUpper == 0 || map.size != size
+      || header.hash != hashReference(reference)) {
+    unmapFile(&map);
+    return 1;
+  }
+
+  const double *arrays = (const double *)((const char *)map.data + sizeof(header));
+  if (hashWords(arrays, (map.size - sizeof(header)) / sizeof(double), TUBE_CACHE_SEED) != header.checksum) {
+    unmapFile(&map);
+    return 1;
+  }
+  tube->reference = (struct data){NULL, NULL, 0};
+  tube->tube_size = (struct data){NULL, NULL, 0};
+  tube->lower = (struct data){(double *)arrays, (double *)(arrays + nLower), nLower};
+  tube->slopeLower = (double *)(arrays + 2 * nLower);
+  arrays += 2 * nLower + slopesLength(nLower);
+  tube->upper = (struct data){(double *)arrays, (double *)(arrays + nUpper), nUpper};
+  tube->slopeUpper = (double *)(arrays + 2 * nUpper);
+  tube->nThreads = (options != NULL && options->nThreads > 0) ? options->nThreads : 0;
+  tube->ownsReference = false;
+  tube->tolerances = tolerances;
+  tube->engine = engine;
+  tube->cache = map;
+  return 0;
+}
+
+/*
+ * Function: saveTubeCache
+ * -----------------------
+ *   save a tube to a cache file. The file is written under a temporary name that
+ *   is unique to the writer (process id and nextTempId) and then renamed, so that
+ *   readers never see a partially written file, and concurrent writers (e.g. CI
+ *   jobs sharing the cache) do not write into the same file.
+ *
+ *   tube: tube built with initTube or createTube (holding its reference)
+ *   fileName: cache file name
+ *
+ *   return: 0 if there was success, -1 if the file cannot be written
+ */
+int saveTubeCache(const tube_t *tube, const char *fileName) {
+  struct tube_cache_header header;
+  const double *arrays[6] = {tube->lower.x, tube->lower.y, tube->slopeLower,
+    tube->upper.x, tube->upper.y, tube->slopeUpper};
+  size_t lengths[6] = {tube->lower.n, tube->lower.n, slopesLength(tube->lower.n),
+    tube->upper.n, tube->upper.n, slopesLength(tube->upper.n)};
+  int k, retVal = 0;
+
+  if (tube->reference.x == NULL || tube->lower.n == 0 || tube->upper.n == 0)
+    return -1;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TUBE_CACHE_MAGIC, sizeof(TUBE_CACHE_MAGIC));
+  header.version = TUBE_CACHE_VERSION;
+  header.byteOrder = TUBE_CACHE_BYTE_ORDER;
+  header.hash = hashReference(&tube->reference);
+  header.nReference = (uint64_t)tube->reference.n;
+  header.tolerances = tube->tolerances;
+  header.engine = (int32_t)tube->engine;
+  header.nLower = (uint64_t)tube->lower.n;
+  header.nUpper = (uint64_t)tube->upper.n;
+  header.checksum = TUBE_CACHE_SEED;
+  for (k = 0; k < 6; k++)
+    header.checksum = hashWords(arrays[k], lengths[k], header.checksum);
+
+  const size_t tmpSize = strlen(fileName) + 48;
+  char *tmpName = allocateMemory(tmpSize);
+  if (tmpName == NULL)
+    return -1;
+  snprintf(tmpName, tmpSize, "%s.%lu.%lu.tmp", fileName, getProcessId(), nextTempId());
+  FILE *fil = fopen(tmpName, "wb");
+  if (fil == NULL) {
+    freeMemory(tmpName);
+    return -1;
+  }
+  if (fwrite(&header, sizeof(header), 1, fil) != 1)
+    retVal = -1;
+  for (k = 0; k < 6 && retVal == 0; k++) {
+    if (fwrite(arrays[k], sizeof(double), lengths[k], fil) != lengths[k])
+      retVal = -1;
+  }
+  if (fclose(fil) != 0)
+    retVal = -1;
+  if (retVal == 0) {
+#if defined(_WIN32)
+    remove(fileName);  // rename does not replace an existing file on Windows
+#endif
+    if (rename(tmpName, fileName) != 0)
+      retVal = -1;
+  }
+  if (retVal != 0)
+    remove(tmpName);
+  freeMemory(tmpName);
+  return retVal;
+}
+
+/*
+ * Function: createTubeCached
+ * --------------------------
+ *   load a tube from a cache file if it matches the reference and tolerances
+ *   (see loadTubeCache), or else build it with createTube and save it to the
+ *   cache file
+ *
+ *   tube: pointer receiving the tube, to be freed with freeTube
+ *         (NULL if there was no success)
+ *   fileName: cache file name
+ *   tReference, yReference: reference x and y values
+ *   nReference: number of reference points
+ *   atolx, atoly, ltolx, ltoly, rtolx, rtoly: tolerances, see compareAndReport
+ *   options: pointer to options struct, or NULL for default options
+ *
+ *   return: see createTube (a cache file that cannot be written is not an error)
+ */
+int createTubeCached(
+  tube_t **tube,
+  const char *fileName,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  const struct options *options
+) {
+  struct tolerances tolerances = {
+    .atolx = atolx,
+    .atoly = atoly,
+    .ltolx = ltolx,
+    .ltoly = ltoly,
+    .rtolx = rtolx,
+    .rtoly = rtoly,
+  };
+  struct data reference = {(double *)tReference, (double *)yReference, nReference};
+  int retVal;
+
+  *tube = allocateMemory(sizeof(tube_t));
+  if (*tube == NULL)
+    return -1;
+  if (loadTubeCache(*tube, fileName, &reference, tolerances, options) == 0)
+    return 0;
+  freeMemory(*tube);
+
+  retVal = createTube(tube, tReference, yReference, nReference,
+    atolx, atoly, ltolx, ltoly, rtolx, rtoly, options);
+  if (retVal == 0)
+    saveTubeCache(*tube, fileName);
+  return retVal;
+}
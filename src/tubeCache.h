@@ -0,0 +1,50 @@
+/*
+ * tubeCache.h
+ */
+
+#ifndef TUBECACHE_H_
+#define TUBECACHE_H_
+
+#include <stdint.h>
+
+#include "data_structure.h"
+#include "tubeHandle.h"
+
+/* Header of a tube cache file, followed by the arrays of the tube */
+struct tube_cache_header {
+  char magic[8];                 /* "FUNTUBE" */
+  uint32_t version;              /* Version of the file format */
+  uint32_t byteOrder;            /* 0x01020304 written in the byte order of the writer */
+  uint64_t hash;                 /* Content hash of the reference x and y values */
+  uint64_t nReference;           /* Number of reference points */
+  struct tolerances tolerances;  /* Tolerances used to build the tube */
+  int32_t engine;                /* Engine requested to build the tube */
+  int32_t reserved;
+  uint64_t nLower;               /* Number of points of the lower tube curve */
+  uint64_t nUpper;               /* Number of points of the upper tube curve */
+  uint64_t checksum;             /* Hash of the arrays of the tube, see hashWords */
+};
+
+uint64_t hashReference(const struct data *reference);
+
+int loadTubeCache(tube_t *tube, const char *fileName, const struct data *reference,
+  struct tolerances tolerances, const struct options *options);
+
+int saveTubeCache(const tube_t *tube, const char *fileName);
+
+int createTubeCached(
+  tube_t **tube,
+  const char *fileName,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  const struct options *options
+);
+
+#endif /* TUBECACHE_H_ */
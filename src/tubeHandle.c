@@ -0,0 +1,277 @@
+/*
+ * tubeHandle.c
+ *
+ * Functions:
+ * ----------
+ *   initTube: build a tube from a reference stored by the caller
+ *   releaseTube: free the memory held by a tube
+ *   createTube: build a tube from a copy of a reference
+ *   validateTube: validate a test curve against a tube
+ *   getTubeLower: query the lower tube curve
+ *   getTubeUpper: query the upper tube curve
+ *   freeErrorReport: free the memory held by an error report
+ *   freeTube: free a tube created with createTube
+ *
+ * A tube is built once from a reference and tolerances, then used to validate
+ * any number of test curves. The slopes of the segments of the tube curves are
+ * precomputed, so that validation is a single streaming pass over the test points.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data_structure.h"
+#include "memory.h"
+#include "tubeSize.h"
+#include "tube.h"
+#include "parallel.h"
+#include "tubeHandle.h"
+
+/*
+ * Function: initTube
+ * ------------------
+ *   build a tube from a reference stored by the caller
+ *
+ *   tube: tube to initialize
+ *   reference: reference curve, which must outlive the tube
+ *   tube_size: storage for the tube size, with the same size as reference,
+ *              which must outlive the tube
+ *   tolerances: tolerances
+ *   options: pointer to options struct, or NULL for default options
+ *
+ *   return: 0 if there was success,
+ *           1 if the engine cannot be used with this tube size,
+ *           2 if a tube curve is empty,
+ *           -1 if the memory cannot be allocated
+ *           (the tube is to be released with releaseTube in any case)
+ */
+int initTube(tube_t *tube, struct data *reference, struct data *tube_size,
+  struct tolerances tolerances, const struct options *options) {
+  int engine = (options != NULL) ? options->engine : ENGINE_DEFAULT;
+
+  tube->reference = *reference;
+  tube->tube_size = *tube_size;
+  tube->lower = (struct data){NULL, NULL, 0};
+  tube->upper = (struct data){NULL, NULL, 0};
+  tube->slopeLower = NULL;
+  tube->slopeUpper = NULL;
+  tube->nThreads = (options != NULL && options->nThreads > 0) ? options->nThreads : 0;
+  tube->ownsReference = false;
+  tube->tolerances = tolerances;
+  tube->engine = engine;
+  tube->cache.data = NULL;
+  tube->cache.size = 0;
+
+  // Compute tube size.
+  struct data_char dat_char = get_data_char(reference);
+  set_tube_size(tube_size, reference, dat_char, tolerances);
+  tube->tube_size = *tube_size;
+
+  // Calculate values of lower and upper curve around base
+  int nThreads = (tube->nThreads > 0) ? tube->nThreads : getNumberOfThreads();
+  int retVal = buildTube(reference, tube_size, dat_char, engine, nThreads, &tube->lower, &tube->upper);
+  if (retVal != 0)
+    return retVal;
+  if (tube->lower.n == 0 || tube->upper.n == 0)
+    return 2;
+
+  tube->slopeLower = computeSlopes(tube->lower);
+  tube->slopeUpper = computeSlopes(tube->upper);
+  if (tube->slopeLower == NULL || tube->slopeUpper == NULL)
+    return -1;
+  return 0;
+}
+
+/*
+ * Function: releaseTube
+ * ---------------------
+ *   free the memory held by a tube (tube curves, slopes, and reference if owned)
+ *
+ *   tube: tube
+ */
+void releaseTube(tube_t *tube) {
+  if (tube->cache.data != NULL) {
+    // Curves and slopes are stored in the tube cache file.
+    unmapFile(&tube->cache);
+    tube->lower = (struct data){NULL, NULL, 0};
+    tube->upper = (struct data){NULL, NULL, 0};
+    tube->slopeLower = NULL;
+    tube->slopeUpper = NULL;
+  }
+  freeMemory(tube->lower.x);
+  freeMemory(tube->lower.y);
+  freeMemory(tube->upper.x);
+  freeMemory(tube->upper.y);
+  freeMemory(tube->slopeLower);
+  freeMemory(tube->slopeUpper);
+  if (tube->ownsReference) {
+    freeMemory(tube->reference.x);
+    freeMemory(tube->reference.y);
+    freeMemory(tube->tube_size.x);
+    freeMemory(tube->tube_size.y);
+  }
+}
+
+/*
+ * Function: createTube
+ * --------------------
+ *   build a tube from a copy of a reference
+ *
+ *   tube: pointer receiving the tube, to be freed with freeTube
+ *         (NULL if there was no success)
+ *   tReference, yReference: reference x and y values
+ *   nReference: number of reference points
+ *   atolx, atoly, ltolx, ltoly, rtolx, rtoly: tolerances, see compareAndReport
+ *   options: pointer to options struct, or NULL for default options
+ *
+ *   return: 0 if there was success,
+ *           1 if the engine cannot be used with this tube size,
+ *           2 if a tube curve is empty,
+ *           -1 if the memory cannot be allocated
+ */
+int createTube(
+  tube_t **tube,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  const struct options *options
+) {
+  struct tolerances tolerances = {
+    .atolx = atolx,
+    .atoly = atoly,
+    .ltolx = ltolx,
+    .ltoly = ltoly,
+    .rtolx = rtolx,
+    .rtoly = rtoly,
+  };
+  struct data reference, tube_size;
+  int retVal;
+
+  *tube = NULL;
+  if (nReference == 0)
+    return 1;
+  tube_t *tub = allocateMemory(sizeof(tube_t));
+  reference.x = allocateMemory(nReference * sizeof(double));
+  reference.y = allocateMemory(nReference * sizeof(double));
+  tube_size.x = allocateMemory(nReference * sizeof(double));
+  tube_size.y = allocateMemory(nReference * sizeof(double));
+  if ((tub == NULL) || (reference.x == NULL) || (reference.y == NULL)
+      || (tube_size.x == NULL) || (tube_size.y == NULL)) {
+    freeMemory(tub);
+    freeMemory(reference.x);
+    freeMemory(reference.y);
+    freeMemory(tube_size.x);
+    freeMemory(tube_size.y);
+    return -1;
+  }
+  memcpy(reference.x, tReference, nReference * sizeof(double));
+  memcpy(reference.y, yReference, nReference * sizeof(double));
+  reference.n = nReference;
+  tube_size.n = nReference;
+
+  retVal = initTube(tub, &reference, &tube_size, tolerances, options);
+  tub->ownsReference = true;
+  if (retVal != 0) {
+    freeTube(tub);
+    return retVal;
+  }
+  *tube = tub;
+  return 0;
+}
+
+/*
+ * Function: validateTube
+ * ----------------------
+ *   validate a test curve against a tube and generate error report
+ *   (see validateParallel)
+ *
+ *   tube: tube
+ *   tTest, yTest: test x and y values
+ *   nTest: number of test points
+ *   err: error report, to be freed with freeErrorReport
+ *
+ *   return: 0 if there was success
+ */
+int validateTube(
+  const tube_t *tube,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  struct errorReport *err
+) {
+  struct data test = {(double *)tTest, (double *)yTest, nTest};
+  int nThreads = (tube->nThreads > 0) ? tube->nThreads : getNumberOfThreads();
+  return validateParallel(tube->lower, tube->upper, tube->slopeLower, tube->slopeUpper,
+    test, nThreads, err);
+}
+
+/*
+ * Function: getTubeLower
+ * ----------------------
+ *   query the lower tube curve
+ *
+ *   tube: tube
+ *   x, y: pointers receiving the x and y values of the curve, owned by the tube
+ *
+ *   return: number of points of the curve
+ */
+size_t getTubeLower(const tube_t *tube, const double **x, const double **y) {
+  *x = tube->lower.x;
+  *y = tube->lower.y;
+  return tube->lower.n;
+}
+
+/*
+ * Function: getTubeUpper
+ * ----------------------
+ *   query the upper tube curve
+ *
+ *   tube: tube
+ *   x, y: pointers receiving the x and y values of the curve, owned by the tube
+ *
+ *   return: number of points of the curve
+ */
+size_t getTubeUpper(const tube_t *tube, const double **x, const double **y) {
+  *x = tube->upper.x;
+  *y = tube->upper.y;
+  return tube->upper.n;
+}
+
+/*
+ * Function: freeErrorReport
+ * -------------------------
+ *   free the memory held by an error report
+ *
+ *   err: error report
+ */
+void freeErrorReport(struct errorReport *err) {
+  freeMemory(err->original.x);
+  freeMemory(err->original.y);
+  freeMemory(err->diff.x);
+  freeMemory(err->diff.y);
+  freeMemory(err->intervals.intervals);
+  err->original = (struct data){NULL, NULL, 0};
+  err->diff = (struct data){NULL, NULL, 0};
+  err->intervals = (struct violations){NULL, 0};
+}
+
+/*
+ * Function: freeTube
+ * ------------------
+ *   free a tube created with createTube
+ *
+ *   tube: tube
+ */
+void freeTube(tube_t *tube) {
+  if (tube == NULL)
+    return;
+  releaseTube(tube);
+  freeMemory(tube);
+}
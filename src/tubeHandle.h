@@ -0,0 +1,65 @@
+/*
+ * tubeHandle.h
+ */
+
+#ifndef TUBEHANDLE_H_
+#define TUBEHANDLE_H_
+
+#include "stdbool.h"
+
+#include "data_structure.h"
+#include "mapFile.h"
+
+/* Tube built once from a reference, to validate many test curves */
+struct tube {
+  struct data reference;  /* Reference curve */
+  struct data tube_size;  /* Tube size at each reference point */
+  struct data lower;      /* Lower tube curve */
+  struct data upper;      /* Upper tube curve */
+  double *slopeLower;     /* Slopes of the segments of the lower tube curve */
+  double *slopeUpper;     /* Slopes of the segments of the upper tube curve */
+  int nThreads;           /* Number of threads, 0 for the library setting */
+  bool ownsReference;     /* True if reference and tube_size are freed with the tube */
+  struct tolerances tolerances;  /* Tolerances used to build the tube */
+  int engine;             /* Engine requested to build the tube, see enum engines */
+  struct mapped_file cache;      /* Tube cache file holding the curves and slopes, if loaded from cache */
+};
+
+typedef struct tube tube_t;
+
+int initTube(tube_t *tube, struct data *reference, struct data *tube_size,
+  struct tolerances tolerances, const struct options *options);
+
+void releaseTube(tube_t *tube);
+
+int createTube(
+  tube_t **tube,
+  const double *tReference,
+  const double *yReference,
+  const size_t nReference,
+  const double atolx,
+  const double atoly,
+  const double ltolx,
+  const double ltoly,
+  const double rtolx,
+  const double rtoly,
+  const struct options *options
+);
+
+int validateTube(
+  const tube_t *tube,
+  const double *tTest,
+  const double *yTest,
+  const size_t nTest,
+  struct errorReport *err
+);
+
+size_t getTubeLower(const tube_t *tube, const double **x, const double **y);
+
+size_t getTubeUpper(const tube_t *tube, const double **x, const double **y);
+
+void freeErrorReport(struct errorReport *err);
+
+void freeTube(tube_t *tube);
+
+#endif /* TUBEHANDLE_H_ */
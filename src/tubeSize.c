@@ -107,15 +107,15 @@ struct data_char get_data_char(struct data *dat) {
  * ------------------
  *   Calculate tube size (half-width and half-height of rectangle)
  *
- *   refData   : pointer to struct with the reference data
  *   tube_size : pointer to struct with the tube size
+ *   refData   : pointer to struct with the reference data
+ *   dat_char  : data characteristics of the reference data, see get_data_char
  *   tol       : struct with tolerance values
  *
  *   return    : void (modifies tube_size in place)
  */
-void set_tube_size(struct data *tube_size, struct data *refData, struct tolerances tol) {
+void set_tube_size(struct data *tube_size, struct data *refData, struct data_char dat_char, struct tolerances tol) {
   size_t i;
-  struct data_char dat_char = get_data_char(refData);
 
   for (i = 0; i < refData->n; i++)
   {
@@ -10,7 +10,7 @@
 #ifndef TUBESIZE_H_
 #define TUBESIZE_H_
 
-void set_tube_size(struct data *tube_size, struct data *refData, struct tolerances tol);
+void set_tube_size(struct data *tube_size, struct data *refData, struct data_char dat_char, struct tolerances tol);
 
 struct data_char get_data_char(struct data *dat);
 
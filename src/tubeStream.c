@@ -0,0 +1,144 @@
+/*
+ * tubeStream.c
+ *
+ * Functions:
+ * ----------
+ *   createTubeStream: create a validator fed with test samples
+ *   feedSample: validate one test sample
+ *   feedSamples: validate a block of test samples
+ *   stopOnFirstViolation: violation callback stopping the stream at the first violation
+ *   freeTubeStream: free a validator created with createTubeStream
+ *
+ * The samples are validated as they come, in increasing x order, for instance
+ * while a simulation is running. The interpolation cursors of the tube curves
+ * only move forward, so that each call runs in constant memory, and the result
+ * for each sample is the same as with validate for the whole test curve.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "data_structure.h"
+#include "memory.h"
+#include "tube.h"
+#include "tubeHandle.h"
+#include "tubeStream.h"
+
+/*
+ * Function: createTubeStream
+ * --------------------------
+ *   create a validator fed with test samples
+ *
+ *   tube: tube to validate the samples against, which must outlive the validator
+ *   onViolation: function called for each sample out of the tube, or NULL
+ *                (see stopOnFirstViolation)
+ *   userData: user data passed to onViolation
+ *
+ *   return: validator, to be freed with freeTubeStream (NULL if the tube is empty
+ *           or the memory cannot be allocated)
+ */
+tube_stream_t *createTubeStream(const tube_t *tube, violation_callback onViolation, void *userData) {
+  if (tube == NULL || tube->lower.n < 2 || tube->upper.n < 2)
+    return NULL;
+  tube_stream_t *stream = allocateMemory(sizeof(tube_stream_t));
+  if (stream == NULL)
+    return NULL;
+  stream->tube = tube;
+  stream->j[0] = 1;
+  stream->j[1] = 1;
+  stream->xLast = -INFINITY;
+  stream->nSamples = 0;
+  stream->nViolations = 0;
+  stream->firstViolation = NAN;
+  stream->maxError = 0.0;
+  stream->onViolation = onViolation;
+  stream->userData = userData;
+  stream->stopped = false;
+  return stream;
+}
+
+/*
+ * Function: feedSample
+ * --------------------
+ *   validate one test sample
+ *
+ *   stream: validator
+ *   x, y: test sample, with x not lower than the x value of the previous sample
+ *
+ *   return: 0 if the stream goes on, 1 if the stream is stopped,
+ *           -1 if x is lower than the previous x value or beyond the tube
+ *           (the sample is then ignored)
+ */
+int feedSample(tube_stream_t *stream, double x, double y) {
+  const tube_t *tube = stream->tube;
+
+  if (stream->stopped)
+    return 1;
+  if (x < stream->xLast || x > tube->lower.x[tube->lower.n - 1] || x > tube->upper.x[tube->upper.n - 1])
+    return -1;
+  stream->xLast = x;
+  stream->nSamples++;
+
+  double lower = interpolateAt(&tube->lower, tube->slopeLower, &stream->j[0], x);
+  double upper = interpolateAt(&tube->upper, tube->slopeUpper, &stream->j[1], x);
+  if (y < lower || y > upper) {
+    double error = (y < lower) ? lower - y : y - upper;
+    if (stream->nViolations == 0)
+      stream->firstViolation = x;
+    stream->nViolations++;
+    if (error > stream->maxError)
+      stream->maxError = error;
+    if (stream->onViolation != NULL && stream->onViolation(stream->userData, x, y, error) != 0) {
+      stream->stopped = true;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Function: feedSamples
+ * ---------------------
+ *   validate a block of test samples
+ *
+ *   stream: validator
+ *   x, y: test samples, with x sorted in increasing order
+ *   n: number of samples
+ *
+ *   return: see feedSample; the block is validated up to the first sample
+ *           that stops the stream or is rejected
+ */
+int feedSamples(tube_stream_t *stream, const double *x, const double *y, size_t n) {
+  size_t i;
+  int retVal = stream->stopped ? 1 : 0;
+  for (i = 0; i < n && retVal == 0; i++)
+    retVal = feedSample(stream, x[i], y[i]);
+  return retVal;
+}
+
+/*
+ * Function: stopOnFirstViolation
+ * ------------------------------
+ *   violation callback stopping the stream at the first sample out of the tube
+ *
+ *   return: 1
+ */
+int stopOnFirstViolation(void *userData, double x, double y, double error) {
+  (void)userData;
+  (void)x;
+  (void)y;
+  (void)error;
+  return 1;
+}
+
+/*
+ * Function: freeTubeStream
+ * ------------------------
+ *   free a validator created with createTubeStream (the tube is not freed)
+ *
+ *   stream: validator
+ */
+void freeTubeStream(tube_stream_t *stream) {
+  freeMemory(stream);
+}
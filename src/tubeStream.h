@@ -0,0 +1,46 @@
+/*
+ * tubeStream.h
+ */
+
+#ifndef TUBESTREAM_H_
+#define TUBESTREAM_H_
+
+#include "stdbool.h"
+
+#include "data_structure.h"
+#include "tubeHandle.h"
+
+/*
+ * Callback called for each test sample out of the tube, with the user data
+ * given to createTubeStream, the sample and the error value (distance to the tube).
+ * Returning a nonzero value stops the stream.
+ */
+typedef int (*violation_callback)(void *userData, double x, double y, double error);
+
+/* Validator fed with test samples in increasing x order */
+struct tube_stream {
+  const tube_t *tube;             /* Tube, which must outlive the stream */
+  size_t j[2];                    /* Interpolation cursors in the lower and upper tube curves */
+  double xLast;                   /* x value of the last sample */
+  size_t nSamples;                /* Number of samples validated */
+  size_t nViolations;             /* Number of samples out of the tube */
+  double firstViolation;          /* x value of the first sample out of the tube */
+  double maxError;                /* Largest error value */
+  violation_callback onViolation; /* Callback for samples out of the tube, or NULL */
+  void *userData;                 /* User data passed to onViolation */
+  bool stopped;                   /* True once onViolation has returned a nonzero value */
+};
+
+typedef struct tube_stream tube_stream_t;
+
+tube_stream_t *createTubeStream(const tube_t *tube, violation_callback onViolation, void *userData);
+
+int feedSample(tube_stream_t *stream, double x, double y);
+
+int feedSamples(tube_stream_t *stream, const double *x, const double *y, size_t n);
+
+int stopOnFirstViolation(void *userData, double x, double y, double error);
+
+void freeTubeStream(tube_stream_t *stream);
+
+#endif /* TUBESTREAM_H_ */
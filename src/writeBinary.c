@@ -0,0 +1,289 @@
+/*
+ * writeBinary.c
+ *
+ * Functions:
+ * ----------
+ *   storeLittleEndian: store an unsigned integer in little-endian byte order
+ *   xOffset: offset of the x column of a binary result file
+ *   seekFile: move to an offset of a file, beyond 2 GB
+ *   openBinaryWriter: open a binary result file for writing (x, y) rows
+ *   flushColumns: write the buffered bytes of the columns
+ *   writeBinaryRows: append (x, y) rows to a binary result file
+ *   copyTemporary: append the x column stored in the temporary file
+ *   closeBinaryWriter: write the remaining rows and the header, and close a binary result file
+ *
+ * A binary result file holds the columns of a curve, so that they can be read
+ * without parsing (e.g. with numpy.memmap). All numbers are little-endian.
+ *
+ *   offset  type        content
+ *   0       char[8]     magic "FUNNELB\0"
+ *   8       uint32      format version (1)
+ *   12      uint32      encoding of the x column, see enum x_encodings
+ *   16      uint64      number of rows n
+ *   24      uint64      offset of the y column (64)
+ *   32      uint64      offset of the x column (64 + 8 n, rounded up to a multiple of 64)
+ *   40      uint64      number of bytes of the x column
+ *   48      uint8[16]   reserved (0)
+ *
+ * The y column is stored as n float64 values. The x column is stored as n float64
+ * values (X_ENCODING_RAW), or losslessly compressed (X_ENCODING_DELTA): for
+ * monotone x values, the second differences of the bit patterns, taken as 64-bit
+ * integers, are small, and they are stored as LEB128 varints after zigzag encoding
+ * (1 or 2 bytes per value for evenly spaced x values, instead of 8).
+ * The y column comes first, so that both columns can be written in one pass
+ * before the number of rows is known.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "writeBinary.h"
+
+/* Format version of the binary result files */
+#define BINARY_VERSION 1
+
+/* Largest number of bytes of an encoded x value */
+#define X_VALUE_MAX_LENGTH 10
+
+/*
+ * Function: storeLittleEndian
+ * ---------------------------
+ *   store an unsigned integer in little-endian byte order
+ *
+ *   p: destination
+ *   value: integer
+ *   nBytes: number of bytes (4 or 8)
+ */
+static void storeLittleEndian(unsigned char *p, uint64_t value, int nBytes) {
+  int i;
+  for (i = 0; i < nBytes; i++)
+    p[i] = (unsigned char)(value >> (8 * i));
+}
+
+/*
+ * Function: xOffset
+ * -----------------
+ *   offset of the x column of a binary result file
+ *
+ *   n: number of rows
+ *
+ *   return: offset in bytes
+ */
+static uint64_t xOffset(size_t n) {
+  uint64_t end = BINARY_HEADER_SIZE + 8 * (uint64_t)n;
+  return (end + BINARY_HEADER_SIZE - 1) / BINARY_HEADER_SIZE * BINARY_HEADER_SIZE;
+}
+
+/*
+ * Function: seekFile
+ * ------------------
+ *   move to an offset of a file, beyond 2 GB
+ *
+ *   file: file
+ *   offset: offset from the beginning of the file
+ *
+ *   return: 0 if there was success
+ */
+static int seekFile(FILE *file, uint64_t offset) {
+#if defined(_WIN32)
+  return _fseeki64(file, (__int64)offset, SEEK_SET);
+#else
+  return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+/*
+ * Function: openBinaryWriter
+ * --------------------------
+ *   open a binary result file for writing (x, y) rows.
+ *   If the number of rows is known, the x column is written in place through a
+ *   second descriptor; otherwise, it is written to a temporary file next to the
+ *   output file, and appended by closeBinaryWriter.
+ *
+ *   writer: writer, to be closed with closeBinaryWriter
+ *   fileName: path of the file
+ *   nRows: number of rows to be written, SIZE_MAX if unknown
+ *   encoding: encoding of the x column, see enum x_encodings
+ *
+ *   return: 0 if there was success, -1 if the file cannot be opened
+ *           or the memory cannot be allocated (the writer is then not open)
+ */
+int openBinaryWriter(struct binary_writer *writer, const char *fileName, size_t nRows, int encoding) {
+  unsigned char header[BINARY_HEADER_SIZE] = {0};
+
+  memset(writer, 0, sizeof(struct binary_writer));
+  writer->encoding = encoding;
+  writer->nRows = nRows;
+  writer->file = fopen(fileName, "wb+");
+  if (writer->file == NULL)
+    return -1;
+  if (nRows != SIZE_MAX) {
+    writer->xFile = fopen(fileName, "r+b");
+    if (writer->xFile == NULL || seekFile(writer->xFile, xOffset(nRows)) != 0)
+      writer->status = -1;
+  } else {
+    writer->tempName = allocateMemory(strlen(fileName) + 5);
+    if (writer->tempName == NULL) {
+      writer->status = -1;
+    } else {
+      strcpy(writer->tempName, fileName);
+      strcat(writer->tempName, ".tmp");
+      writer->xFile = fopen(writer->tempName, "wb+");
+      if (writer->xFile == NULL)
+        writer->status = -1;
+    }
+  }
+  writer->xBuffer = allocateMemory(BINARY_WRITER_BUFFER_SIZE);
+  writer->yBuffer = allocateMemory(BINARY_WRITER_BUFFER_SIZE);
+  if (writer->xBuffer == NULL || writer->yBuffer == NULL) {
+    writer->status = -1;
+  }
+  setvbuf(writer->file, NULL, _IONBF, 0);
+  if (writer->xFile != NULL)
+    setvbuf(writer->xFile, NULL, _IONBF, 0);
+  // The header is written when the file is closed.
+  if (fwrite(header, 1, BINARY_HEADER_SIZE, writer->file) != BINARY_HEADER_SIZE)
+    writer->status = -1;
+  if (writer->status != 0) {
+    closeBinaryWriter(writer);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Function: flushColumns
+ * ----------------------
+ *   write the buffered bytes of the columns
+ *
+ *   writer: writer
+ */
+static void flushColumns(struct binary_writer *writer) {
+  if (writer->xLength > 0 && fwrite(writer->xBuffer, 1, writer->xLength, writer->xFile) != writer->xLength)
+    writer->status = -1;
+  if (writer->yLength > 0 && fwrite(writer->yBuffer, 1, writer->yLength, writer->file) != writer->yLength)
+    writer->status = -1;
+  writer->xLength = 0;
+  writer->yLength = 0;
+}
+
+/*
+ * Function: writeBinaryRows
+ * -------------------------
+ *   append (x, y) rows to a binary result file
+ *
+ *   writer: writer opened with openBinaryWriter
+ *   x, y: x and y values of the rows
+ *   n: number of rows
+ */
+void writeBinaryRows(struct binary_writer *writer, const double *x, const double *y, size_t n) {
+  size_t i;
+  uint64_t bits;
+  for (i = 0; i < n; i++) {
+    if (writer->xLength > BINARY_WRITER_BUFFER_SIZE - X_VALUE_MAX_LENGTH
+        || writer->yLength > BINARY_WRITER_BUFFER_SIZE - 8)
+      flushColumns(writer);
+    unsigned char *p = writer->xBuffer + writer->xLength;
+    memcpy(&bits, &x[i], sizeof(double));
+    if (writer->encoding == X_ENCODING_DELTA) {
+      const uint64_t delta = bits - writer->previous;
+      const uint64_t dd = delta - writer->delta;
+      uint64_t z = (dd << 1) ^ (0 - (dd >> 63));  // zigzag: small negative differences to small integers
+      writer->previous = bits;
+      writer->delta = delta;
+      while (z >= 0x80) {
+        *p++ = (unsigned char)(z | 0x80);
+        z >>= 7;
+      }
+      *p++ = (unsigned char)z;
+    } else {
+      storeLittleEndian(p, bits, 8);
+      p += 8;
+    }
+    writer->xSize += (uint64_t)(p - (writer->xBuffer + writer->xLength));
+    writer->xLength = (size_t)(p - writer->xBuffer);
+    memcpy(&bits, &y[i], sizeof(double));
+    storeLittleEndian(writer->yBuffer + writer->yLength, bits, 8);
+    writer->yLength += 8;
+  }
+  writer->n += n;
+}
+
+/*
+ * Function: copyTemporary
+ * -----------------------
+ *   append the x column stored in the temporary file to the output file,
+ *   after the padding of the y column
+ *
+ *   writer: writer, with the columns flushed
+ */
+static void copyTemporary(struct binary_writer *writer) {
+  size_t nRead;
+  uint64_t padding = xOffset(writer->n) - (BINARY_HEADER_SIZE + 8 * (uint64_t)writer->n);
+  memset(writer->xBuffer, 0, (size_t)padding);
+  if (fwrite(writer->xBuffer, 1, (size_t)padding, writer->file) != padding || seekFile(writer->xFile, 0) != 0) {
+    writer->status = -1;
+    return;
+  }
+  while ((nRead = fread(writer->xBuffer, 1, BINARY_WRITER_BUFFER_SIZE, writer->xFile)) > 0) {
+    if (fwrite(writer->xBuffer, 1, nRead, writer->file) != nRead) {
+      writer->status = -1;
+      return;
+    }
+  }
+  if (ferror(writer->xFile))
+    writer->status = -1;
+}
+
+/*
+ * Function: closeBinaryWriter
+ * ---------------------------
+ *   write the remaining rows and the header, and close a binary result file
+ *
+ *   writer: writer opened with openBinaryWriter, or not open (file set to NULL)
+ *
+ *   return: 0 if there was success, -1 if a write failed or if the number
+ *           of rows differs from the number given to openBinaryWriter
+ */
+int closeBinaryWriter(struct binary_writer *writer) {
+  unsigned char header[BINARY_HEADER_SIZE] = {0};
+
+  if (writer->file == NULL)
+    return 0;
+  if (writer->xFile != NULL) {
+    flushColumns(writer);
+    if (writer->tempName != NULL && writer->status == 0)
+      copyTemporary(writer);
+    if (fclose(writer->xFile) != 0)
+      writer->status = -1;
+  }
+  if (writer->nRows != SIZE_MAX && writer->n != writer->nRows)
+    writer->status = -1;
+
+  memcpy(header, "FUNNELB", 8);
+  storeLittleEndian(header + 8, BINARY_VERSION, 4);
+  storeLittleEndian(header + 12, (uint64_t)writer->encoding, 4);
+  storeLittleEndian(header + 16, (uint64_t)writer->n, 8);
+  storeLittleEndian(header + 24, BINARY_HEADER_SIZE, 8);
+  storeLittleEndian(header + 32, xOffset(writer->n), 8);
+  storeLittleEndian(header + 40, writer->xSize, 8);
+  if (seekFile(writer->file, 0) != 0 || fwrite(header, 1, BINARY_HEADER_SIZE, writer->file) != BINARY_HEADER_SIZE)
+    writer->status = -1;
+  if (fclose(writer->file) != 0)
+    writer->status = -1;
+
+  if (writer->tempName != NULL) {
+    remove(writer->tempName);
+    freeMemory(writer->tempName);
+  }
+  freeMemory(writer->xBuffer);
+  freeMemory(writer->yBuffer);
+  writer->file = NULL;
+  writer->xFile = NULL;
+  writer->tempName = NULL;
+  writer->xBuffer = NULL;
+  writer->yBuffer = NULL;
+  return writer->status;
+}
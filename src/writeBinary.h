@@ -0,0 +1,52 @@
+/*
+ * writeBinary.h
+ */
+
+#ifndef WRITEBINARY_H_
+#define WRITEBINARY_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stdbool.h"
+
+/* Size of the header of a binary result file, and alignment of its columns */
+#define BINARY_HEADER_SIZE 64
+
+/* Number of bytes buffered for each column by a binary writer */
+#ifndef BINARY_WRITER_BUFFER_SIZE
+#define BINARY_WRITER_BUFFER_SIZE (1 << 18)
+#endif
+
+/* Encodings of the x column of a binary result file */
+enum x_encodings {
+  X_ENCODING_RAW = 0,    /* Little-endian float64 values */
+  X_ENCODING_DELTA = 1   /* Zigzag LEB128 varints of the second differences of the bit patterns */
+};
+
+/* Binary result file of (x, y) rows, see writeBinary.c for the format */
+struct binary_writer {
+  FILE *file;               /* Output file: header and y column, NULL if not open */
+  FILE *xFile;              /* x column: output file at the x offset if the number of rows is known, temporary file otherwise */
+  char *tempName;           /* Name of the temporary file, NULL if not used */
+  int encoding;             /* Encoding of the x column, see enum x_encodings */
+  size_t nRows;             /* Number of rows given to openBinaryWriter, SIZE_MAX if unknown */
+  size_t n;                 /* Number of rows written */
+  uint64_t xSize;           /* Number of bytes of the x column */
+  uint64_t previous;        /* Bit pattern of the previous x value (delta encoding) */
+  uint64_t delta;           /* Previous difference of the bit patterns (delta encoding) */
+  unsigned char *xBuffer;   /* x column bytes not written yet */
+  unsigned char *yBuffer;   /* y column bytes not written yet */
+  size_t xLength;           /* Number of bytes in xBuffer */
+  size_t yLength;           /* Number of bytes in yBuffer */
+  int status;               /* 0, or -1 after a failed write */
+};
+
+int openBinaryWriter(struct binary_writer *writer, const char *fileName, size_t nRows, int encoding);
+
+void writeBinaryRows(struct binary_writer *writer, const double *x, const double *y, size_t n);
+
+int closeBinaryWriter(struct binary_writer *writer);
+
+#endif /* WRITEBINARY_H_ */
@@ -0,0 +1,152 @@
+/*
+ * writeCSV.c
+ *
+ * Functions:
+ * ----------
+ *   openCSVWriter: open a CSV file for writing (x, y) rows
+ *   flushCSVWriter: write the buffered rows to the file
+ *   writeCSVRows: append (x, y) rows to a CSV file
+ *   closeCSVWriter: write the remaining rows and close a CSV file
+ *   writeViolationsCSV: write the violation intervals of a test curve to a CSV file
+ *
+ * The numbers are formatted with formatDouble, which writes the shortest
+ * representation read back as the same double, into a buffer of
+ * CSV_WRITER_BUFFER_SIZE characters. The buffer is written with one call
+ * to fwrite when it is full, the file itself being unbuffered.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "formatDouble.h"
+#include "memory.h"
+#include "writeCSV.h"
+
+/* Largest number of characters of a row */
+#define CSV_ROW_MAX_LENGTH (2 * FORMAT_DOUBLE_MAX_LENGTH + 2)
+
+/*
+ * Function: openCSVWriter
+ * -----------------------
+ *   open a CSV file for writing (x, y) rows, and write its header "x,y"
+ *
+ *   writer: writer, to be closed with closeCSVWriter
+ *   fileName: path of the file
+ *
+ *   return: 0 if there was success, -1 if the file cannot be opened
+ *           or the memory cannot be allocated (the writer is then not open)
+ */
+int openCSVWriter(struct csv_writer *writer, const char *fileName) {
+  writer->buffer = NULL;
+  writer->length = 0;
+  writer->status = 0;
+  writer->file = fopen(fileName, "w+");
+  if (writer->file == NULL)
+    return -1;
+  setvbuf(writer->file, NULL, _IONBF, 0);
+  writer->buffer = allocateMemory(CSV_WRITER_BUFFER_SIZE);
+  if (writer->buffer == NULL) {
+    fclose(writer->file);
+    writer->file = NULL;
+    return -1;
+  }
+  memcpy(writer->buffer, "x,y\n", 4);
+  writer->length = 4;
+  return 0;
+}
+
+/*
+ * Function: flushCSVWriter
+ * ------------------------
+ *   write the buffered rows to the file
+ *
+ *   writer: writer
+ */
+static void flushCSVWriter(struct csv_writer *writer) {
+  if (writer->length > 0 && fwrite(writer->buffer, 1, writer->length, writer->file) != writer->length)
+    writer->status = -1;
+  writer->length = 0;
+}
+
+/*
+ * Function: writeCSVRows
+ * ----------------------
+ *   append (x, y) rows to a CSV file
+ *
+ *   writer: writer opened with openCSVWriter
+ *   x, y: x and y values of the rows
+ *   n: number of rows
+ */
+void writeCSVRows(struct csv_writer *writer, const double *x, const double *y, size_t n) {
+  size_t i;
+  for (i = 0; i < n; i++) {
+    if (writer->length > CSV_WRITER_BUFFER_SIZE - CSV_ROW_MAX_LENGTH)
+      flushCSVWriter(writer);
+    char *p = writer->buffer + writer->length;
+    p = formatDouble(p, x[i]);
+    *p++ = ',';
+    p = formatDouble(p, y[i]);
+    *p++ = '\n';
+    writer->length = (size_t)(p - writer->buffer);
+  }
+}
+
+/*
+ * Function: closeCSVWriter
+ * ------------------------
+ *   write the remaining rows and close a CSV file
+ *
+ *   writer: writer opened with openCSVWriter, or not open (file set to NULL)
+ *
+ *   return: 0 if there was success, -1 if a write failed
+ */
+int closeCSVWriter(struct csv_writer *writer) {
+  if (writer->file == NULL)
+    return 0;
+  flushCSVWriter(writer);
+  if (fclose(writer->file) != 0)
+    writer->status = -1;
+  writer->file = NULL;
+  freeMemory(writer->buffer);
+  writer->buffer = NULL;
+  return writer->status;
+}
+
+/*
+ * Function: writeViolationsCSV
+ * ----------------------------
+ *   write the violation intervals of a test curve to a CSV file, one row
+ *   "xStart,xEnd,peak,xPeak" per interval (header only if there is no violation)
+ *
+ *   fileName: path of the file
+ *   violations: violation intervals
+ *
+ *   return: 0 if there was success, -1 if the file cannot be written
+ */
+int writeViolationsCSV(const char *fileName, const struct violations *violations) {
+  char row[4 * FORMAT_DOUBLE_MAX_LENGTH + 4];
+  size_t i;
+  int retVal = 0;
+  FILE *file = fopen(fileName, "w");
+  if (file == NULL)
+    return -1;
+  if (fputs("xStart,xEnd,peak,xPeak\n", file) == EOF)
+    retVal = -1;
+  for (i = 0; i < violations->n && retVal == 0; i++) {
+    const struct violation *v = &violations->intervals[i];
+    char *p = formatDouble(row, v->xStart);
+    *p++ = ',';
+    p = formatDouble(p, v->xEnd);
+    *p++ = ',';
+    p = formatDouble(p, v->peak);
+    *p++ = ',';
+    p = formatDouble(p, v->xPeak);
+    *p++ = '\n';
+    if (fwrite(row, 1, (size_t)(p - row), file) != (size_t)(p - row))
+      retVal = -1;
+  }
+  if (fclose(file) != 0)
+    retVal = -1;
+  return retVal;
+}
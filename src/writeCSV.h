@@ -0,0 +1,34 @@
+/*
+ * writeCSV.h
+ */
+
+#ifndef WRITECSV_H_
+#define WRITECSV_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "data_structure.h"
+
+/* Number of characters buffered by a CSV writer before they are written to the file */
+#ifndef CSV_WRITER_BUFFER_SIZE
+#define CSV_WRITER_BUFFER_SIZE (1 << 18)
+#endif
+
+/* CSV file of (x, y) rows written through a large buffer */
+struct csv_writer {
+  FILE *file;       /* Output file, NULL if not open */
+  char *buffer;     /* Formatted rows not written yet */
+  size_t length;    /* Number of characters in buffer */
+  int status;       /* 0, or -1 after a failed write */
+};
+
+int openCSVWriter(struct csv_writer *writer, const char *fileName);
+
+void writeCSVRows(struct csv_writer *writer, const double *x, const double *y, size_t n);
+
+int closeCSVWriter(struct csv_writer *writer);
+
+int writeViolationsCSV(const char *fileName, const struct violations *violations);
+
+#endif /* WRITECSV_H_ */
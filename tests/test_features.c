@@ -0,0 +1,989 @@
+/*
+ * test_features.c
+ *
+ * Tests of the library functions beyond the base comparison of test_lib.c.
+ * Each test returns 0 if it passes, or else 1 with a message on stderr.
+ * The tests run from tests/test_bin, and write their output files to results/.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "../src/compare.h"
+#include "../src/formatDouble.h"
+#include "../src/parseDouble.h"
+
+#if defined(FUNNEL_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#define N_POINTS 5001
+
+/* Number of points of a curve split into chunks and ranges processed on several threads */
+#define N_LARGE 400001
+
+#define CHECK(condition, ...) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: ", __func__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__); \
+            fputc('\n', stderr); \
+            return 1; \
+        } \
+    } while (0)
+
+/* Reference curve, and test curves within and out of the tube */
+static double x[N_POINTS];
+static double y[N_POINTS];
+static double yFail[N_POINTS];
+static double xLarge[N_LARGE];
+static double yLarge[N_LARGE];
+static double yLargeFail[N_LARGE];
+
+static void initCurves(void) {
+    for (size_t i = 0; i < N_POINTS; i++) {
+        x[i] = 10.0 * (double)i / (N_POINTS - 1);
+        y[i] = sin(x[i]);
+        yFail[i] = y[i] + ((i >= 3000 && i < 3010) ? 1.0 : 0.0);
+    }
+    for (size_t i = 0; i < N_LARGE; i++) {
+        xLarge[i] = 1e-3 * (double)i;
+        yLarge[i] = sin(xLarge[i]) + 0.1 * sin(37 * xLarge[i]);
+        yLargeFail[i] = yLarge[i] + ((i % 50000 < 20) ? 0.5 : 0.0);
+    }
+}
+
+/* Return true if both values are equal (without -Wfloat-equal warning). */
+static bool sameValue(double a, double b) {
+    return !(a < b || a > b);
+}
+
+/* Return true if both curves have the same points. */
+static bool sameCurve(size_t n1, const double *x1, const double *y1, size_t n2, const double *x2, const double *y2) {
+    return n1 == n2 && memcmp(x1, x2, n1 * sizeof(double)) == 0 && memcmp(y1, y2, n1 * sizeof(double)) == 0;
+}
+
+/*
+ * Function: readFile
+ * ------------------
+ *   read the content of a file
+ *
+ *   return: content to be freed, or NULL if the file cannot be read
+ */
+static char *readFile(const char *dir, const char *name, size_t *size) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *content = malloc((size_t)n + 1);
+    if (content != NULL) {
+        *size = fread(content, 1, (size_t)n, f);
+        content[*size] = '\0';
+    }
+    fclose(f);
+    return content;
+}
+
+static bool fileExists(const char *dir, const char *name) {
+    size_t size;
+    char *content = readFile(dir, name, &size);
+    free(content);
+    return content != NULL;
+}
+
+/* Return true if the files of both directories exist and are identical. */
+static bool sameFile(const char *dir1, const char *dir2, const char *name) {
+    size_t size1 = 0, size2 = 0;
+    char *content1 = readFile(dir1, name, &size1);
+    char *content2 = readFile(dir2, name, &size2);
+    bool same = content1 != NULL && content2 != NULL && size1 == size2 && memcmp(content1, content2, size1) == 0;
+    free(content1);
+    free(content2);
+    return same;
+}
+
+/* Write a binary file, and return true if there was success. */
+static bool writeBytes(const char *path, const char *content, size_t size) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+        return false;
+    size_t written = fwrite(content, 1, size, f);
+    return fclose(f) == 0 && written == size;
+}
+
+/* Write a text file in the results directory, and return its path. */
+static const char *writeText(const char *name, const char *text) {
+    static char path[256];
+    snprintf(path, sizeof(path), "results/%s", name);
+    FILE *f = fopen(path, "wb");
+    if (f != NULL) {
+        fputs(text, f);
+        fclose(f);
+    }
+    return path;
+}
+
+static bool fileContains(const char *dir, const char *name, const char *text) {
+    size_t size;
+    char *content = readFile(dir, name, &size);
+    bool found = content != NULL && strstr(content, text) != NULL;
+    free(content);
+    return found;
+}
+
+static bool fileEquals(const char *dir, const char *name, const char *text) {
+    size_t size;
+    char *content = readFile(dir, name, &size);
+    bool same = content != NULL && size == strlen(text) && memcmp(content, text, size) == 0;
+    free(content);
+    return same;
+}
+
+static int compareCurves(const double *yTest, const char *dir, const struct options *options) {
+    return compareAndReportWithOptions(x, y, N_POINTS, x, yTest, N_POINTS, dir, 0.01, 0.01, 0, 0, 0, 0, options);
+}
+
+/* Tube built on several threads by chunks of the reference, identical to the tube built on one thread. */
+static int testThreadedTube(void) {
+    static const int engines[2] = {ENGINE_RECTANGLE, ENGINE_WINDOW};
+    for (int e = 0; e < 2; e++) {
+        struct options options = {0};
+        tube_t *tubes[2] = {NULL, NULL};
+        const double *lx[2], *ly[2], *ux[2], *uy[2];
+        size_t nl[2], nu[2];
+        options.engine = engines[e];
+        for (int k = 0; k < 2; k++) {
+            options.nThreads = (k == 0) ? 1 : 4;
+            CHECK(createTube(&tubes[k], xLarge, yLarge, N_LARGE, 0.01, 0.01, 0, 0, 0, 0, &options) == 0,
+                "tube not built with engine %d", engines[e]);
+            nl[k] = getTubeLower(tubes[k], &lx[k], &ly[k]);
+            nu[k] = getTubeUpper(tubes[k], &ux[k], &uy[k]);
+        }
+        bool same = sameCurve(nl[0], lx[0], ly[0], nl[1], lx[1], ly[1])
+            && sameCurve(nu[0], ux[0], uy[0], nu[1], ux[1], uy[1]);
+        freeTube(tubes[0]);
+        freeTube(tubes[1]);
+        CHECK(same, "threaded tube differs with engine %d", engines[e]);
+    }
+    return 0;
+}
+
+/* Value at xv of a tube curve with increasing x values (linear interpolation). */
+static double curveValue(const struct data *curve, double xv) {
+    size_t i = 1;
+    while (i < curve->n - 1 && curve->x[i] < xv)
+        i++;
+    return curve->y[i - 1] + (curve->y[i] - curve->y[i - 1]) * (xv - curve->x[i - 1]) / (curve->x[i] - curve->x[i - 1]);
+}
+
+/* Return true if both tube curves have the same values at the vertices of each other, within tol. */
+static bool sameBound(const struct data *a, const struct data *b, double tol) {
+    for (int k = 0; k < 2; k++) {
+        const struct data *c = k ? b : a, *d = k ? a : b;
+        for (size_t i = 0; i < c->n; i++) {
+            if (c->x[i] < d->x[0] - tol || c->x[i] > d->x[d->n - 1] + tol || fabs(curveValue(d, c->x[i]) - c->y[i]) > tol)
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Tube engines: same bounds and errors with the rectangle and the sliding window engines, up to rounding,
+ * for random references with increasing x values and a constant tube half-width in x (see enum engines).
+ */
+static int testEngines(void) {
+    static double xr[40], yr[40], yt[40];
+    uint64_t state = 0x2545F4914F6CDD1Du;
+    for (int c = 0; c < 2000; c++) {
+        uint64_t r[4 + 3 * 40];
+        for (size_t k = 0; k < sizeof(r) / sizeof(r[0]); k++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            r[k] = state;
+        }
+        // Values on a grid of 0.1, so that test points on the tube curves are frequent.
+        const size_t n = 2 + r[0] % 39;
+        const double atolx = 0.05 + (double)(r[1] % 50) / 10, atoly = 0.1 + (double)(r[2] % 50) / 10;
+        for (size_t i = 0; i < n; i++) {
+            xr[i] = (i == 0) ? 0 : xr[i - 1] + 0.1 + (double)(r[4 + 3 * i] % 100) / 10;
+            yr[i] = (double)(r[5 + 3 * i] % 200) / 10 - 10;
+            yt[i] = yr[i] + (double)(r[6 + 3 * i] % 100) / 50 - 1;
+        }
+        struct comparison_result result[2];
+        for (int e = 0; e < 2; e++) {
+            struct options options = {0};
+            options.engine = e ? ENGINE_WINDOW : ENGINE_RECTANGLE;
+            options.nThreads = 1;
+            CHECK(compareAndReturn(xr, yr, n, xr, yt, n, atolx, atoly, 0, 0, 0, 0, &options, &result[e]) == 0,
+                "case %d not compared with engine %d", c, options.engine);
+        }
+        bool same = sameBound(&result[0].lower, &result[1].lower, 1e-9)
+            && sameBound(&result[0].upper, &result[1].upper, 1e-9);
+        bool sameErrors = result[0].errors.diff.n == result[1].errors.diff.n;
+        for (size_t i = 0; sameErrors && i < result[0].errors.diff.n; i++)
+            sameErrors = fabs(result[0].errors.diff.y[i] - result[1].errors.diff.y[i]) < 1e-9;
+        freeComparisonResult(&result[0]);
+        freeComparisonResult(&result[1]);
+        CHECK(same, "tube of case %d differs between engines", c);
+        CHECK(sameErrors, "errors of case %d differ between engines", c);
+    }
+    return 0;
+}
+
+/* Return true if both error reports have the same errors, violation intervals and summary. */
+static bool sameReport(const struct errorReport *a, const struct errorReport *b) {
+    return sameCurve(a->diff.n, a->diff.x, a->diff.y, b->diff.n, b->diff.x, b->diff.y)
+        && sameCurve(a->original.n, a->original.x, a->original.y, b->original.n, b->original.x, b->original.y)
+        && a->intervals.n == b->intervals.n
+        && memcmp(a->intervals.intervals, b->intervals.intervals, a->intervals.n * sizeof(struct violation)) == 0
+        && memcmp(&a->summary, &b->summary, sizeof(struct violation_summary)) == 0;
+}
+
+/* Test points validated on several threads by ranges, with the same report as validate. */
+static int testValidateParallel(void) {
+    struct options options = {0};
+    tube_t *tube = NULL;
+    struct data lower, upper;
+    const struct data test = {xLarge, yLargeFail, N_LARGE};
+    options.nThreads = 1;
+    CHECK(createTube(&tube, xLarge, yLarge, N_LARGE, 0.01, 0.01, 0, 0, 0, 0, &options) == 0, "tube not built");
+    lower.n = getTubeLower(tube, (const double **)&lower.x, (const double **)&lower.y);
+    upper.n = getTubeUpper(tube, (const double **)&upper.x, (const double **)&upper.y);
+    for (int stopAtFirst = 0; stopAtFirst < 2; stopAtFirst++) {
+        struct errorReport sequential = {0}, parallel = {0};
+        sequential.stopAtFirst = parallel.stopAtFirst = stopAtFirst;
+        int rv = validate(lower, upper, test, &sequential);
+        int rvParallel = validateParallel(lower, upper, NULL, NULL, test, 4, &parallel);
+        bool same = sameReport(&sequential, &parallel);
+        size_t nIntervals = sequential.intervals.n;
+        freeErrorReport(&sequential);
+        freeErrorReport(&parallel);
+        CHECK(rv == 0 && rvParallel == 0, "validation failed");
+        CHECK(nIntervals == (stopAtFirst ? 1u : 9u), "%zu violation intervals", nIntervals);
+        CHECK(same, "parallel report differs with stopAtFirst %d", stopAtFirst);
+    }
+    freeTube(tube);
+    return 0;
+}
+
+/* Batch of comparisons: status and summary of each job, and number of failed jobs. */
+static int testBatch(void) {
+    struct options gate = {0};
+    struct comparison_job jobs[4];
+    const struct tolerances tolerances = {0.01, 0.01, 0, 0, 0, 0};
+    gate.gate = 1;
+    for (int k = 0; k < 4; k++) {
+        jobs[k] = (struct comparison_job){x, y, N_POINTS, x, yFail, N_POINTS, NULL, tolerances, NULL, -1, {0}};
+    }
+    jobs[0].yTest = y;
+    jobs[0].outputDirectory = "results/batch_pass";
+    jobs[1].outputDirectory = "results/batch_fail";
+    jobs[2].outputDirectory = "results/batch_gate";
+    jobs[2].options = &gate;
+    jobs[3].nTest = N_POINTS / 2;  // Test x range shorter than reference x range
+    jobs[3].outputDirectory = "results/batch_error";
+    CHECK(compareAndReportBatch(jobs, 4, 3) == 2, "wrong number of failed jobs");
+    CHECK(jobs[0].status == 0 && jobs[1].status == 0, "statuses %d and %d", jobs[0].status, jobs[1].status);
+    CHECK(jobs[2].status == GATE_FAILED, "gate status %d", jobs[2].status);
+    CHECK(jobs[3].status != 0, "no error for different x ranges");
+    CHECK(jobs[0].summary.nViolations == 0 && isnan(jobs[0].summary.firstViolation), "violations of a passing test");
+
+    // Summary of the failed job, as computed by compareAndReturn
+    struct comparison_result result;
+    CHECK(compareAndReturn(x, y, N_POINTS, x, yFail, N_POINTS, 0.01, 0.01, 0, 0, 0, 0, NULL, &result) == 0,
+        "compareAndReturn failed");
+    bool same = memcmp(&jobs[1].summary, &result.errors.summary, sizeof(struct violation_summary)) == 0;
+    freeComparisonResult(&result);
+    CHECK(same, "summary of the batch job differs from compareAndReturn");
+    CHECK(jobs[1].summary.nViolations == 10, "%zu violations", jobs[1].summary.nViolations);
+    return 0;
+}
+
+/* Tube handle built once and reused for several test curves, with the reports of compareAndReturn. */
+static int testTubeHandle(void) {
+    const double *yTests[3] = {yFail, y, yFail};
+    tube_t *tube = NULL;
+    CHECK(createTube(&tube, x, y, N_POINTS, 0.01, 0.01, 0, 0, 0, 0, NULL) == 0, "tube not built");
+    for (int k = 0; k < 3; k++) {
+        struct errorReport err = {0};
+        struct comparison_result result;
+        int rv = validateTube(tube, x, yTests[k], N_POINTS, &err);
+        int rvReturn = compareAndReturn(x, y, N_POINTS, x, yTests[k], N_POINTS, 0.01, 0.01, 0, 0, 0, 0, NULL, &result);
+        const double *lx, *ly, *ux, *uy;
+        size_t nl = getTubeLower(tube, &lx, &ly);
+        size_t nu = getTubeUpper(tube, &ux, &uy);
+        bool same = rv == 0 && rvReturn == 0 && sameReport(&err, &result.errors)
+            && sameCurve(nl, lx, ly, result.lower.n, result.lower.x, result.lower.y)
+            && sameCurve(nu, ux, uy, result.upper.n, result.upper.x, result.upper.y);
+        freeErrorReport(&err);
+        if (rvReturn == 0)
+            freeComparisonResult(&result);
+        if (!same)
+            freeTube(tube);
+        CHECK(same, "report of test curve %d differs from compareAndReturn", k);
+    }
+    freeTube(tube);
+    return 0;
+}
+
+/* Tube cache: hit for the same reference and tolerances, miss after a change of these or of the file. */
+static int testTubeCache(void) {
+    static const char *cache = "results/tube.cache";
+    static double yChanged[N_POINTS];
+    const struct data reference = {x, y, N_POINTS};
+    const struct data changed = {x, yChanged, N_POINTS};
+    const struct tolerances tolerances = {0.01, 0.01, 0, 0, 0, 0};
+    struct tolerances otherTolerances = tolerances;
+    tube_t *tubes[2] = {NULL, NULL};
+    tube_t loaded;
+    const double *lx[2], *ly[2];
+    size_t nl[2];
+    memcpy(yChanged, y, sizeof(yChanged));
+    yChanged[N_POINTS / 2] += 1e-9;
+    otherTolerances.atoly = 0.02;
+    remove(cache);
+    for (int k = 0; k < 2; k++) {
+        CHECK(createTubeCached(&tubes[k], cache, x, y, N_POINTS, 0.01, 0.01, 0, 0, 0, 0, NULL) == 0, "tube not built");
+        nl[k] = getTubeLower(tubes[k], &lx[k], &ly[k]);
+    }
+    bool miss = tubes[0]->cache.data == NULL;
+    bool hit = tubes[1]->cache.data != NULL;
+    bool same = sameCurve(nl[0], lx[0], ly[0], nl[1], lx[1], ly[1]);
+    freeTube(tubes[0]);
+    freeTube(tubes[1]);
+    CHECK(miss && hit, "first tube loaded from cache, or second tube built");
+    CHECK(same, "cached tube differs from built tube");
+
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(loadTubeCache(&loaded, cache, &reference, otherTolerances, NULL) == 1, "hit with other tolerances");
+    CHECK(loadTubeCache(&loaded, cache, &changed, tolerances, NULL) == 1, "hit with other reference");
+    CHECK(loadTubeCache(&loaded, cache, &reference, tolerances, NULL) == 0, "miss with same reference");
+    releaseTube(&loaded);
+
+    // Corrupted header: a point count that makes the expected size of the file wrap around to its size,
+    // the arrays and their checksum being unchanged.
+    size_t size;
+    char *content = readFile("results", "tube.cache", &size);
+    CHECK(content != NULL, "no cache file");
+    struct tube_cache_header header;
+    memcpy(&header, content, sizeof(header));
+    header.nLower += (uint64_t)1 << 61;
+    memcpy(content, &header, sizeof(header));
+    CHECK(writeBytes(cache, content, size), "cache file not written");
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(loadTubeCache(&loaded, cache, &reference, tolerances, NULL) == 1, "hit with corrupted point count");
+    header.nLower -= (uint64_t)1 << 61;
+    memcpy(content, &header, sizeof(header));
+
+    // Corrupted array: the checksum does not match.
+    content[size - 1] ^= 1;
+    bool written = writeBytes(cache, content, size);
+    free(content);
+    CHECK(written, "cache file not written");
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(loadTubeCache(&loaded, cache, &reference, tolerances, NULL) == 1, "hit with corrupted file");
+    return 0;
+}
+
+/* Samples out of the tube received by a stream */
+struct stream_violations {
+    size_t n;
+    double x[N_POINTS];
+    double error[N_POINTS];
+};
+
+static int recordViolation(void *userData, double xSample, double ySample, double error) {
+    struct stream_violations *v = userData;
+    (void)ySample;
+    v->x[v->n] = xSample;
+    v->error[v->n] = error;
+    v->n++;
+    return 0;
+}
+
+/* Streaming validation by blocks of samples, with the errors of validateTube, and stop at the first violation. */
+static int testStream(void) {
+    static struct stream_violations violations;
+    tube_t *tube = NULL;
+    struct errorReport err = {0};
+    CHECK(createTube(&tube, x, y, N_POINTS, 0.01, 0.01, 0, 0, 0, 0, NULL) == 0, "tube not built");
+    if (validateTube(tube, x, yFail, N_POINTS, &err) != 0) {
+        freeTube(tube);
+        CHECK(false, "validation failed");
+    }
+    const struct violation_summary summary = err.summary;
+    violations.n = 0;
+    tube_stream_t *stream = createTubeStream(tube, recordViolation, &violations);
+    int rv = 0;
+    for (size_t b = 0; b < N_POINTS && rv == 0; b += 1000)
+        rv = feedSamples(stream, x + b, yFail + b, (N_POINTS - b < 1000) ? N_POINTS - b : 1000);
+    bool same = rv == 0 && stream->nSamples == N_POINTS && stream->nViolations == summary.nViolations
+        && violations.n == summary.nViolations && sameValue(stream->maxError, summary.maxError)
+        && sameValue(stream->firstViolation, summary.firstViolation);
+    for (size_t i = 0, k = 0; i < err.diff.n && same; i++) {
+        if (err.diff.y[i] > 0) {
+            same = sameValue(violations.x[k], err.diff.x[i])
+                && sameValue(violations.error[k], err.diff.y[i]);
+            k++;
+        }
+    }
+    freeTubeStream(stream);
+
+    stream = createTubeStream(tube, stopOnFirstViolation, NULL);
+    rv = feedSamples(stream, x, yFail, N_POINTS);
+    bool stopped = rv == 1 && stream->nViolations == 1 && stream->nSamples == 3001
+        && sameValue(stream->firstViolation, summary.firstViolation)
+        && feedSample(stream, x[N_POINTS - 1], y[N_POINTS - 1]) == 1;
+    freeTubeStream(stream);
+    freeErrorReport(&err);
+    freeTube(tube);
+    CHECK(summary.nViolations == 10, "%zu violations", summary.nViolations);
+    CHECK(same, "stream errors differ from validateTube");
+    CHECK(stopped, "stream not stopped at the first violation");
+    return 0;
+}
+
+/* Comparison by windows within a memory budget, with output files identical to the in-memory comparison. */
+static int testOutOfCore(void) {
+    static const char *names[5] = {"reference", "test", "lowerBound", "upperBound", "errors"};
+    static const char *extensions[3] = {"csv", "bin", "bin"};
+    struct options options = {0};
+    char name[64];
+    for (int format = OUTPUT_CSV; format <= OUTPUT_BINARY_COMPRESSED; format++) {
+        for (int errorOutput = ERRORS_DENSE; errorOutput <= ERRORS_INTERVALS; errorOutput++) {
+            options.outputFormat = format;
+            options.errorOutput = errorOutput;
+            options.memoryBudget = 0;
+            CHECK(compareCurves(yFail, "results/in_memory", &options) == 0, "in-memory comparison failed");
+            options.memoryBudget = 1;
+            CHECK(compareCurves(yFail, "results/out_of_core", &options) == 0, "out-of-core comparison failed");
+            for (int k = 0; k < 5; k++) {
+                if (k == 4 && errorOutput == ERRORS_INTERVALS)
+                    snprintf(name, sizeof(name), "violations.csv");
+                else
+                    snprintf(name, sizeof(name), "%s.%s", names[k], extensions[format]);
+                CHECK(sameFile("results/in_memory", "results/out_of_core", name),
+                    "%s differs with format %d and error output %d", name, format, errorOutput);
+            }
+        }
+    }
+    return 0;
+}
+
+/* Out-of-core comparison with a tube too wide in x for the memory budget, and with a budget that fits it. */
+static int testOutOfCoreWideTube(void) {
+    struct options options = {0};
+    options.errorOutput = ERRORS_INTERVALS;
+    // The tube half-width in x of 0.4 spans 400 reference points: a window and its halos hold at least 6400 points.
+    options.memoryBudget = 1 << 20;
+    remove("results/wide_tube/violations.csv");
+    CHECK(compareAndReportWithOptions(xLarge, yLarge, N_LARGE, xLarge, yLargeFail, N_LARGE, "results/wide_tube",
+        0, 0.01, 0, 0, 0.001, 0, &options) == 1, "memory budget exceeded without error");
+    CHECK(fileContains("results/wide_tube", "c_funnel.log", "more than the 4096 points of the memory budget"),
+        "no error message in the log file");
+    CHECK(!fileExists("results/wide_tube", "violations.csv"), "output written beyond the memory budget");
+    options.memoryBudget = 1 << 23;
+    CHECK(compareAndReportWithOptions(xLarge, yLarge, N_LARGE, xLarge, yLargeFail, N_LARGE, "results/wide_tube",
+        0, 0.01, 0, 0, 0.001, 0, &options) == 0, "comparison failed within the memory budget");
+    CHECK(fileExists("results/wide_tube", "violations.csv"), "no output within the memory budget");
+    return 0;
+}
+
+/* Return true if the data has the expected x and y values. */
+static bool sameData(struct data dat, size_t n, const double *xExpected, const double *yExpected) {
+    return sameCurve(dat.n, dat.x, dat.y, n, xExpected, yExpected);
+}
+
+/* CSV reader: header, delimiters, line endings, white space and end of the data. */
+static int testReadCSV(void) {
+    static const struct {
+        const char *text;
+        int skipLines;
+    } cases[] = {
+        {"time,y\n0,1.5\n0.1,-2e-3\n2,3\n", 1},
+        {"0;1.5\n0.1;-2e-3\n2;3", 0},
+        {"time;y\r\n0;1.5\r\n0.1;-2e-3\r\n2;3\r\n", 1},
+        {"0, 1.5\n 0.1,\t-2e-3\n\n2,3\nend of data\n4,5\n", 0},
+    };
+    const double xExpected[3] = {0, 0.1, 2};
+    const double yExpected[3] = {1.5, -2e-3, 3};
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+        struct data dat = readCSV(writeText("read.csv", cases[k].text), cases[k].skipLines);
+        bool same = sameData(dat, 3, xExpected, yExpected);
+        free(dat.x);
+        free(dat.y);
+        CHECK(same, "wrong values for case %zu (%zu rows)", k, dat.n);
+    }
+    // Reading stops at the first row that does not hold two numbers, as with the fscanf format "%lf%*[,;]%lf\n".
+    struct data dat = readCSV(writeText("read.csv", "0,1.5,7\n0.1,-2e-3,8\n"), 0);
+    bool same = sameData(dat, 1, xExpected, yExpected);
+    free(dat.x);
+    free(dat.y);
+    CHECK(same, "wrong values for three columns (%zu rows)", dat.n);
+    dat = readCSV(writeText("read.csv", "0 ,1.5\n"), 0);
+    CHECK(dat.n == 0, "white space before the delimiter accepted");
+    free(dat.x);
+    free(dat.y);
+    dat = readCSV(writeText("read.csv", ""), 1);
+    CHECK(dat.n == 0 && dat.x == NULL, "values read from an empty file");
+    dat = readCSV("results/missing.csv", 1);
+    CHECK(dat.n == 0 && dat.x == NULL, "values read from a missing file");
+    return 0;
+}
+
+/* Multi-column CSV reader on several threads: columns selected by name and by index. */
+static int testReadCSVColumns(void) {
+    static const char *path = "results/columns.csv";
+    const size_t n = N_LARGE / 4;  // Several chunks of the file
+    const char *names[2] = {"b", "a"};
+    const int indices[2] = {3, 1};
+    struct data series[2];
+    FILE *f = fopen(path, "w");
+    CHECK(f != NULL, "cannot write %s", path);
+    fputs("\"time\", \"a\",\"b\";\"c\"\n", f);
+    for (size_t i = 0; i < n; i++)
+        fprintf(f, "%.17g,%.17g,%.17g;%.17g\n", xLarge[i], yLarge[i], -yLarge[i], 2 * yLarge[i]);
+    CHECK(fclose(f) == 0, "cannot write %s", path);
+    for (int nThreads = 1; nThreads <= 4; nThreads += 3) {
+        CHECK(readCSVColumns(path, 1, names, NULL, 2, nThreads, series) == 0, "columns not read by name");
+        bool same = series[0].n == n && series[1].n == n && series[0].x == series[1].x
+            && memcmp(series[0].x, xLarge, n * sizeof(double)) == 0
+            && memcmp(series[1].y, yLarge, n * sizeof(double)) == 0;
+        for (size_t i = 0; i < n && same; i++)
+            same = sameValue(series[0].y[i], -yLarge[i]);
+        freeCSVColumns(series, 2);
+        CHECK(same, "wrong values by name on %d threads", nThreads);
+        CHECK(readCSVColumns(path, 1, NULL, indices, 2, nThreads, series) == 0, "columns not read by index");
+        same = series[0].n == n && memcmp(series[1].y, yLarge, n * sizeof(double)) == 0;
+        for (size_t i = 0; i < n && same; i++)
+            same = sameValue(series[0].y[i], 2 * yLarge[i]);
+        freeCSVColumns(series, 2);
+        CHECK(same, "wrong values by index on %d threads", nThreads);
+    }
+    const char *missing[1] = {"d"};
+    CHECK(readCSVColumns(path, 1, missing, NULL, 1, 0, series) == -1, "missing column read");
+    CHECK(series[0].x == NULL && series[0].y == NULL, "series of a missing column not empty");
+    CHECK(readCSVColumns(writeText("short.csv", "x,a,b\n0,1,2\n1,2\n2,3,4\n"), 1, names, NULL, 2, 0, series) == -1,
+        "short row read");
+    return 0;
+}
+
+/* Gzip-compressed CSV files, read as the uncompressed files (if the library is built with zlib). */
+static int testReadGzip(void) {
+#if defined(FUNNEL_HAVE_ZLIB)
+    static const char *plain = "results/large.csv";
+    static const char *compressed = "results/large.csv.gz";
+    const size_t n = N_LARGE / 4;  // Several blocks of the streaming reader and chunks of readCSVColumns
+    const int indices[1] = {1};
+    struct data dat[2], series[2];
+    FILE *f = fopen(plain, "w");
+    gzFile gz = gzopen(compressed, "wb");
+    CHECK(f != NULL && gz != NULL, "cannot write the CSV files");
+    fputs("time,y\n", f);
+    gzputs(gz, "time,y\n");
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, "%.17g,%.17g\n", xLarge[i], yLarge[i]);
+        gzprintf(gz, "%.17g,%.17g\n", xLarge[i], yLarge[i]);
+    }
+    CHECK(fclose(f) == 0 && gzclose(gz) == Z_OK, "cannot write the CSV files");
+    dat[0] = readCSV(plain, 1);
+    dat[1] = readCSV(compressed, 1);
+    bool same = dat[0].n == n && sameCurve(dat[0].n, dat[0].x, dat[0].y, dat[1].n, dat[1].x, dat[1].y);
+    for (int k = 0; k < 2; k++) {
+        free(dat[k].x);
+        free(dat[k].y);
+    }
+    CHECK(same, "readCSV values of the compressed file differ");
+    CHECK(readCSVColumns(plain, 1, NULL, indices, 1, 4, &series[0]) == 0, "cannot read %s", plain);
+    if (readCSVColumns(compressed, 1, NULL, indices, 1, 4, &series[1]) != 0) {
+        freeCSVColumns(&series[0], 1);
+        CHECK(false, "cannot read %s", compressed);
+    }
+    same = series[0].n == n
+        && sameCurve(series[0].n, series[0].x, series[0].y, series[1].n, series[1].x, series[1].y);
+    freeCSVColumns(&series[0], 1);
+    freeCSVColumns(&series[1], 1);
+    CHECK(same, "readCSVColumns values of the compressed file differ");
+#else
+    fputs("Library built without zlib: gzip-compressed files not tested.\n", stderr);
+#endif
+    return 0;
+}
+
+/* Number of significant digits of a number written by formatDouble */
+static int countSignificantDigits(const char *number) {
+    const char *first = NULL, *last = NULL;
+    for (const char *c = number; *c != '\0' && *c != 'e'; c++) {
+        if (*c >= '1' && *c <= '9') {
+            first = (first == NULL) ? c : first;
+            last = c;
+        }
+    }
+    if (first == NULL)
+        return 1;
+    int n = 0;
+    for (const char *c = first; c <= last; c++)
+        n += (*c != '.');
+    return n;
+}
+
+/* Shortest round-trip formatting: known strings, and exact and shortest numbers for random bit patterns. */
+static int testFormatDouble(void) {
+    static const struct {
+        double value;
+        const char *text;
+    } cases[] = {
+        {0.0, "0"}, {-0.0, "-0"}, {0.1, "0.1"}, {-1.5, "-1.5"}, {123456, "123456"}, {1e-4, "0.0001"},
+        {1e-5, "1e-05"}, {1e16, "1e+16"}, {9007199254740992.0, "9007199254740992"}, {1e23, "1e+23"},
+        {5e-324, "5e-324"}, {DBL_MAX, "1.7976931348623157e+308"}, {DBL_MIN, "2.2250738585072014e-308"},
+        {1.0 / 3, "0.3333333333333333"}, {INFINITY, "inf"}, {-INFINITY, "-inf"}, {NAN, "nan"},
+    };
+    char buf[FORMAT_DOUBLE_MAX_LENGTH + 1], shorter[32];
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+        *formatDouble(buf, cases[k].value) = '\0';
+        CHECK(strcmp(buf, cases[k].text) == 0, "%s written instead of %s", buf, cases[k].text);
+    }
+    uint64_t state = 0x9E3779B97F4A7C15u;
+    for (int k = 0; k < 1000000; k++) {
+        // xorshift64 bit patterns, half of them with the exponent of the curves values
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint64_t bits = (k % 2 == 0) ? state : ((state & 0x800FFFFFFFFFFFFFu) | ((uint64_t)(1016 + k % 16) << 52));
+        double value, parsed;
+        memcpy(&value, &bits, sizeof(double));
+        if (isnan(value))
+            continue;
+        char *end = formatDouble(buf, value);
+        *end = '\0';
+        CHECK(end - buf <= FORMAT_DOUBLE_MAX_LENGTH, "%s too long", buf);
+        CHECK(parseDouble(buf, end, &parsed) == end && memcmp(&parsed, &value, sizeof(double)) == 0,
+            "%s not parsed back to %.17g", buf, value);
+        parsed = strtod(buf, NULL);
+        CHECK(memcmp(&parsed, &value, sizeof(double)) == 0, "%s not read back to %.17g by strtod", buf, value);
+        int digits = countSignificantDigits(buf);
+        if (digits > 1) {
+            snprintf(shorter, sizeof(shorter), "%.*e", digits - 2, value);
+            CHECK(!sameValue(strtod(shorter, NULL), value), "%s is shorter than %s", shorter, buf);
+        }
+    }
+    return 0;
+}
+
+/* Output files written on writer threads, identical to the files written on the calling thread. */
+static int testWriterThreads(void) {
+    static const char *names[5] = {"reference", "test", "lowerBound", "upperBound", "errors"};
+    static const char *extensions[2] = {"csv", "bin"};
+    const size_t n = N_LARGE / 8;  // Large enough for writer threads
+    struct options options = {0};
+    char name[64];
+    for (int format = OUTPUT_CSV; format <= OUTPUT_BINARY; format++) {
+        options.outputFormat = format;
+        options.nThreads = 1;
+        CHECK(compareAndReportWithOptions(xLarge, yLarge, n, xLarge, yLargeFail, n, "results/one_thread",
+            0.01, 0.01, 0, 0, 0, 0, &options) == 0, "comparison on one thread failed");
+        options.nThreads = 4;
+        CHECK(compareAndReportWithOptions(xLarge, yLarge, n, xLarge, yLargeFail, n, "results/writer_threads",
+            0.01, 0.01, 0, 0, 0, 0, &options) == 0, "comparison with writer threads failed");
+        for (int k = 0; k < 5; k++) {
+            snprintf(name, sizeof(name), "%s.%s", names[k], extensions[format]);
+            CHECK(sameFile("results/one_thread", "results/writer_threads", name), "%s differs", name);
+        }
+    }
+    // A file that cannot be written is an error, reported after all writer threads are joined.
+    CHECK(mkdir_p("results/unwritable/lowerBound.csv") == 0, "cannot create directory");
+    options.outputFormat = OUTPUT_CSV;
+    CHECK(compareAndReportWithOptions(xLarge, yLarge, n, xLarge, yLargeFail, n, "results/unwritable",
+        0.01, 0.01, 0, 0, 0, 0, &options) == -1, "no error for a file that cannot be written");
+    CHECK(getLiveAllocationCount() == 0, "memory not freed after a write error");
+    return 0;
+}
+
+/* Violation intervals: file of the intervals of consecutive test points out of the tube of the dense errors. */
+static int testIntervals(void) {
+    static double yTest[N_POINTS];
+    static char expected[64 * N_POINTS];
+    struct options options = {0};
+    struct comparison_result result;
+    for (size_t i = 0; i < N_POINTS; i++) {
+        bool out = i < 3 || (i >= 1000 && i < 1005) || (i >= 3000 && i < 3010) || i == N_POINTS - 1;
+        yTest[i] = y[i] + (out ? 0.2 + 1e-4 * (double)(i % 7) : 0.0);
+    }
+    CHECK(compareAndReturn(x, y, N_POINTS, x, yTest, N_POINTS, 0.01, 0.01, 0, 0, 0, 0, NULL, &result) == 0,
+        "compareAndReturn failed");
+    // Intervals of the dense errors, with the first largest error of each interval
+    char *p = expected + sprintf(expected, "xStart,xEnd,peak,xPeak\n");
+    size_t nIntervals = 0;
+    const struct data diff = result.errors.diff;
+    for (size_t i = 0; i < diff.n; i++) {
+        if (!(diff.y[i] > 0))
+            continue;
+        size_t e = i, iPeak = i;
+        for (; e + 1 < diff.n && diff.y[e + 1] > 0; e++) {
+            if (diff.y[e + 1] > diff.y[iPeak])
+                iPeak = e + 1;
+        }
+        p = formatDouble(p, diff.x[i]);
+        *p++ = ',';
+        p = formatDouble(p, diff.x[e]);
+        *p++ = ',';
+        p = formatDouble(p, diff.y[iPeak]);
+        *p++ = ',';
+        p = formatDouble(p, diff.x[iPeak]);
+        *p++ = '\n';
+        nIntervals++;
+        i = e;
+    }
+    *p = '\0';
+    freeComparisonResult(&result);
+    CHECK(nIntervals == 4, "%zu intervals", nIntervals);
+
+    options.errorOutput = ERRORS_INTERVALS;
+    CHECK(compareCurves(yTest, "results/intervals", &options) == 0, "comparison failed");
+    CHECK(fileEquals("results/intervals", "violations.csv", expected), "wrong violations.csv");
+    CHECK(!fileExists("results/intervals", "errors.csv"), "errors.csv written");
+    CHECK(compareCurves(y, "results/intervals_pass", &options) == 0, "comparison failed");
+    CHECK(fileEquals("results/intervals_pass", "violations.csv", "xStart,xEnd,peak,xPeak\n"), "not only the header");
+    return 0;
+}
+
+/* Gate mode, in memory and by windows: the report of a failed test is the report without gate. */
+static int testGate(void) {
+    static const char *files[5] = {"reference.csv", "test.csv", "lowerBound.csv", "upperBound.csv", "errors.csv"};
+    struct options options = {0};
+    CHECK(compareCurves(yFail, "results/gate_report", &options) == 0, "comparison failed");
+    options.gate = 1;
+    for (size_t budget = 0; budget < 2; budget++) {
+        options.memoryBudget = budget;
+        CHECK(compareCurves(y, "results/gate_pass", &options) == 0, "gate failed a passing test");
+        CHECK(fileExists("results/gate_pass", "c_funnel.log"), "no log file");
+        CHECK(!fileExists("results/gate_pass", "errors.csv"), "report written for a passing test");
+        CHECK(compareCurves(yFail, "results/gate_fail", &options) == GATE_FAILED, "gate passed a failing test");
+        CHECK(fileContains("results/gate_fail", "c_funnel.log", "Test failed: first test point out of the tube"),
+            "failure not logged with memory budget %zu", budget);
+        for (int k = 0; k < 5; k++)
+            CHECK(sameFile("results/gate_fail", "results/gate_report", files[k]),
+                "%s differs with memory budget %zu", files[k], budget);
+    }
+    return 0;
+}
+
+/* Return true if the summaries are equal, with a relative tolerance on the integral (summed in another order). */
+static bool sameSummary(const struct violation_summary *a, const struct violation_summary *b, double rtol) {
+    bool same = a->nViolations == b->nViolations && sameValue(a->maxError, b->maxError)
+        && (sameValue(a->xMaxError, b->xMaxError) || (isnan(a->xMaxError) && isnan(b->xMaxError)))
+        && (sameValue(a->firstViolation, b->firstViolation) || (isnan(a->firstViolation) && isnan(b->firstViolation)))
+        && fabs(a->integral - b->integral) <= rtol * fabs(b->integral) && a->nTop == b->nTop;
+    for (size_t k = 0; k < a->nTop && same; k++)
+        same = sameValue(a->topX[k], b->topX[k]) && sameValue(a->topError[k], b->topError[k]);
+    return same;
+}
+
+/* Summary metrics computed in the validation pass, with the metrics of the dense errors. */
+static int testSummary(void) {
+    static double yTest[N_LARGE];
+    struct options options = {0};
+    struct comparison_result result;
+    struct violation_summary expected;
+    for (size_t i = 0; i < N_LARGE; i++)
+        yTest[i] = yLarge[i] + ((i % 25000 < 20) ? 0.3 + 1e-3 * (double)(i % 17) : 0.0);
+    options.nThreads = 1;
+    CHECK(compareAndReturn(xLarge, yLarge, N_LARGE, xLarge, yTest, N_LARGE, 0.01, 0.01, 0, 0, 0, 0, &options,
+        &result) == 0, "compareAndReturn failed");
+
+    // Metrics of the dense errors
+    const struct data diff = result.errors.diff;
+    initSummary(&expected);
+    for (size_t i = 0; i < diff.n; i++) {
+        if (i > 0)
+            expected.integral += 0.5 * (diff.y[i-1] + diff.y[i]) * (diff.x[i] - diff.x[i-1]);
+        if (!(diff.y[i] > 0))
+            continue;
+        if (expected.nViolations++ == 0)
+            expected.firstViolation = diff.x[i];
+        if (diff.y[i] > expected.maxError) {
+            expected.maxError = diff.y[i];
+            expected.xMaxError = diff.x[i];
+        }
+        // Insert in the worst points, by decreasing error and increasing x
+        size_t k = expected.nTop;
+        for (; k > 0 && diff.y[i] > expected.topError[k-1]; k--) {
+            if (k < SUMMARY_TOP_K) {
+                expected.topX[k] = expected.topX[k-1];
+                expected.topError[k] = expected.topError[k-1];
+            }
+        }
+        if (k < SUMMARY_TOP_K) {
+            expected.topX[k] = diff.x[i];
+            expected.topError[k] = diff.y[i];
+            expected.nTop += (expected.nTop < SUMMARY_TOP_K);
+        }
+    }
+    bool same = sameSummary(&result.errors.summary, &expected, 0);
+    freeComparisonResult(&result);
+    CHECK(expected.nViolations == 16 * 20 + 1 && expected.nTop == SUMMARY_TOP_K, "%zu violations", expected.nViolations);
+    CHECK(same, "summary on one thread differs from the dense errors");
+
+    // Same metrics on several threads, with violation intervals only, and by windows
+    for (int k = 0; k < 3; k++) {
+        options.nThreads = 4;
+        options.errorOutput = (k == 1) ? ERRORS_INTERVALS : ERRORS_DENSE;
+        CHECK(compareAndReturn(xLarge, yLarge, N_LARGE, xLarge, yTest, N_LARGE, 0.01, 0.01, 0, 0, 0, 0, &options,
+            &result) == 0, "compareAndReturn failed");
+        same = sameSummary(&result.errors.summary, &expected, 1e-12);
+        freeComparisonResult(&result);
+        CHECK(same, "summary differs on 4 threads with error output %d", options.errorOutput);
+    }
+    struct comparison_job job = {xLarge, yLarge, N_LARGE, xLarge, yTest, N_LARGE, "results/summary",
+        {0.01, 0.01, 0, 0, 0, 0}, &options, -1, {0}};
+    options.memoryBudget = 1 << 20;
+    options.skipInputs = 1;
+    CHECK(compareAndReportBatch(&job, 1, 1) == 0, "batch failed");
+    CHECK(sameSummary(&job.summary, &expected, 1e-12), "summary differs by windows");
+    return 0;
+}
+
+/* Comparison run on its own thread with its own context */
+struct context_job {
+    context_t *ctx;
+    const double *yTest;
+    size_t n;
+    const char *outputDirectory;
+    int status;
+};
+
+static void runContextJob(void *arg) {
+    struct context_job *job = arg;
+    job->status = compareInContext(job->ctx, xLarge, yLarge, job->n, xLarge, job->yTest, job->n,
+        job->outputDirectory, 0.01, 0.01, 0, 0, 0, 0);
+}
+
+/* Messages received by a context without log file */
+struct context_messages {
+    size_t n;
+    char last[CONTEXT_ERROR_SIZE];
+};
+
+static void recordMessage(void *userData, const char *message) {
+    struct context_messages *m = userData;
+    m->n++;
+    snprintf(m->last, sizeof(m->last), "%s", message);
+}
+
+/* Comparison contexts: concurrent comparisons, errors returned to the caller (also by the file readers),
+   and reused scratch memory. */
+static int testContexts(void) {
+    static const char *names[5] = {"reference.csv", "test.csv", "lowerBound.csv", "upperBound.csv", "errors.csv"};
+    static const char *dirs[4] = {"results/context_0", "results/context_1", "results/context_2", "results/context_3"};
+    const size_t sizes[4] = {N_LARGE / 8, N_LARGE / 64, N_LARGE / 4, N_LARGE / 64};
+    struct options options = {0};
+    struct context_job jobs[4];
+    struct thread threads[4];
+    char reference[64];
+    options.nThreads = 1;
+
+    // Concurrent comparisons with their own contexts, and the same comparisons run one after the other.
+    for (int k = 0; k < 4; k++) {
+        jobs[k] = (struct context_job){createContext(&options), (k % 2) ? yLarge : yLargeFail, sizes[k], dirs[k], -1};
+        CHECK(jobs[k].ctx != NULL, "context not created");
+        CHECK(startThread(&threads[k], runContextJob, &jobs[k]) == 0, "thread not started");
+    }
+    for (int k = 0; k < 4; k++)
+        joinThread(&threads[k]);
+    context_t *ctx = createContext(&options);
+    CHECK(ctx != NULL, "context not created");
+    for (int k = 0; k < 4; k++) {
+        CHECK(jobs[k].status == 0, "status %d of concurrent comparison %d", jobs[k].status, k);
+        freeContext(jobs[k].ctx);
+        // One context reused with growing and shrinking inputs
+        snprintf(reference, sizeof(reference), "results/context_sequential");
+        jobs[k].ctx = ctx;
+        jobs[k].outputDirectory = reference;
+        runContextJob(&jobs[k]);
+        CHECK(jobs[k].status == 0, "status %d of sequential comparison %d", jobs[k].status, k);
+        for (int f = 0; f < 5; f++)
+            CHECK(sameFile(dirs[k], reference, names[f]), "%s of comparison %d differs", names[f], k);
+    }
+
+    // Errors are returned with the message of the context, and messages without log file go to the callback.
+    struct context_messages messages = {0, ""};
+    struct comparison_result result;
+    setMessageCallback(ctx, recordMessage, &messages);
+    CHECK(compareAndReturnInContext(ctx, x, y, N_POINTS, x, y, N_POINTS / 2, 0.01, 0.01, 0, 0, 0, 0, &result) != 0,
+        "no error for different x ranges");
+    CHECK(strstr(getContextError(ctx), "maximum x values are different") != NULL, "error message: %s",
+        getContextError(ctx));
+    CHECK(messages.n > 0 && strstr(messages.last, "maximum x values are different") != NULL, "message not received");
+    CHECK(compareAndReturnInContext(ctx, x, y, N_POINTS, x, yFail, N_POINTS, 0.01, 0.01, 0, 0, 0, 0, &result) == 0,
+        "comparison failed after an error");
+    CHECK(getContextError(ctx)[0] == '\0', "error message not cleared: %s", getContextError(ctx));
+    freeComparisonResult(&result);
+
+    // Errors of the file readers go to the context as well.
+    const char *missing[1] = {"d"};
+    struct data series[1];
+    messages.n = 0;
+    CHECK(readCSVColumnsInContext(ctx, writeText("context.csv", "x,a\n0,1\n"), 1, missing, NULL, 1, 0, series) == -1,
+        "missing column read");
+    CHECK(messages.n == 1 && strstr(getContextError(ctx), "Column d not found") != NULL, "CSV reader error: %s",
+        getContextError(ctx));
+    messages.n = 0;
+    CHECK(readMatFileInContext(ctx, "results/missing.mat", missing, 1, series) == -1, "missing file read");
+    CHECK(messages.n == 1 && strstr(getContextError(ctx), "Cannot open file") != NULL, "MATLAB reader error: %s",
+        getContextError(ctx));
+    freeContext(ctx);
+    CHECK(getLiveAllocationCount() == 0, "memory not freed with the contexts");
+    return 0;
+}
+
+struct test_case {
+    const char *name;
+    int (*run)(void);
+};
+
+static const struct test_case tests[] = {
+    {"threaded tube", testThreadedTube},
+    {"engines", testEngines},
+    {"parallel validation", testValidateParallel},
+    {"batch", testBatch},
+    {"tube handle", testTubeHandle},
+    {"tube cache", testTubeCache},
+    {"stream", testStream},
+    {"out of core", testOutOfCore},
+    {"out of core wide tube", testOutOfCoreWideTube},
+    {"read CSV", testReadCSV},
+    {"read CSV columns", testReadCSVColumns},
+    {"read gzip", testReadGzip},
+    {"format double", testFormatDouble},
+    {"writer threads", testWriterThreads},
+    {"violation intervals", testIntervals},
+    {"gate", testGate},
+    {"summary", testSummary},
+    {"contexts", testContexts},
+};
+
+int main(void) {
+    int nFailed = 0;
+    initCurves();
+    if (mkdir_p("results") != 0) {
+        fputs("Cannot create results directory\n", stderr);
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        int failed = tests[i].run();
+        printf("%s: %s\n", tests[i].name, failed ? "FAILED" : "passed");
+        nFailed += failed;
+    }
+    return nFailed;
+}
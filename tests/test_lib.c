@@ -32,8 +32,11 @@ int main(void) {
             const double,
             const double
     );
+    typedef size_t (*_count_func)(void);
     _read_csv read_csv;
     _compare_func compare_func;
+    _count_func live_count;
+    _count_func allocation_count;
 
     #if defined(_WIN32)     /* Win32 or Win64              */
 
@@ -56,6 +59,13 @@ int main(void) {
         fprintf(stderr, "GetProcAddress failed with message: %d\n", GetLastError());
         return 1;
     }
+    live_count = (_count_func)GetProcAddress(handle, "getLiveAllocationCount");
+    allocation_count = (_count_func)GetProcAddress(handle, "getAllocationCount");
+    if (live_count == NULL || allocation_count == NULL)
+    {
+        fprintf(stderr, "GetProcAddress failed with message: %d\n", GetLastError());
+        return 1;
+    }
 
     #else                   /* Mac or Linux                */
 
@@ -82,32 +92,59 @@ int main(void) {
         fputs(error, stderr);
         exit(1);
     }
+    *(void **) (&live_count) = dlsym(handle, "getLiveAllocationCount");
+    *(void **) (&allocation_count) = dlsym(handle, "getAllocationCount");
+    if ((error = dlerror()) != NULL)  {
+        fputs(error, stderr);
+        exit(1);
+    }
 
     #endif      /* Mac or Linux                */
 
     struct data baseCSV = read_csv("trended.csv", 1);
     struct data testCSV = read_csv("simulated.csv", 1);
 
-    int exiVal = compare_func(
-        baseCSV.x,
-        baseCSV.y,
-        baseCSV.n,
-        testCSV.x,
-        testCSV.y,
-        testCSV.n,
-        "results",
-        0.002,
-        0.002,
-        0.0,
-        0.0,
-        0.0,
-        0.0
-    );
+    /* The comparison is run twice: it must free all the memory it allocates,
+       and allocate the same number of blocks each time. */
+    size_t nAllocations[2];
+    for (int i = 0; i < 2; i++) {
+        size_t first = allocation_count();
+        int exiVal = compare_func(
+            baseCSV.x,
+            baseCSV.y,
+            baseCSV.n,
+            testCSV.x,
+            testCSV.y,
+            testCSV.n,
+            "results",
+            0.002,
+            0.002,
+            0.0,
+            0.0,
+            0.0,
+            0.0
+        );
 
-    if (exiVal != 0)  {
-        fprintf(stderr, "Return code from compareAndReport: %i\n", exiVal);
-        return exiVal;
+        if (exiVal != 0)  {
+            fprintf(stderr, "Return code from compareAndReport: %i\n", exiVal);
+            return exiVal;
+        }
+        if (live_count() != 0)  {
+            fprintf(stderr, "Memory not freed by compareAndReport: %zu blocks\n", live_count());
+            return 1;
+        }
+        nAllocations[i] = allocation_count() - first;
     }
+    if (nAllocations[0] != nAllocations[1])  {
+        fprintf(stderr, "Number of allocations differs between runs: %zu and %zu\n",
+            nAllocations[0], nAllocations[1]);
+        return 1;
+    }
+
+    free(baseCSV.x);
+    free(baseCSV.y);
+    free(testCSV.x);
+    free(testCSV.y);
 
     #if defined(_WIN32)     /* Win32 or Win64              */
     FreeLibrary(handle);
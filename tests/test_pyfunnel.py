@@ -0,0 +1,435 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""Unit tests of the pyfunnel API and command line interface.
+
+Run from any directory with `python test_pyfunnel.py`: the input files are
+read from tests/test_bin and the output is written to temporary directories.
+"""
+import array
+import ctypes
+import gzip
+import struct
+import tempfile
+import unittest
+
+from test_import import *
+from pyfunnel.core import _as_c_array
+
+test_bin = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'test_bin')
+cli = os.path.join(pyfunnel_dir, 'pyfunnel', 'cli.py')
+# The command line interface must import the current development version as well.
+cli_env = dict(os.environ, PYTHONPATH=os.pathsep.join([pyfunnel_dir, os.environ.get('PYTHONPATH', '')]))
+
+
+def read_two_columns(file_name):
+    tmp = pd.read_csv(os.path.join(test_bin, file_name))
+
+    return tmp.iloc(axis=1)[0].to_numpy(), tmp.iloc(axis=1)[1].to_numpy()
+
+
+class TestReadCSV(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.x, self.y = read_two_columns('trended.csv')
+        # Wide file with the compared variable in between two other columns.
+        self.wide = os.path.join(self.tmp_dir, 'wide.csv')
+        pd.DataFrame({'time': self.x, 'a': 2 * self.y, 'Trended': self.y, 'b': -self.y}).to_csv(
+            self.wide, index=False, float_format='%.17g')
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir)
+
+    def test_columns_by_name(self):
+        x, y = pyfunnel.read_csv(self.wide, ['Trended', 'b'])
+        np.testing.assert_array_equal(x, self.x)
+        np.testing.assert_array_equal(y['Trended'], self.y)
+        np.testing.assert_array_equal(y['b'], -self.y)
+
+    def test_columns_by_index(self):
+        x, y = pyfunnel.read_csv(self.wide, [2, 1])
+        np.testing.assert_array_equal(x, self.x)
+        np.testing.assert_array_equal(y[2], self.y)
+        np.testing.assert_array_equal(y[1], 2 * self.y)
+
+    def test_unknown_column(self):
+        with self.assertRaises(IOError):
+            pyfunnel.read_csv(self.wide, ['missing'])
+
+    def test_cli_variable(self):
+        out_wide = os.path.join(self.tmp_dir, 'wide_results')
+        out_two = os.path.join(self.tmp_dir, 'two_results')
+        test = os.path.join(test_bin, 'simulated.csv')
+        test_wide = os.path.join(self.tmp_dir, 'test_wide.csv')
+        x, y = read_two_columns('simulated.csv')
+        pd.DataFrame({'time': x, 'Trended': y, 'c': y}).to_csv(test_wide, index=False, float_format='%.17g')
+        tol = ['--atolx', '0.002', '--atoly', '0.002']
+        subprocess.check_call([sys.executable, cli, '--reference', self.wide, '--test', test_wide,
+                               '--variable', 'Trended', '--output', out_wide] + tol, cwd=self.tmp_dir, env=cli_env)
+        subprocess.check_call([sys.executable, cli, '--reference', os.path.join(test_bin, 'trended.csv'),
+                               '--test', test, '--output', out_two] + tol, cwd=self.tmp_dir, env=cli_env)
+        for f in ['errors.csv', 'lowerBound.csv', 'upperBound.csv']:
+            with open(os.path.join(out_wide, f), 'rb') as f_wide, open(os.path.join(out_two, f), 'rb') as f_two:
+                self.assertEqual(f_wide.read(), f_two.read(), f)
+
+
+class TestInputs(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.x = np.linspace(0, 10, 1001)
+        self.y = np.sin(self.x)
+        self.yTest = self.y + np.where(np.arange(1001) % 200 < 3, 0.1, 0)
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir)
+
+    def test_zero_copy(self):
+        # Contiguous float64 arrays and writable buffers of doubles are passed as is.
+        memmap = np.memmap(os.path.join(self.tmp_dir, 'x.dat'), dtype=np.float64, mode='w+', shape=(1001,))
+        buf = array.array('d', self.x)
+        for values, address in ((self.x, self.x.ctypes.data), (memmap, memmap.ctypes.data),
+                                (buf, buf.buffer_info()[0])):
+            pointer, _, n = _as_c_array(values)
+            self.assertEqual(ctypes.cast(pointer, ctypes.c_void_p).value, address)
+            self.assertEqual(n, 1001)
+        del memmap
+        with self.assertRaises(TypeError):
+            _as_c_array([0.0, 'a'])
+
+    def test_same_results(self):
+        memmap = np.memmap(os.path.join(self.tmp_dir, 'y.dat'), dtype=np.float64, mode='w+', shape=(1001,))
+        memmap[:] = self.yTest
+        strided = np.repeat(self.yTest, 2)[::2]
+        inputs = {
+            'array': self.yTest,
+            'list': list(self.yTest),
+            'series': pd.Series(self.yTest),
+            'buffer': array.array('d', self.yTest),
+            'memmap': memmap,
+            'strided': strided,
+        }
+        for name, yTest in inputs.items():
+            self.assertEqual(pyfunnel.compareAndReport(
+                list(self.x), self.y, self.x, yTest, outputDirectory=os.path.join(self.tmp_dir, name),
+                atolx=0.01, atoly=0.01), 0)
+        del memmap
+        for name in inputs:
+            for f in ['errors.csv', 'lowerBound.csv', 'upperBound.csv', 'test.csv']:
+                with open(os.path.join(self.tmp_dir, 'array', f), 'rb') as f_1, \
+                        open(os.path.join(self.tmp_dir, name, f), 'rb') as f_2:
+                    self.assertEqual(f_1.read(), f_2.read(), '{} with {} inputs'.format(f, name))
+
+
+class TestCompareAndReturn(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.x = np.linspace(0, 10, 1001)
+        self.y = np.sin(self.x)
+        self.yTest = self.y + np.where(np.arange(1001) % 200 < 3, 0.1, 0)
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir)
+
+    def test_same_as_files(self):
+        report = os.path.join(self.tmp_dir, 'report')
+        returned = os.path.join(self.tmp_dir, 'returned')
+        self.assertEqual(pyfunnel.compareAndReport(self.x, self.y, self.x, self.yTest, outputDirectory=report,
+                                                   atolx=0.01, atoly=0.01), 0)
+        res = pyfunnel.compareAndReturn(self.x, self.y, self.x, self.yTest, outputDirectory=returned,
+                                        atolx=0.01, atoly=0.01)
+        for key in ['lowerBound', 'upperBound', 'errors']:
+            # The files are written with the shortest representation that is read back exactly.
+            values = np.loadtxt(os.path.join(report, key + '.csv'), delimiter=',', skiprows=1)
+            np.testing.assert_array_equal(res[key][0], values[:, 0], key)
+            np.testing.assert_array_equal(res[key][1], values[:, 1], key)
+            with open(os.path.join(report, key + '.csv'), 'rb') as f_1, \
+                    open(os.path.join(returned, key + '.csv'), 'rb') as f_2:
+                self.assertEqual(f_1.read(), f_2.read(), key)
+        out = res['errors'][1] > 0
+        np.testing.assert_array_equal(res['violations'][0], self.x[out])
+        self.assertEqual(res['summary']['nViolations'], np.count_nonzero(out))
+        self.assertEqual(res['summary']['firstViolation'], self.x[out][0])
+        self.assertEqual(res['summary']['maxError'], res['errors'][1].max())
+
+    def test_intervals(self):
+        report = os.path.join(self.tmp_dir, 'report')
+        self.assertEqual(pyfunnel.compareAndReport(self.x, self.y, self.x, self.yTest, outputDirectory=report,
+                                                   atolx=0.01, atoly=0.01, errorOutput='intervals'), 0)
+        res = pyfunnel.compareAndReturn(self.x, self.y, self.x, self.yTest, atolx=0.01, atoly=0.01,
+                                        errorOutput='intervals')
+        values = np.loadtxt(os.path.join(report, 'violations.csv'), delimiter=',', skiprows=1, ndmin=2)
+        self.assertEqual(values.shape, (6, 4))
+        np.testing.assert_array_equal(res['intervals'], values)
+        self.assertEqual(res['errors'][0].size, 0)
+
+    def test_error(self):
+        with self.assertRaises(RuntimeError):
+            pyfunnel.compareAndReturn(self.x, self.y, self.x[:500], self.yTest[:500], atolx=0.01, atoly=0.01)
+
+
+class TestEngines(unittest.TestCase):
+
+    def test_same_errors(self):
+        # Test cases with a constant tube half-width in x, and reference and test with the same x range.
+        tests_dir = os.path.join(pyfunnel_dir, 'tests')
+        n_cases = 0
+        for name in sorted(os.listdir(tests_dir)):
+            param_file = os.path.join(tests_dir, name, 'param.json')
+            if not os.path.isfile(param_file):
+                continue
+            with open(param_file) as f:
+                param = json.load(f)
+            if param.get('ltolx') or name in ('fail2', 'fail6'):
+                continue
+            ref = pd.read_csv(os.path.join(tests_dir, name, param['reference']))
+            test = pd.read_csv(os.path.join(tests_dir, name, param['test']))
+            tol = {k: param.get(k) for k in ('atolx', 'atoly', 'ltolx', 'ltoly', 'rtolx', 'rtoly')}
+            res = [pyfunnel.compareAndReturn(ref.iloc[:, 0], ref.iloc[:, 1], test.iloc[:, 0], test.iloc[:, 1],
+                                             engine=engine, **tol) for engine in ('rectangle', 'window')]
+            scale = max(1, np.abs(ref.iloc[:, 1]).max())
+            np.testing.assert_array_equal(res[0]['errors'][0], res[1]['errors'][0], name)
+            np.testing.assert_allclose(res[0]['errors'][1], res[1]['errors'][1], rtol=0, atol=1e-9 * scale,
+                                       err_msg=name)
+            self.assertEqual(res[0]['intervals'].shape, res[1]['intervals'].shape, name)
+            n_cases += 1
+        self.assertGreater(n_cases, 10)
+
+    def test_variable_tube_width(self):
+        x = np.linspace(1, 10, 101)
+        with self.assertRaises(RuntimeError):
+            pyfunnel.compareAndReturn(x, np.sin(x), x, np.sin(x), ltolx=0.01, atoly=0.01, engine='window')
+
+
+def write_mat_matrix(f, name, values, precision, text=False, big_endian=False):
+    """Write a matrix to a MATLAB v4 file (precision 0: float64, 1: float32, 2: int32, 5: uint8)."""
+    values = np.asarray(values)
+    e = '>' if big_endian else '<'
+    f.write(struct.pack(e + '5i', 1000 * big_endian + 10 * precision + text, values.shape[0], values.shape[1], 0,
+                        len(name) + 1))
+    f.write(name.encode() + b'\0')
+    dtype = {0: 'f8', 1: 'f4', 2: 'i4', 5: 'u1'}[precision]
+    f.write(np.asarray(values, dtype=e + dtype).flatten(order='F').tobytes())
+
+
+def write_mat_result(file_name, t, a, b, transposed, precision, big_endian=False):
+    """Write a Modelica result file with the trajectories a and b, the parameter p = 2.5 and aliases."""
+    def strings(s, transposed):
+        width = max(len(v) for v in s)
+        m = np.array([[ord(c) for c in v.ljust(width)] for v in s])
+        return m.T if transposed else m
+    names = ['Time', 'a', 'b', 'minus_a', 'p', 'minus_p', 'time_alias', 'a.x[1]']
+    # dataInfo: matrix (1: data_1, 2: data_2, 0: time) and signed column of each variable
+    info = np.array([[0, 1, 0, -1], [2, 2, 0, -1], [2, 3, 0, -1], [2, -2, 0, -1], [1, 2, 0, 0], [1, -2, 0, 0],
+                     [0, 1, 0, -1], [2, 3, 0, -1]])
+    data_1 = np.array([[t[0], 2.5], [t[-1], 2.5]])
+    data_2 = np.column_stack([t, a, b])
+    with open(file_name, 'wb') as f:
+        aclass = ['Atrajectory', '1.1', '', 'binTrans' if transposed else 'binNormal']
+        write_mat_matrix(f, 'Aclass', strings(aclass, False), 5, True, big_endian)
+        write_mat_matrix(f, 'name', strings(names, transposed), 5, True, big_endian)
+        write_mat_matrix(f, 'description', strings([''] * len(names), transposed), 5, True, big_endian)
+        for name, m, p in (('dataInfo', info, 2), ('data_1', data_1, precision), ('data_2', data_2, precision)):
+            write_mat_matrix(f, name, m.T if transposed else m, p, False, big_endian)
+
+
+class TestReadMat(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.t = np.linspace(0, 10, 1001)
+        self.a = np.sin(self.t)
+        self.b = 3 * np.cos(self.t)
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir)
+
+    def test_formats(self):
+        names = ['a', 'b', 'minus_a', 'p', 'minus_p', 'time_alias', 'a.x[1]']
+        for transposed, precision, big_endian in ((0, 0, 0), (1, 0, 0), (0, 1, 0), (1, 1, 0), (1, 0, 1)):
+            file_name = os.path.join(self.tmp_dir, 'result.mat')
+            write_mat_result(file_name, self.t, self.a, self.b, transposed, precision, big_endian)
+            cast = np.float32 if precision == 1 else np.float64
+            t, a, b = (v.astype(cast).astype(np.float64) for v in (self.t, self.a, self.b))
+            x, y = pyfunnel.read_mat(file_name, names)
+            msg = 'transposed {}, precision {}, big-endian {}'.format(transposed, precision, big_endian)
+            np.testing.assert_array_equal(x, t, msg)
+            for name, expected in (('a', a), ('b', b), ('minus_a', -a), ('p', np.full(t.size, 2.5)),
+                                   ('minus_p', np.full(t.size, -2.5)), ('time_alias', t), ('a.x[1]', b)):
+                np.testing.assert_array_equal(y[name], expected, '{} with {}'.format(name, msg))
+
+    def test_errors(self):
+        file_name = os.path.join(self.tmp_dir, 'result.mat')
+        write_mat_result(file_name, self.t, self.a, self.b, 1, 0)
+        with self.assertRaisesRegex(IOError, 'Variable missing not found'):
+            pyfunnel.read_mat(file_name, ['missing'])
+        with open(file_name, 'wb') as f:
+            f.write(b'not a result file')
+        with self.assertRaisesRegex(IOError, 'is not a MATLAB v4 file'):
+            pyfunnel.read_mat(file_name, ['a'])
+
+    def test_cli(self):
+        reference = os.path.join(self.tmp_dir, 'reference.mat')
+        test = os.path.join(self.tmp_dir, 'test.mat')
+        write_mat_result(reference, self.t, self.a, self.b, 1, 0)
+        write_mat_result(test, self.t, self.a, self.b + 0.1, 0, 0)
+        rc = subprocess.call([sys.executable, cli, '--reference', reference, '--test', test, '--variable', 'a.x[1]',
+                              '--atolx', '0.01', '--atoly', '0.01', '--output', 'results'], cwd=self.tmp_dir, env=cli_env)
+        self.assertEqual(rc, 0)
+        errors = np.loadtxt(os.path.join(self.tmp_dir, 'results', 'errors.csv'), delimiter=',', skiprows=1)
+        np.testing.assert_array_equal(errors[:, 0], self.t)
+        self.assertTrue(np.all(errors[:, 1] > 0))
+
+
+class TestBinaryOutput(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        rng = np.random.default_rng(1)
+        # Unevenly spaced x values, and evenly spaced x values (compressed to 1 or 2 bytes each)
+        self.inputs = {
+            'uneven': np.cumsum(rng.uniform(1e-3, 1, 2000)) - 50,
+            'even': np.linspace(0, 100, 2001),
+        }
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir)
+
+    def test_read_binary(self):
+        for key, x in self.inputs.items():
+            y = np.sin(x / 10)
+            yTest = y + np.where(np.arange(x.size) % 500 < 5, 0.5, 0)
+            outputs = {}
+            for outputFormat in ('csv', 'binary', 'binary-compressed'):
+                outputs[outputFormat] = os.path.join(self.tmp_dir, key, outputFormat)
+                self.assertEqual(pyfunnel.compareAndReport(x, y, x, yTest, outputDirectory=outputs[outputFormat],
+                                                           atolx=0.5, atoly=0.05, outputFormat=outputFormat), 0)
+            for f in ['reference', 'test', 'lowerBound', 'upperBound', 'errors']:
+                values = np.loadtxt(os.path.join(outputs['csv'], f + '.csv'), delimiter=',', skiprows=1)
+                for outputFormat in ('binary', 'binary-compressed'):
+                    xb, yb = pyfunnel.read_binary(os.path.join(outputs[outputFormat], f + '.bin'))
+                    msg = '{} with {} x values and {} format'.format(f, key, outputFormat)
+                    np.testing.assert_array_equal(xb, values[:, 0], msg)
+                    np.testing.assert_array_equal(yb, values[:, 1], msg)
+            if key == 'even':
+                size = os.path.getsize(os.path.join(outputs['binary-compressed'], 'reference.bin'))
+                self.assertLess(size, os.path.getsize(os.path.join(outputs['binary'], 'reference.bin')) * 0.6)
+
+    def test_invalid_file(self):
+        file_name = os.path.join(self.tmp_dir, 'invalid.bin')
+        with open(file_name, 'wb') as f:
+            f.write(b'x,y\n' * 100)
+        with self.assertRaises(IOError):
+            pyfunnel.read_binary(file_name)
+
+
+class TestGate(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.x = np.linspace(0, 10, 5001)
+        self.y = np.sin(self.x)
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir)
+
+    def compare(self, output, yTest, **options):
+        return pyfunnel.compareAndReport(self.x, self.y, self.x, yTest, outputDirectory=os.path.join(self.tmp_dir, output),
+                                         atolx=0.01, atoly=0.01, **options)
+
+    def test_pass(self):
+        # No output file is written for a passing test curve (pyfunnel removes the log file).
+        for output, budget in (('in_memory', 0), ('out_of_core', 1)):
+            self.assertEqual(self.compare(output, self.y, gate=True, memoryBudget=budget), 0)
+            self.assertEqual(os.listdir(os.path.join(self.tmp_dir, output)), [])
+
+    def test_fail(self):
+        yTest = self.y.copy()
+        yTest[3000:3010] += 1
+        self.assertEqual(self.compare('report', yTest), 0)
+        for output, budget in (('in_memory', 0), ('out_of_core', 1)):
+            self.assertEqual(self.compare(output, yTest, gate=True, memoryBudget=budget), pyfunnel.GATE_FAILED)
+            self.assertEqual(sorted(os.listdir(os.path.join(self.tmp_dir, output))),
+                             ['errors.csv', 'lowerBound.csv', 'reference.csv', 'test.csv',
+                              'upperBound.csv'])
+            # The report of the failed test is the report of a comparison without gate.
+            for f in ['errors.csv', 'lowerBound.csv', 'upperBound.csv']:
+                with open(os.path.join(self.tmp_dir, output, f), 'rb') as f_1, \
+                        open(os.path.join(self.tmp_dir, 'report', f), 'rb') as f_2:
+                    self.assertEqual(f_1.read(), f_2.read(), f)
+
+
+class TestCLI(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir)
+
+    def run_cli(self, reference, test, output, *options):
+        return subprocess.call([sys.executable, cli, '--reference', reference, '--test', test,
+                                '--atolx', '0.002', '--atoly', '0.002', '--output', output] + list(options),
+                               cwd=self.tmp_dir, env=cli_env)
+
+    def assert_same_output(self, dir_1, dir_2, file_names=('errors.csv', 'lowerBound.csv', 'upperBound.csv')):
+        for f in file_names:
+            with open(os.path.join(dir_1, f), 'rb') as f_1, open(os.path.join(dir_2, f), 'rb') as f_2:
+                self.assertEqual(f_1.read(), f_2.read(), f)
+
+    def test_gzip_and_semicolon(self):
+        reference = os.path.join(test_bin, 'trended.csv')
+        test = os.path.join(test_bin, 'simulated.csv')
+        with open(reference, 'rb') as f:
+            content = f.read()
+        reference_gz = os.path.join(self.tmp_dir, 'trended.csv.gz')
+        with gzip.open(reference_gz, 'wb') as f:
+            f.write(content)
+        # No header, semicolon delimiter and Windows line endings.
+        reference_sc = os.path.join(self.tmp_dir, 'trended_sc.csv')
+        with open(reference_sc, 'wb') as f:
+            f.write(content.split(b'\n', 1)[1].replace(b',', b';').replace(b'\n', b'\r\n'))
+        self.assertEqual(self.run_cli(reference, test, 'plain'), 0)
+        self.assertEqual(self.run_cli(reference_gz, test, 'gz'), 0)
+        self.assertEqual(self.run_cli(reference_sc, test, 'sc'), 0)
+        self.assert_same_output(os.path.join(self.tmp_dir, 'plain'), os.path.join(self.tmp_dir, 'gz'))
+        self.assert_same_output(os.path.join(self.tmp_dir, 'plain'), os.path.join(self.tmp_dir, 'sc'))
+
+    def test_gate(self):
+        test_dir = os.path.join(pyfunnel_dir, 'tests', 'fail1')
+        reference = os.path.join(test_dir, 'trended.csv')
+        test = os.path.join(test_dir, 'simulated.csv')
+        # The test fails with the tolerances of fail1, and passes with a larger tolerance in y.
+        # With a memory budget of 1 MB, the 5041 points are compared by windows.
+        for rtoly, budget, expected in (('0.2', '0', 0), ('0.2', '1', 0), ('0.002', '0', 2), ('0.002', '1', 2)):
+            output = 'gate_{}_{}'.format(rtoly, budget)
+            rc = subprocess.call([sys.executable, cli, '--reference', reference, '--test', test, '--rtolx', '0.002',
+                                  '--rtoly', rtoly, '--output', output, '--gate', '--memory-budget', budget],
+                                 cwd=self.tmp_dir, env=cli_env)
+            self.assertEqual(rc, expected, output)
+            files = sorted(os.listdir(os.path.join(self.tmp_dir, output)))
+            self.assertEqual(files, [] if expected == 0 else
+                             ['errors.csv', 'lowerBound.csv', 'reference.csv', 'test.csv', 'upperBound.csv'], output)
+
+    def test_engine(self):
+        reference = os.path.join(test_bin, 'trended.csv')
+        test = os.path.join(test_bin, 'simulated.csv')
+        self.assertEqual(self.run_cli(reference, test, 'rectangle'), 0)
+        self.assertEqual(self.run_cli(reference, test, 'window', '--engine', 'window'), 0)
+        for f in ('errors.csv', 'lowerBound.csv', 'upperBound.csv'):
+            self.assertTrue(os.path.isfile(os.path.join(self.tmp_dir, 'window', f)), f)
+        errors = [np.loadtxt(os.path.join(self.tmp_dir, d, 'errors.csv'), delimiter=',', skiprows=1)
+                  for d in ('rectangle', 'window')]
+        np.testing.assert_allclose(errors[0], errors[1], rtol=0, atol=1e-9)
+        self.assertNotEqual(self.run_cli(reference, test, 'ltolx', '--engine', 'window', '--ltolx', '0.01'), 0)
+
+    def test_three_columns(self):
+        reference = os.path.join(self.tmp_dir, 'three.csv')
+        with open(reference, 'w') as f:
+            f.write('time,a,b\n0,1,2\n1,1,2\n')
+        self.assertNotEqual(self.run_cli(reference, reference, 'three'), 0)
+
+
+if __name__ == "__main__":
+    unittest.main()